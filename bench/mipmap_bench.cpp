@@ -0,0 +1,152 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <format>
+#include <iostream>
+#include <random>
+
+#include "bitmap.hpp"
+#include "half.hpp"
+#include "mipmap.hpp"
+
+/*
+    Microbenchmark of the CPU mip-chain builder: every instruction set against the scalar path, for both filters.
+    Usage: mipmap-bench [image file] [iterations]
+    Without an image file a 2048x2048 noise bitmap is used for each of u8 srgb, u16, f32 and f16.
+ */
+
+namespace
+{
+    char const *to_string(mipmap::instruction_set isa)
+    {
+        switch (isa)
+        {
+        case mipmap::instruction_set::scalar:
+            return "scalar";
+        case mipmap::instruction_set::sse:
+            return "sse";
+        case mipmap::instruction_set::avx2:
+            return "avx2";
+        default:
+            return "best";
+        }
+    }
+
+    bitmap make_noise(int size, bitmap_channel channels, bitmap_internal_format internal_format)
+    {
+        auto bmp = bitmap::allocate(size, size, channels, internal_format);
+        std::mt19937 rng{42};
+        auto count = static_cast<size_t>(size) * size * static_cast<int>(channels);
+        switch (internal_format)
+        {
+        case bitmap_internal_format::u8:
+            for (size_t i = 0; i < count; ++i)
+                reinterpret_cast<uint8_t *>(bmp.pixels())[i] = static_cast<uint8_t>(rng());
+            break;
+        case bitmap_internal_format::u16:
+            for (size_t i = 0; i < count; ++i)
+                reinterpret_cast<uint16_t *>(bmp.pixels())[i] = static_cast<uint16_t>(rng());
+            break;
+        case bitmap_internal_format::f32:
+            for (size_t i = 0; i < count; ++i)
+                reinterpret_cast<float *>(bmp.pixels())[i] = std::uniform_real_distribution<float>{0.0f, 4.0f}(rng);
+            break;
+        case bitmap_internal_format::f16:
+            for (size_t i = 0; i < count; ++i)
+                reinterpret_cast<uint16_t *>(bmp.pixels())[i] = utils::float_to_half(std::uniform_real_distribution<float>{0.0f, 4.0f}(rng));
+            break;
+        }
+        return bmp;
+    }
+
+    // largest difference of any element over the whole chain, in units of the element type
+    double max_difference(std::vector<bitmap> const &a, std::vector<bitmap> const &b)
+    {
+        double diff = 0.0;
+        for (size_t level = 0; level < a.size(); ++level)
+        {
+            auto &x = a[level];
+            auto &y = b[level];
+            auto count = x.size_in_bytes() / bitmap::elem_size(x.internal_format());
+            for (size_t i = 0; i < count; ++i)
+            {
+                double u = 0.0, v = 0.0;
+                switch (x.internal_format())
+                {
+                case bitmap_internal_format::u8:
+                    u = reinterpret_cast<uint8_t const *>(x.pixels())[i];
+                    v = reinterpret_cast<uint8_t const *>(y.pixels())[i];
+                    break;
+                case bitmap_internal_format::u16:
+                    u = reinterpret_cast<uint16_t const *>(x.pixels())[i];
+                    v = reinterpret_cast<uint16_t const *>(y.pixels())[i];
+                    break;
+                case bitmap_internal_format::f32:
+                    u = reinterpret_cast<float const *>(x.pixels())[i];
+                    v = reinterpret_cast<float const *>(y.pixels())[i];
+                    break;
+                case bitmap_internal_format::f16:
+                    u = utils::half_to_float(reinterpret_cast<uint16_t const *>(x.pixels())[i]);
+                    v = utils::half_to_float(reinterpret_cast<uint16_t const *>(y.pixels())[i]);
+                    break;
+                }
+                diff = std::max(diff, std::abs(u - v));
+            }
+        }
+        return diff;
+    }
+
+    void run(std::string const &name, bitmap const &source, bool srgb, int iterations)
+    {
+        std::cout << std::format("{} ({}x{}, {}, {}{})", name, source.width(), source.height(), source.channels(),
+                                 source.internal_format(), srgb ? ", srgb" : "")
+                  << std::endl;
+        for (auto f : {mipmap::filter::box, mipmap::filter::kaiser})
+        {
+            std::vector<bitmap> reference;
+            double scalar_ms = 0.0;
+            for (auto isa : {mipmap::instruction_set::scalar, mipmap::instruction_set::sse, mipmap::instruction_set::avx2})
+            {
+                if (isa > mipmap::detected_instruction_set())
+                {
+                    continue;
+                }
+                std::vector<bitmap> chain;
+                auto start = std::chrono::steady_clock::now();
+                for (int i = 0; i < iterations; ++i)
+                {
+                    chain = mipmap::build_chain(source, srgb, f, isa);
+                }
+                auto ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / iterations;
+                if (isa == mipmap::instruction_set::scalar)
+                {
+                    scalar_ms = ms;
+                    reference = std::move(chain);
+                    std::cout << std::format("  {:6} {:6}: {:8.2f} ms", f == mipmap::filter::box ? "box" : "kaiser", to_string(isa), ms) << std::endl;
+                }
+                else
+                {
+                    std::cout << std::format("  {:6} {:6}: {:8.2f} ms, {:.2f}x, max diff {}", f == mipmap::filter::box ? "box" : "kaiser",
+                                             to_string(isa), ms, scalar_ms / ms, max_difference(reference, chain))
+                              << std::endl;
+                }
+            }
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    auto iterations = argc > 2 ? std::max(std::atoi(argv[2]), 1) : 5;
+    if (argc > 1)
+    {
+        auto bmp = bitmap::from_file(argv[1]);
+        run(argv[1], bmp, bmp.internal_format() == bitmap_internal_format::u8, iterations);
+        return 0;
+    }
+    run("noise", make_noise(2048, bitmap_channel::rgba, bitmap_internal_format::u8), true, iterations);
+    run("noise", make_noise(2048, bitmap_channel::rgb, bitmap_internal_format::u16), false, iterations);
+    run("noise", make_noise(2048, bitmap_channel::rgb, bitmap_internal_format::f32), false, iterations);
+    run("noise", make_noise(2048, bitmap_channel::rgb, bitmap_internal_format::f16), false, iterations);
+    return 0;
+}
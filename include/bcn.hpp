@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "bitmap.hpp"
+
+namespace bcn
+{
+    enum class block_format : uint32_t
+    {
+        none = 0,
+        // rgb, 4 bpp (S3TC DXT1, opaque)
+        bc1,
+        // rgba, 8 bpp (S3TC DXT5)
+        bc3,
+        // one channel, 4 bpp (RGTC1)
+        bc4,
+        // two channels, 8 bpp (RGTC2)
+        bc5,
+        // rgba, 8 bpp (BPTC), encoded with mode 6 only
+        bc7,
+    };
+
+    enum class texture_usage : uint32_t
+    {
+        // albedo / diffuse, may be sRGB
+        color,
+        // non-color maps such as specular, roughness or height
+        data,
+        // tangent space normal map, only x and y are kept, shaders reconstruct z
+        normal_map,
+    };
+
+    size_t block_size(block_format format) noexcept;
+
+    size_t compressed_size(block_format format, int width, int height) noexcept;
+
+    /*! \brief Pick the block format for a bitmap: BC5 for normal maps, BC4 for single-channel maps, BC1 for rgb and BC7 for rgba.
+     *         Returns block_format::none for bitmaps that are not u8.
+     */
+    block_format choose_format(bitmap const &bmp, texture_usage usage) noexcept;
+
+    /*! \brief Encode a u8 bitmap, block rows are spread over worker threads.
+     *         Partial blocks at the right/bottom edge are padded by clamping, so any size down to 1x1 is accepted.
+     *         Channels are read in order: BC4 uses channel 0, BC5 channels 0 and 1; grey input is replicated to rgb.
+     */
+    std::vector<std::byte> encode(bitmap const &bmp, block_format format);
+}
+
+template <>
+struct std::formatter<bcn::block_format> : std::formatter<std::string>
+{
+    auto format(bcn::block_format fmt, std::format_context &ctx) const
+    {
+        auto &&out = ctx.out();
+        switch (fmt)
+        {
+        case bcn::block_format::none:
+            return std::format_to(out, "none");
+        case bcn::block_format::bc1:
+            return std::format_to(out, "bc1");
+        case bcn::block_format::bc3:
+            return std::format_to(out, "bc3");
+        case bcn::block_format::bc4:
+            return std::format_to(out, "bc4");
+        case bcn::block_format::bc5:
+            return std::format_to(out, "bc5");
+        case bcn::block_format::bc7:
+            return std::format_to(out, "bc7");
+        default:
+            throw std::invalid_argument(std::format("invalid block_format value: {}", static_cast<uint32_t>(fmt)));
+        }
+    }
+};
@@ -3,6 +3,7 @@
 #include <filesystem>
 #include <format>
 #include <memory>
+#include <optional>
 
 enum class bitmap_channel : int
 {
@@ -42,6 +43,8 @@ enum class bitmap_internal_format : int
     u8,
     u16,
     f32,
+    // IEEE half, used for HDR images
+    f16,
 };
 
 template <>
@@ -58,12 +61,16 @@ struct std::formatter<bitmap_internal_format> : std::formatter<std::string>
             return std::format_to(out, "u16");
         case bitmap_internal_format::f32:
             return std::format_to(out, "f32");
+        case bitmap_internal_format::f16:
+            return std::format_to(out, "f16");
         default:
             throw std::invalid_argument(std::format("invalid bitmap_internal_format value: {}", fmt));
         }
     }
 };
 
+class mapped_file;
+
 class bitmap final
 {
 public:
@@ -78,15 +85,38 @@ public:
     bitmap_channel channels() const noexcept;
     bitmap_internal_format internal_format() const noexcept;
     int max_mipmap_level() const noexcept;
+    size_t size_in_bytes() const noexcept;
+    // Pixels of a bitmap created by from_mapped_pixels() live in read-only mapped pages and must not be written.
     std::byte *pixels() noexcept;
+    std::byte const *pixels() const noexcept;
+
+    static size_t elem_size(bitmap_internal_format internal_format) noexcept;
 
     void swap(bitmap &other) noexcept;
 
-    static bitmap from_memory(std::byte const *p, size_t size, bitmap_channel required_channels = bitmap_channel::unspecified, bool flip_vertically = false);
+    // Uninitialized pixels, owned by the bitmap.
+    static bitmap allocate(int width, int height, bitmap_channel channels, bitmap_internal_format internal_format);
+
+    // HDR images are decoded to hdr_format, f16 (the default) or f32; Radiance rgb/rgba images are converted from RGBE straight to half.
+    static bitmap from_memory(std::byte const *p, size_t size, bitmap_channel required_channels = bitmap_channel::unspecified, bool flip_vertically = false,
+                              bitmap_internal_format hdr_format = bitmap_internal_format::f16);
 
-    static bitmap from_file(std::filesystem::path const &filename, bitmap_channel required_channels = bitmap_channel::unspecified, bool flip_vertically = false);
+    // Decodes straight from the mapped pages of the file.
+    static bitmap from_file(std::filesystem::path const &filename, bitmap_channel required_channels = bitmap_channel::unspecified, bool flip_vertically = false,
+                            bitmap_internal_format hdr_format = bitmap_internal_format::f16);
+
+    static bitmap from_mapped_file(mapped_file const &file, bitmap_channel required_channels = bitmap_channel::unspecified, bool flip_vertically = false,
+                                   bitmap_internal_format hdr_format = bitmap_internal_format::f16);
+
+    // Wraps already decoded pixels inside a mapped file without copying, the bitmap keeps the mapping alive.
+    static bitmap from_mapped_pixels(std::shared_ptr<mapped_file const> file, size_t offset, int width, int height,
+                                     bitmap_channel channels, bitmap_internal_format internal_format);
 
 private:
+    static std::optional<bitmap> decode_radiance_f16(std::byte const *p, size_t size, int channels, bool flip_vertically);
+    // src must be f32
+    static bitmap to_f16(bitmap const &src);
+
     bitmap();
     struct bitmap_impl;
     std::unique_ptr<bitmap_impl> impl_;
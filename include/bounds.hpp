@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <span>
+
+#include <glm/glm.hpp>
+
+/*
+    Axis aligned box and bounding sphere of a set of positions, for culling and LOD selection.
+    The sphere is centered on the box, its radius is the distance to the farthest position,
+    which is tighter than the half diagonal of the box and cheap to compute in a second pass.
+    Both passes take 4 positions at a time with SSE on x86.
+ */
+
+namespace glwrap
+{
+    struct bounds
+    {
+        glm::vec3 min{std::numeric_limits<float>::max()};
+        glm::vec3 max{std::numeric_limits<float>::lowest()};
+        glm::vec3 center{0.0f};
+        float radius{0.0f};
+
+        // no positions at all, merging with it is a no-op
+        bool is_empty() const noexcept { return min.x > max.x; }
+
+        glm::vec3 extent() const noexcept { return is_empty() ? glm::vec3{0.0f} : max - min; }
+
+        // Reads count positions of 3 floats, stride bytes apart, e.g. sizeof(vertex) for interleaved vertices.
+        static bounds compute(float const *positions, size_t count, size_t stride) noexcept;
+
+        static bounds compute(std::span<glm::vec3 const> positions) noexcept
+        {
+            return compute(positions.empty() ? nullptr : &positions[0].x, positions.size(), sizeof(glm::vec3));
+        }
+
+        // box of both boxes and the smallest sphere enclosing both spheres
+        bounds merge(bounds const &other) const noexcept;
+
+        // box of the 8 transformed corners, sphere scaled by the largest axis scale of matrix
+        bounds transform(glm::mat4 const &matrix) const noexcept;
+    };
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <limits>
+#include <memory>
+
+#include <glad/gl.h>
+
+/*
+    Suballocates GPU buffer memory, so meshes and other small buffers share a few large buffer objects instead of
+    creating one each. Blocks of block_size bytes are reserved with glNamedBufferStorage on demand; requests larger
+    than a block get a block of their own.
+    Free ranges of a block are managed by a TLSF allocator (two-level segregated fit, Masmano et al. 2004): ranges are
+    binned by size class in two levels with a bitmap per level, so finding a fitting range and freeing one, merged
+    with its free neighbours, take constant time. The bookkeeping lives on the CPU, the buffers are never mapped.
+    Sizes and offsets are multiples of the granularity. A block is released as soon as its last range is freed.
+    Not thread-safe, like every GL call it has to be used on the thread that owns the context.
+ */
+
+namespace glwrap
+{
+    struct buffer_allocation
+    {
+        static constexpr uint32_t no_node = std::numeric_limits<uint32_t>::max();
+
+        GLuint buffer{};
+        GLintptr offset{};
+        // rounded up to the granularity
+        GLsizeiptr size{};
+        uint32_t block{};
+        uint32_t node{no_node};
+
+        bool is_valid() const noexcept { return node != no_node; }
+    };
+
+    class buffer_allocator final
+    {
+    public:
+        struct statistics
+        {
+            size_t blocks;
+            size_t allocations;
+            // bytes of all blocks
+            size_t reserved;
+            size_t used;
+            size_t free;
+            size_t largest_free;
+            size_t free_ranges;
+
+            // used / reserved
+            float utilization() const noexcept { return reserved == 0 ? 1.0f : static_cast<float>(used) / static_cast<float>(reserved); }
+            // 0 if all free bytes are one range, close to 1 if they are scattered in small ranges
+            float fragmentation() const noexcept { return free == 0 ? 0.0f : 1.0f - static_cast<float>(largest_free) / static_cast<float>(free); }
+        };
+
+        static constexpr size_t default_block_size = size_t{64} << 20;
+        // multiple of every vertex and index size, and of the uniform and storage offset alignment of common drivers
+        static constexpr size_t default_granularity = 256;
+
+        // Shared by vertex and index buffers created with an allocator but without naming one.
+        static buffer_allocator &instance();
+
+        // granularity must be a power of two.
+        explicit buffer_allocator(size_t block_size = default_block_size, size_t granularity = default_granularity);
+
+        buffer_allocator(buffer_allocator const &) = delete;
+        buffer_allocator &operator=(buffer_allocator const &) = delete;
+        buffer_allocator(buffer_allocator &&other) noexcept;
+        buffer_allocator &operator=(buffer_allocator &&other) noexcept;
+        ~buffer_allocator();
+
+        // offset is a multiple of alignment (a power of two) and of the granularity.
+        buffer_allocation allocate(size_t size, size_t alignment = 1);
+        void free(buffer_allocation const &allocation);
+
+        statistics stats() const;
+
+    private:
+        struct buffer_allocator_impl;
+        std::unique_ptr<buffer_allocator_impl> impl_;
+    };
+}
+
+template <>
+struct std::formatter<glwrap::buffer_allocator::statistics>
+{
+    constexpr auto parse(std::format_parse_context &ctx)
+    {
+        return ctx.begin();
+    }
+
+    auto format(glwrap::buffer_allocator::statistics const &stats, std::format_context &ctx) const
+    {
+        return std::format_to(ctx.out(), "{} allocations in {} blocks, {} of {} bytes used ({:.1f}%), {} free ranges, {:.1f}% fragmented",
+                              stats.allocations, stats.blocks, stats.used, stats.reserved, stats.utilization() * 100.0f, stats.free_ranges,
+                              stats.fragmentation() * 100.0f);
+    }
+};
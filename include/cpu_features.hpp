@@ -0,0 +1,14 @@
+#pragma once
+
+namespace utils
+{
+    // x86 SIMD extensions usable by the running process (CPU and OS support), all false on other architectures.
+    struct cpu_features
+    {
+        bool avx2;
+        bool fma;
+        bool f16c;
+    };
+
+    cpu_features const &detect_cpu_features() noexcept;
+}
@@ -86,6 +86,20 @@
       auto trams_uniform = program.uniform("transform");
       trans_uniform.set_mat4(...);
 
+    * Uniform buffers
+    Use: typed_uniform_buffer<Block>, Block lists its members in block_desc_t and must match std140 (checked at compile time)
+    Examples:
+    - auto camera_ubo = typed_uniform_buffer<camera_block>(block);
+      program.uniform_block_binding("Camera", 0);
+      camera_ubo.bind_base(0);
+      camera_ubo.set(block, &camera_block::view);
+
+    * Storage buffers
+    Use: storage_buffer<Element>, Element must match std430 (checked at compile time)
+    Examples:
+    - auto lights_ssbo = storage_buffer<light_block>(std::span<light_block const>(lights));
+      lights_ssbo.bind_base(0);
+
     * Render
     program.use();
     vertarray.bind();
@@ -93,6 +107,8 @@
 
  */
 
+#include <algorithm>
+#include <cmath>
 #include <utility>
 #include <string_view>
 #include <string>
@@ -104,7 +120,10 @@
 #include <cstdint>
 #include <array>
 #include <map>
+#include <memory>
+#include <deque>
 #include <tuple>
+#include <type_traits>
 #include <optional>
 #include <format>
 #include <vector>
@@ -114,15 +133,33 @@
 #include <glm/gtc/type_ptr.hpp>
 
 #include "bitmap.hpp"
-
-#define GLWRAP_ITER_ARITH_TYPES(X)    \
-    X(std::int32_t, GL_INT)           \
-    X(std::int16_t, GL_SHORT)         \
-    X(std::int8_t, GL_BYTE)           \
-    X(std::uint32_t, GL_UNSIGNED_INT) \
-    X(std::uint16_t, GL_UNSIGNED_INT) \
-    X(std::uint8_t, GL_UNSIGNED_INT)  \
-    X(float, GL_FLOAT)                \
+#include "bounds.hpp"
+#include "buffer_allocator.hpp"
+#include "mapped_file.hpp"
+#include "texture_container.hpp"
+
+// S3TC (BC1/BC3) is an extension, the generated glad header only carries the core RGTC/BPTC formats
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#endif
+#ifndef GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+
+#define GLWRAP_ITER_ARITH_TYPES(X)      \
+    X(std::int32_t, GL_INT)             \
+    X(std::int16_t, GL_SHORT)           \
+    X(std::int8_t, GL_BYTE)             \
+    X(std::uint32_t, GL_UNSIGNED_INT)   \
+    X(std::uint16_t, GL_UNSIGNED_SHORT) \
+    X(std::uint8_t, GL_UNSIGNED_BYTE)   \
+    X(float, GL_FLOAT)                  \
     X(double, GL_DOUBLE)
 
 namespace glwrap
@@ -130,6 +167,43 @@ namespace glwrap
     using std::int8_t, std::int16_t, std::int32_t, std::int64_t,
         std::uint8_t, std::uint16_t, std::uint32_t, std::uint64_t;
 
+    //----------- packed vertex attribute types -------------------
+
+    // IEEE half float bits, read as float (GL_HALF_FLOAT).
+    struct half final
+    {
+        uint16_t bits;
+    };
+
+    // L components of T, read as floats. With Normalized, integer components map to [0, 1] (unsigned) or [-1, 1] (signed).
+    template <glm::length_t L, typename T, bool Normalized = false>
+    struct packed_vec final
+    {
+        std::array<T, L> components;
+    };
+
+    template <glm::length_t L>
+    using half_vec = packed_vec<L, half>;
+
+    template <glm::length_t L, typename T>
+    using normalized_vec = packed_vec<L, T, true>;
+
+    // Signed normalized x, y, z in 10 bits and w in 2 bits, read as vec4 (GL_INT_2_10_10_10_REV).
+    struct snorm_2_10_10_10 final
+    {
+        uint32_t bits;
+
+        static snorm_2_10_10_10 pack(glm::vec4 const &v) noexcept
+        {
+            auto component = [](float value, float max, int shift, uint32_t mask)
+            {
+                auto i = static_cast<int32_t>(std::lround(std::clamp(value, -1.0f, 1.0f) * max));
+                return (static_cast<uint32_t>(i) & mask) << shift;
+            };
+            return {component(v.x, 511.0f, 0, 0x3ff) | component(v.y, 511.0f, 10, 0x3ff) | component(v.z, 511.0f, 20, 0x3ff) | component(v.w, 1.0f, 30, 0x3)};
+        }
+    };
+
     namespace details
     {
         template <typename T>
@@ -146,6 +220,7 @@ namespace glwrap
     };
 
         GLWRAP_ITER_ARITH_TYPES(GLWRAP_GL_TYPE_TRAITS)
+        GLWRAP_GL_TYPE_TRAITS(half, GL_HALF_FLOAT)
         /*
         template <>
         struct gl_type_traits<std::int32_t> final : gl_type_traits_base<std::int32_t>
@@ -201,6 +276,19 @@ namespace glwrap
             ::glNamedBufferStorage(this->handle_, sizeof(T) * length, data, GL_DYNAMIC_STORAGE_BIT);
         }
 
+        // Lives in a range of a buffer shared with other allocations, handle() is the shared buffer and offset() the
+        // start of the data in it.
+        buffer(T const *data, size_t length, buffer_allocator &allocator)
+        {
+            if (length > std::numeric_limits<GLsizei>::max())
+                throw std::invalid_argument(std::format("buffer data too large ({})", length));
+            count_ = static_cast<GLsizei>(length);
+            allocation_ = allocator.allocate(sizeof(T) * length, alignof(T));
+            allocator_ = &allocator;
+            handle_ = allocation_.buffer;
+            ::glNamedBufferSubData(handle_, allocation_.offset, static_cast<GLsizeiptr>(sizeof(T) * length), data);
+        }
+
         buffer(std::initializer_list<T> data) : buffer(data.begin(), data.size()) {}
 
         template <size_t N>
@@ -209,6 +297,9 @@ namespace glwrap
         template <typename Allocator>
         explicit buffer(std::vector<T, Allocator> const &data) : buffer(data.data(), data.size()) {}
 
+        template <typename Allocator>
+        buffer(std::vector<T, Allocator> const &data, buffer_allocator &allocator) : buffer(data.data(), data.size(), allocator) {}
+
         buffer(buffer const &) = delete;
         buffer(buffer &&other) noexcept
         {
@@ -225,11 +316,17 @@ namespace glwrap
         {
             std::swap(handle_, other.handle_);
             std::swap(count_, other.count_);
+            std::swap(allocator_, other.allocator_);
+            std::swap(allocation_, other.allocation_);
         }
 
         virtual ~buffer() override
         {
-            if (handle_ != 0)
+            if (allocator_ != nullptr)
+            {
+                allocator_->free(allocation_);
+            }
+            else if (handle_ != 0)
             {
                 ::glDeleteBuffers(1, &handle_);
             }
@@ -237,6 +334,8 @@ namespace glwrap
 
         GLuint handle() const noexcept { return handle_; }
         GLsizei size() const noexcept { return count_; }
+        // in bytes, 0 unless created by an allocator
+        GLintptr offset() const noexcept { return allocation_.offset; }
 
     protected:
         buffer() = default;
@@ -244,6 +343,8 @@ namespace glwrap
     private:
         GLuint handle_{};
         GLsizei count_{};
+        buffer_allocator *allocator_{};
+        buffer_allocation allocation_{};
     };
 
     template <typename Vertex>
@@ -261,6 +362,9 @@ namespace glwrap
         explicit vertex_buffer(Vertex const (&data)[N]) : base(data) {}
         template <typename Allocator>
         explicit vertex_buffer(std::vector<Vertex, Allocator> const &data) : base(data) {}
+        vertex_buffer(Vertex const *data, size_t length, buffer_allocator &allocator) : base(data, length, allocator) {}
+        template <typename Allocator>
+        vertex_buffer(std::vector<Vertex, Allocator> const &data, buffer_allocator &allocator) : base(data, allocator) {}
 
     private:
         vertex_buffer() = default;
@@ -281,23 +385,554 @@ namespace glwrap
         explicit index_buffer(Index const (&data)[N]) : base(data) {}
         template <typename Allocator>
         explicit index_buffer(std::vector<Index, Allocator> const &data) : base(data) {}
+        index_buffer(Index const *data, size_t length, buffer_allocator &allocator) : base(data, length, allocator) {}
+        template <typename Allocator>
+        index_buffer(std::vector<Index, Allocator> const &data, buffer_allocator &allocator) : base(data, allocator) {}
 
     private:
         index_buffer() = default;
     };
 
+    // Index buffer whose element type is only known at run time, e.g. picked by any_index_buffer::narrowest.
+    // Owns the underlying index_buffer<Index>; handle() and size() behave like index_buffer's.
+    class any_index_buffer final : public buffer_base
+    {
+    public:
+        template <typename Index>
+        any_index_buffer(index_buffer<Index> &&ibuffer)
+            : handle_(ibuffer.handle()),
+              count_(ibuffer.size()),
+              offset_(ibuffer.offset()),
+              type_(details::gl_type_traits<Index>::type),
+              index_size_(details::gl_type_traits<Index>::size),
+              holded_(std::make_unique<index_buffer<Index>>(std::move(ibuffer)))
+        {
+        }
+
+        // uint16_t indices if every index of a vertex_count vertex mesh fits, otherwise uint32_t
+        static any_index_buffer narrowest(std::span<uint32_t const> indices, size_t vertex_count);
+        static any_index_buffer narrowest(std::span<uint32_t const> indices, size_t vertex_count, buffer_allocator &allocator);
+
+        any_index_buffer(any_index_buffer const &) = delete;
+        any_index_buffer(any_index_buffer &&other) noexcept { this->swap(other); }
+        any_index_buffer &operator=(any_index_buffer const &) = delete;
+        any_index_buffer &operator=(any_index_buffer &&other) noexcept
+        {
+            this->swap(other);
+            return *this;
+        }
+
+        void swap(any_index_buffer &other) noexcept
+        {
+            std::swap(handle_, other.handle_);
+            std::swap(count_, other.count_);
+            std::swap(offset_, other.offset_);
+            std::swap(type_, other.type_);
+            std::swap(index_size_, other.index_size_);
+            std::swap(holded_, other.holded_);
+        }
+
+        GLuint handle() const noexcept { return handle_; }
+        GLsizei size() const noexcept { return count_; }
+        GLintptr offset() const noexcept { return offset_; }
+        GLenum index_type() const noexcept { return type_; }
+        size_t index_size() const noexcept { return index_size_; }
+
+    private:
+        GLuint handle_{};
+        GLsizei count_{};
+        GLintptr offset_{};
+        GLenum type_{};
+        size_t index_size_{};
+        std::unique_ptr<buffer_base> holded_{};
+    };
+
+    namespace details
+    {
+        // untyped part of dynamic_ring_buffer<T>
+        class dynamic_ring final
+        {
+        public:
+            dynamic_ring(size_t frame_bytes, size_t frames, size_t alignment);
+
+            dynamic_ring(dynamic_ring const &) = delete;
+            dynamic_ring(dynamic_ring &&other) noexcept { swap(other); }
+            dynamic_ring &operator=(dynamic_ring const &) = delete;
+            dynamic_ring &operator=(dynamic_ring &&other) noexcept
+            {
+                swap(other);
+                return *this;
+            }
+
+            ~dynamic_ring();
+
+            void swap(dynamic_ring &other) noexcept
+            {
+                std::swap(handle_, other.handle_);
+                std::swap(mapped_, other.mapped_);
+                std::swap(frame_bytes_, other.frame_bytes_);
+                std::swap(alignment_, other.alignment_);
+                std::swap(fences_, other.fences_);
+                std::swap(frame_, other.frame_);
+                std::swap(head_, other.head_);
+                std::swap(acquired_, other.acquired_);
+            }
+
+            // Offset in bytes from the start of the buffer, waits for the GPU on the first allocation of a frame.
+            size_t allocate(size_t bytes);
+            void end_frame();
+
+            GLuint handle() const noexcept { return handle_; }
+            std::byte *mapped() const noexcept { return mapped_; }
+            size_t frame_bytes() const noexcept { return frame_bytes_; }
+            size_t frames() const noexcept { return fences_.size(); }
+
+        private:
+            GLuint handle_{};
+            std::byte *mapped_{};
+            size_t frame_bytes_{};
+            size_t alignment_{};
+            std::vector<GLsync> fences_{};
+            size_t frame_{};
+            size_t head_{};
+            bool acquired_{};
+        };
+    }
+
+    /*! \brief Streams per-frame data (instance matrices, light arrays, per-draw constants) without reallocating or
+     *         letting the driver synchronize implicitly. One immutable buffer, persistently mapped and coherent, holds
+     *         frames regions of capacity elements. Each frame sub-allocates from its region; end_frame() fences the
+     *         region, and the first allocation that comes back to it frames frames later waits on that fence.
+     *         Slices start at multiples of the uniform and shader storage offset alignments, so they can be bound
+     *         as uniform or storage ranges, vertex buffers (see vertex_array::set_vbuffer_range) or indirect buffers.
+     */
+    template <typename T>
+    class dynamic_ring_buffer final
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "dynamic_ring_buffer elements are written to mapped memory");
+
+    public:
+        static constexpr size_t default_frames = 3;
+
+        struct slice
+        {
+            std::span<T> data;
+            // in bytes, from the start of the buffer
+            GLintptr offset;
+
+            GLsizeiptr size_bytes() const noexcept { return static_cast<GLsizeiptr>(data.size_bytes()); }
+        };
+
+        explicit dynamic_ring_buffer(size_t capacity, size_t frames = default_frames)
+            : ring_(capacity * sizeof(T), frames, alignof(T))
+        {
+        }
+
+        // Space for count elements in the current frame, valid until the GPU is done with this frame.
+        // Throws std::length_error once the frame has no room left.
+        slice allocate(size_t count)
+        {
+            auto offset = ring_.allocate(count * sizeof(T));
+            return {{reinterpret_cast<T *>(ring_.mapped() + offset), count}, static_cast<GLintptr>(offset)};
+        }
+
+        // Call once after the last command that reads this frame's slices.
+        void end_frame() { ring_.end_frame(); }
+
+        void bind_range(GLenum target, GLuint index, slice const &s) const
+        {
+            ::glBindBufferRange(target, index, ring_.handle(), s.offset, s.size_bytes());
+        }
+
+        GLuint handle() const noexcept { return ring_.handle(); }
+        size_t capacity() const noexcept { return ring_.frame_bytes() / sizeof(T); }
+        size_t frames() const noexcept { return ring_.frames(); }
+
+    private:
+        details::dynamic_ring ring_;
+    };
+
+    // Layout of one glMultiDrawElementsIndirect command
+    struct draw_elements_indirect_command
+    {
+        using block_desc_t = std::tuple<GLuint, GLuint, GLuint, GLint, GLuint>;
+        GLuint count;
+        GLuint instance_count;
+        GLuint first_index;
+        GLint base_vertex;
+        GLuint base_instance;
+    };
+
+    // Layout of one glMultiDrawArraysIndirect command
+    struct draw_arrays_indirect_command
+    {
+        using block_desc_t = std::tuple<GLuint, GLuint, GLuint, GLuint>;
+        GLuint count;
+        GLuint instance_count;
+        GLuint first;
+        GLuint base_instance;
+    };
+
+    // ----------------- std140 / std430 block layout ------------------------
+
+    enum class block_layout
+    {
+        std140,
+        std430,
+    };
+
+    namespace details
+    {
+        constexpr size_t align_up(size_t value, size_t alignment) noexcept
+        {
+            return (value + alignment - 1) / alignment * alignment;
+        }
+
+        // std140 rounds the alignment of arrays and structs up to that of a vec4, std430 does not
+        constexpr size_t aggregate_alignment(block_layout layout, size_t alignment) noexcept
+        {
+            return layout == block_layout::std140 ? align_up(alignment, 16) : alignment;
+        }
+
+        /*
+            Base alignment and size of a block member, and whether the C++ type has the same layout:
+                - int32_t, uint32_t, float and double are scalars
+                - glm::vec<L>: vec3 is aligned like vec4 but is only 12 bytes, so a scalar may follow it
+                - glm::mat<C, R>: C column vectors, only R = 4 (or R = 2 in std430) matches C++
+                - std::array<E, N>: in std140 elements have a stride of 16 bytes at least, so float[N] or vec2[N]
+                  never match; in std430 only arrays of vec3 do not
+                - structs that define block_desc_t (see typed_uniform_buffer), aligned to 16 bytes in std140
+        */
+        template <block_layout Layout, typename T, typename V = bool>
+        struct block_traits
+        {
+            static_assert(!std::is_same_v<T, T>, "Block member must be a 32 bit scalar, double, glm vector or matrix, std::array or a struct with 'block_desc_t'");
+        };
+
+        template <typename T>
+        struct block_scalar_traits
+        {
+            static constexpr size_t alignment = sizeof(T);
+            static constexpr size_t size = sizeof(T);
+            static constexpr bool matches = true;
+        };
+
+        template <block_layout Layout>
+        struct block_traits<Layout, std::int32_t> : block_scalar_traits<std::int32_t>
+        {
+        };
+
+        template <block_layout Layout>
+        struct block_traits<Layout, std::uint32_t> : block_scalar_traits<std::uint32_t>
+        {
+        };
+
+        template <block_layout Layout>
+        struct block_traits<Layout, float> : block_scalar_traits<float>
+        {
+        };
+
+        template <block_layout Layout>
+        struct block_traits<Layout, double> : block_scalar_traits<double>
+        {
+        };
+
+        template <block_layout Layout, glm::length_t L, typename T, glm::qualifier Q>
+        struct block_traits<Layout, glm::vec<L, T, Q>>
+        {
+            static constexpr size_t alignment = (L == 3 ? 4 : L) * block_traits<Layout, T>::size;
+            static constexpr size_t size = L * block_traits<Layout, T>::size;
+            static constexpr bool matches = sizeof(glm::vec<L, T, Q>) == size;
+        };
+
+        template <block_layout Layout, typename E, size_t N>
+        struct block_traits<Layout, std::array<E, N>>
+        {
+            static constexpr size_t alignment = aggregate_alignment(Layout, block_traits<Layout, E>::alignment);
+            static constexpr size_t stride = align_up(block_traits<Layout, E>::size, alignment);
+            static constexpr size_t size = N * stride;
+            static constexpr bool matches = block_traits<Layout, E>::matches && sizeof(E) == stride;
+        };
+
+        template <block_layout Layout, glm::length_t C, glm::length_t R, typename T, glm::qualifier Q>
+        struct block_traits<Layout, glm::mat<C, R, T, Q>> : block_traits<Layout, std::array<glm::vec<R, T, Q>, C>>
+        {
+            static constexpr bool matches = sizeof(glm::mat<C, R, T, Q>) == block_traits<Layout, std::array<glm::vec<R, T, Q>, C>>::size;
+        };
+
+        template <block_layout Layout, typename Desc>
+        struct block_members;
+
+        // Offsets of the members listed in the tuple, by the block layout rules and by C++ rules for a plain struct
+        template <block_layout Layout, typename... M>
+        struct block_members<Layout, std::tuple<M...>>
+        {
+            static constexpr size_t count = sizeof...(M);
+            static constexpr size_t alignment = aggregate_alignment(Layout, std::max({size_t{1}, block_traits<Layout, M>::alignment...}));
+
+            static constexpr auto offsets = []
+            {
+                std::array<size_t, count + 1> result{};
+                size_t offset = 0, i = 0;
+                ((offset = align_up(offset, block_traits<Layout, M>::alignment), result[i++] = offset, offset += block_traits<Layout, M>::size), ...);
+                result[count] = offset;
+                return result;
+            }();
+
+            static constexpr auto cpp_offsets = []
+            {
+                std::array<size_t, count + 1> result{};
+                size_t offset = 0, i = 0;
+                ((offset = align_up(offset, alignof(M)), result[i++] = offset, offset += sizeof(M)), ...);
+                result[count] = align_up(offset, std::max({size_t{1}, alignof(M)...}));
+                return result;
+            }();
+
+            // index of the first member placed differently, count if there is none
+            static constexpr size_t first_mismatch = []
+            {
+                constexpr std::array member_matches{true, block_traits<Layout, M>::matches...};
+                for (size_t i = 0; i < count; ++i)
+                {
+                    if (!member_matches[i + 1] || offsets[i] != cpp_offsets[i])
+                    {
+                        return i;
+                    }
+                }
+                return count;
+            }();
+        };
+
+        template <block_layout Layout, typename T>
+        struct block_traits<Layout, T, std::enable_if_t<!std::is_same_v<typename T::block_desc_t, void>, bool>>
+        {
+            using members = block_members<Layout, typename T::block_desc_t>;
+            static constexpr size_t alignment = members::alignment;
+            static constexpr size_t size = align_up(members::offsets[members::count], alignment);
+            // sizeof(T) tells whether block_desc_t lists all members of T
+            static constexpr bool matches = members::first_mismatch == members::count && sizeof(T) == members::cpp_offsets[members::count];
+        };
+    }
+
+    /*! \brief Uniform buffer holding one T, shared by every program that binds its block to the same binding point.
+     *         T is a standard-layout struct that lists its member types in order, the way vertex types list their
+     *         attributes:
+     *             struct camera_block
+     *             {
+     *                 using block_desc_t = std::tuple<glm::mat4, glm::mat4, glm::vec3, float>;
+     *                 glm::mat4 projection;
+     *                 glm::mat4 view;
+     *                 glm::vec3 position;
+     *                 float exposure;
+     *             };
+     *         Its layout is checked against std140 at compile time, so the struct can be copied to the buffer as is.
+     *         Pad where std140 does: after a vec3 that is not followed by a scalar, and in arrays of scalars or
+     *         vec2 (use std::array<glm::vec4, N> instead).
+     */
     template <typename T>
     class typed_uniform_buffer final
     {
+        static_assert(std::is_standard_layout_v<T> && std::is_trivially_copyable_v<T>, "Uniform block type must be a standard-layout, trivially copyable struct");
+        static_assert(details::block_traits<block_layout::std140, T>::matches, "Uniform block type does not match std140, see details::block_members<block_layout::std140, T::block_desc_t>::first_mismatch");
+
     public:
-        typed_uniform_buffer()
+        explicit typed_uniform_buffer(T const &value = {})
         {
             glCreateBuffers(1, &handle_);
-            // glBufferStorage()
+            // GL_UNIFORM_BLOCK_DATA_SIZE is rounded up to 16, a buffer of sizeof(T) could be too small to bind
+            glNamedBufferStorage(handle_, static_cast<GLsizeiptr>(details::block_traits<block_layout::std140, T>::size), nullptr, GL_DYNAMIC_STORAGE_BIT);
+            set(value);
+        }
+
+        typed_uniform_buffer(typed_uniform_buffer const &) = delete;
+        typed_uniform_buffer(typed_uniform_buffer &&other) noexcept { swap(other); }
+        typed_uniform_buffer &operator=(typed_uniform_buffer const &) = delete;
+        typed_uniform_buffer &operator=(typed_uniform_buffer &&other) noexcept
+        {
+            swap(other);
+            return *this;
+        }
+
+        ~typed_uniform_buffer()
+        {
+            if (handle_ != 0)
+            {
+                glDeleteBuffers(1, &handle_);
+            }
         }
 
+        void swap(typed_uniform_buffer &other) noexcept { std::swap(handle_, other.handle_); }
+
+        void set(T const &value) { glNamedBufferSubData(handle_, 0, sizeof(T), &value); }
+
+        // Uploads only member of value.
+        template <typename M>
+        void set(T const &value, M T::*member)
+        {
+            upload(value, &(value.*member), sizeof(M));
+        }
+
+        // Uploads elements [first, first + count) of the array member of value.
+        template <typename E, size_t N>
+        void set(T const &value, std::array<E, N> T::*member, size_t first, size_t count)
+        {
+            if (first > N || count > N - first)
+            {
+                throw std::out_of_range(std::format("Uniform array range [{}, {}) out of {} elements", first, first + count, N));
+            }
+            upload(value, (value.*member).data() + first, count * sizeof(E));
+        }
+
+        // Programs see the buffer through blocks bound to binding with shader_program::uniform_block_binding.
+        void bind_base(GLuint binding) const { glBindBufferBase(GL_UNIFORM_BUFFER, binding, handle_); }
+
+        GLuint handle() const noexcept { return handle_; }
+
     private:
-        GLuint handle_;
+        void upload(T const &value, void const *first, size_t bytes)
+        {
+            auto offset = static_cast<std::byte const *>(first) - reinterpret_cast<std::byte const *>(&value);
+            glNamedBufferSubData(handle_, static_cast<GLintptr>(offset), static_cast<GLsizeiptr>(bytes), first);
+        }
+
+        GLuint handle_{};
+    };
+
+    /*! \brief Shader storage buffer holding an array of T, declared in shaders as an unsized std430 array and sized
+     *         with length(), so element counts are only limited by memory:
+     *             layout(std430, binding = 0) readonly buffer Lights { Light lights[]; };
+     *         T is a scalar, glm vector or matrix, or a struct with block_desc_t as for typed_uniform_buffer, checked
+     *         against std430 at compile time: arrays of scalars or vec2 need no padding, vec3 members still do.
+     *         Compute shaders may write it. Issue glMemoryBarrier with the bit of the next reader first, e.g.
+     *         GL_BUFFER_UPDATE_BARRIER_BIT before read().
+     */
+    template <typename T>
+    class storage_buffer final
+    {
+        static_assert(std::is_standard_layout_v<T> && std::is_trivially_copyable_v<T>, "Storage buffer element must be a standard-layout, trivially copyable type");
+        static_assert(details::block_traits<block_layout::std430, std::array<T, 1>>::matches, "Storage buffer element does not match std430");
+
+    public:
+        // count zeroed elements
+        explicit storage_buffer(size_t count)
+        {
+            create(count, nullptr);
+            glClearNamedBufferData(handle_, GL_R8UI, GL_RED_INTEGER, GL_UNSIGNED_BYTE, nullptr);
+        }
+
+        explicit storage_buffer(std::span<T const> data) { create(data.size(), data.data()); }
+
+        storage_buffer(storage_buffer const &) = delete;
+        storage_buffer(storage_buffer &&other) noexcept { swap(other); }
+        storage_buffer &operator=(storage_buffer const &) = delete;
+        storage_buffer &operator=(storage_buffer &&other) noexcept
+        {
+            swap(other);
+            return *this;
+        }
+
+        ~storage_buffer()
+        {
+            if (handle_ != 0)
+            {
+                glDeleteBuffers(1, &handle_);
+            }
+        }
+
+        void swap(storage_buffer &other) noexcept
+        {
+            std::swap(handle_, other.handle_);
+            std::swap(count_, other.count_);
+        }
+
+        // Overwrites elements starting at first.
+        void set(size_t first, std::span<T const> data)
+        {
+            check_range(first, data.size());
+            glNamedBufferSubData(handle_, static_cast<GLintptr>(first * sizeof(T)), static_cast<GLsizeiptr>(data.size_bytes()), data.data());
+        }
+
+        // Reads back elements [first, first + count), waits for the GPU.
+        std::vector<T> read(size_t first, size_t count) const
+        {
+            check_range(first, count);
+            std::vector<T> result(count);
+            glGetNamedBufferSubData(handle_, static_cast<GLintptr>(first * sizeof(T)), static_cast<GLsizeiptr>(count * sizeof(T)), result.data());
+            return result;
+        }
+
+        std::vector<T> read() const { return read(0, count_); }
+
+        void bind_base(GLuint index) const { glBindBufferBase(GL_SHADER_STORAGE_BUFFER, index, handle_); }
+
+        // Binds elements [first, first + count), first * sizeof(T) must be a multiple of GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT.
+        void bind_range(GLuint index, size_t first, size_t count) const
+        {
+            check_range(first, count);
+            GLint alignment = 1;
+            glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+            if (first * sizeof(T) % static_cast<size_t>(alignment) != 0)
+            {
+                throw std::invalid_argument(std::format("Storage buffer range at byte {} is not aligned to {}", first * sizeof(T), alignment));
+            }
+            glBindBufferRange(GL_SHADER_STORAGE_BUFFER, index, handle_, static_cast<GLintptr>(first * sizeof(T)), static_cast<GLsizeiptr>(count * sizeof(T)));
+        }
+
+        GLuint handle() const noexcept { return handle_; }
+        size_t size() const noexcept { return count_; }
+
+    private:
+        void create(size_t count, T const *data)
+        {
+            if (count == 0 || count > static_cast<size_t>(std::numeric_limits<GLsizeiptr>::max()) / sizeof(T))
+            {
+                throw std::invalid_argument(std::format("Invalid storage buffer size ({})", count));
+            }
+            count_ = count;
+            glCreateBuffers(1, &handle_);
+            glNamedBufferStorage(handle_, static_cast<GLsizeiptr>(count * sizeof(T)), data, GL_DYNAMIC_STORAGE_BIT);
+        }
+
+        void check_range(size_t first, size_t count) const
+        {
+            if (first > count_ || count > count_ - first)
+            {
+                throw std::out_of_range(std::format("Storage buffer range [{}, {}) out of {} elements", first, first + count, count_));
+            }
+        }
+
+        GLuint handle_{};
+        size_t count_{};
+    };
+
+    /*! \brief Draw commands in GPU memory for vertex_array::draw_indirect and multi_draw_indirect, Command being
+     *         draw_elements_indirect_command for indexed vertex arrays and draw_arrays_indirect_command otherwise.
+     *         Commands are written by the CPU with set(), or by compute shaders through bind_base() (as a std430
+     *         array of uint), so culling can decide what is drawn without a read back.
+     */
+    template <typename Command>
+    class indirect_buffer final
+    {
+        static_assert(std::is_same_v<Command, draw_elements_indirect_command> || std::is_same_v<Command, draw_arrays_indirect_command>,
+                      "Indirect command must be draw_elements_indirect_command or draw_arrays_indirect_command");
+
+    public:
+        using command_type = Command;
+
+        // count zeroed commands, which draw nothing
+        explicit indirect_buffer(size_t count) : commands_(count) {}
+        explicit indirect_buffer(std::span<Command const> commands) : commands_(commands) {}
+
+        void set(size_t first, std::span<Command const> commands) { commands_.set(first, commands); }
+
+        void bind() const { glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commands_.handle()); }
+        void bind_base(GLuint index) const { commands_.bind_base(index); }
+
+        GLuint handle() const noexcept { return commands_.handle(); }
+        size_t size() const noexcept { return commands_.size(); }
+
+    private:
+        storage_buffer<Command> commands_;
     };
 
     class vertex_array final
@@ -336,6 +971,18 @@ namespace glwrap
             this->set_ibuffer(std::move(moved_ibuffer));
         }
 
+        template <typename... VertexBuffers>
+        explicit vertex_array(any_index_buffer &ibuffer, VertexBuffers &&...vbuffers) : vertex_array(std::forward<VertexBuffers>(vbuffers)...)
+        {
+            this->set_ibuffer(ibuffer);
+        }
+
+        template <typename... VertexBuffers>
+        explicit vertex_array(any_index_buffer &&moved_ibuffer, VertexBuffers &&...vbuffers) : vertex_array(std::forward<VertexBuffers>(vbuffers)...)
+        {
+            this->set_ibuffer(std::move(moved_ibuffer));
+        }
+
         vertex_array(vertex_array &) = delete;
         vertex_array(vertex_array &&other) noexcept { this->swap(other); }
 
@@ -363,6 +1010,8 @@ namespace glwrap
             std::swap(ibuffer_, other.ibuffer_);
             std::swap(index_type_, other.index_type_);
             std::swap(index_size_, other.index_size_);
+            std::swap(index_offset_, other.index_offset_);
+            std::swap(bounds_, other.bounds_);
         }
 
         void attrib_format(GLuint attrib_index, GLuint vbuffer_index, GLint size, GLenum type, GLboolean normalizing, GLuint relative_offset)
@@ -407,8 +1056,7 @@ namespace glwrap
             glBindVertexArray(handle_);
             if (ibuffer_.has_value())
             {
-                intptr_t indices = start * index_size_;
-                glDrawElements(static_cast<GLenum>(mode), count, index_type_, reinterpret_cast<const void *>(indices));
+                glDrawElements(static_cast<GLenum>(mode), count, index_type_, index_pointer(start));
             }
             else
             {
@@ -447,8 +1095,7 @@ namespace glwrap
             glBindVertexArray(handle_);
             if (ibuffer_.has_value())
             {
-                intptr_t indices = start * index_size_;
-                glDrawElementsInstanced(static_cast<GLenum>(mode), count, index_type_, reinterpret_cast<const void *>(indices), instance_count);
+                glDrawElementsInstanced(static_cast<GLenum>(mode), count, index_type_, index_pointer(start), instance_count);
             }
             else
             {
@@ -461,6 +1108,126 @@ namespace glwrap
             draw_instanced(draw_mode::triangles, start, count, instance_count);
         }
 
+        // Indices are offset by base_vertex before fetching vertices
+        void draw_base_vertex(draw_mode mode, GLint start, GLsizei count, GLint base_vertex)
+        {
+            if (!ibuffer_.has_value())
+            {
+                throw std::runtime_error("draw_base_vertex needs an index buffer");
+            }
+            glBindVertexArray(handle_);
+            glDrawElementsBaseVertex(static_cast<GLenum>(mode), count, index_type_, index_pointer(start), base_vertex);
+        }
+
+        // One glMultiDrawElementsBaseVertex over several (start, count, base_vertex) ranges
+        void multi_draw_base_vertex(draw_mode mode, std::span<GLsizei const> counts, std::span<GLint const> starts, std::span<GLint const> base_vertices)
+        {
+            if (!ibuffer_.has_value())
+            {
+                throw std::runtime_error("multi_draw_base_vertex needs an index buffer");
+            }
+            if (counts.size() != starts.size() || counts.size() != base_vertices.size())
+            {
+                throw std::invalid_argument(std::format("Mismatched draw ranges: {} counts, {} starts, {} base vertices", counts.size(), starts.size(), base_vertices.size()));
+            }
+            std::vector<const void *> offsets;
+            offsets.reserve(starts.size());
+            for (auto start : starts)
+            {
+                offsets.push_back(index_pointer(start));
+            }
+            glBindVertexArray(handle_);
+            glMultiDrawElementsBaseVertex(static_cast<GLenum>(mode), counts.data(), index_type_, offsets.data(), static_cast<GLsizei>(counts.size()),
+                                          base_vertices.data());
+        }
+
+        // Per-instance attributes start at base_instance instead of 0
+        void draw_instanced(draw_mode mode, GLint start, GLsizei count, GLsizei instance_count, GLuint base_instance)
+        {
+            glBindVertexArray(handle_);
+            if (ibuffer_.has_value())
+            {
+                glDrawElementsInstancedBaseInstance(static_cast<GLenum>(mode), count, index_type_, index_pointer(start), instance_count, base_instance);
+            }
+            else
+            {
+                glDrawArraysInstancedBaseInstance(static_cast<GLenum>(mode), start, count, instance_count, base_instance);
+            }
+        }
+
+        // One glMultiDrawElements or glMultiDrawArrays over several (start, count) ranges
+        void multi_draw(draw_mode mode, std::span<GLsizei const> counts, std::span<GLint const> starts)
+        {
+            if (counts.size() != starts.size())
+            {
+                throw std::invalid_argument(std::format("Mismatched draw ranges: {} counts, {} starts", counts.size(), starts.size()));
+            }
+            glBindVertexArray(handle_);
+            if (ibuffer_.has_value())
+            {
+                std::vector<const void *> offsets;
+                offsets.reserve(starts.size());
+                for (auto start : starts)
+                {
+                    offsets.push_back(index_pointer(start));
+                }
+                glMultiDrawElements(static_cast<GLenum>(mode), counts.data(), index_type_, offsets.data(), static_cast<GLsizei>(counts.size()));
+            }
+            else
+            {
+                glMultiDrawArrays(static_cast<GLenum>(mode), starts.data(), counts.data(), static_cast<GLsizei>(counts.size()));
+            }
+        }
+
+        // Command index of commands. first_index of indexed commands has to include index_offset().
+        template <typename Command>
+        void draw_indirect(draw_mode mode, indirect_buffer<Command> const &commands, size_t index)
+        {
+            check_indirect<Command>(commands, index, 1);
+            commands.bind();
+            glBindVertexArray(handle_);
+            auto offset = reinterpret_cast<const void *>(index * sizeof(Command));
+            if (ibuffer_.has_value())
+            {
+                glDrawElementsIndirect(static_cast<GLenum>(mode), index_type_, offset);
+            }
+            else
+            {
+                glDrawArraysIndirect(static_cast<GLenum>(mode), offset);
+            }
+        }
+
+        // Commands [first, first + count) of commands in one call.
+        template <typename Command>
+        void multi_draw_indirect(draw_mode mode, indirect_buffer<Command> const &commands, size_t first, size_t count)
+        {
+            check_indirect<Command>(commands, first, count);
+            commands.bind();
+            multi_draw_indirect(mode, static_cast<GLintptr>(first * sizeof(Command)), static_cast<GLsizei>(count));
+        }
+
+        template <typename Command>
+        void multi_draw_indirect(draw_mode mode, indirect_buffer<Command> const &commands)
+        {
+            multi_draw_indirect(mode, commands, 0, commands.size());
+        }
+
+        // Commands are read from the buffer bound to GL_DRAW_INDIRECT_BUFFER, starting at offset bytes.
+        // Indexed arrays expect draw_elements_indirect_command, whose first_index has to include index_offset().
+        // The others expect DrawArraysIndirectCommand.
+        void multi_draw_indirect(draw_mode mode, GLintptr offset, GLsizei draw_count)
+        {
+            glBindVertexArray(handle_);
+            if (ibuffer_.has_value())
+            {
+                glMultiDrawElementsIndirect(static_cast<GLenum>(mode), index_type_, reinterpret_cast<const void *>(offset), draw_count, 0);
+            }
+            else
+            {
+                glMultiDrawArraysIndirect(static_cast<GLenum>(mode), reinterpret_cast<const void *>(offset), draw_count, 0);
+            }
+        }
+
         GLuint handle() const noexcept { return handle_; }
 
         template <typename Vertex>
@@ -468,7 +1235,7 @@ namespace glwrap
         {
             auto index = vbuffers_.size();
             vcount_ = vcount_.has_value() ? std::min(vcount_.value(), vbuffer.size()) : vbuffer.size();
-            ::glVertexArrayVertexBuffer(this->handle_, static_cast<GLuint>(index), vbuffer.handle(), 0, sizeof(Vertex));
+            ::glVertexArrayVertexBuffer(this->handle_, static_cast<GLuint>(index), vbuffer.handle(), vbuffer.offset(), sizeof(Vertex));
             vbuffers_.push_back(vbuffer.handle());
             return index;
         }
@@ -479,12 +1246,29 @@ namespace glwrap
             auto holded_ptr = std::make_unique<vertex_buffer<Vertex>>(std::move(moved_vbuffer));
             auto index = vbuffers_.size();
             vcount_ = vcount_.has_value() ? std::min(vcount_.value(), holded_ptr->size()) : holded_ptr->size();
-            ::glVertexArrayVertexBuffer(this->handle_, static_cast<GLuint>(index), holded_ptr->handle(), 0, sizeof(Vertex));
+            ::glVertexArrayVertexBuffer(this->handle_, static_cast<GLuint>(index), holded_ptr->handle(), holded_ptr->offset(), sizeof(Vertex));
             vbuffers_.push_back(holded_ptr->handle());
             holded_buffers_.push_back(std::move(holded_ptr));
             return index;
         }
 
+        // Binds a range of a buffer the array does not own, e.g. a dynamic_ring_buffer slice. The vertex count is left
+        // unchanged, such bindings are meant for per-instance attributes.
+        size_t attach_vbuffer_range(GLuint buffer, GLintptr offset, GLsizei stride)
+        {
+            auto index = vbuffers_.size();
+            ::glVertexArrayVertexBuffer(this->handle_, static_cast<GLuint>(index), buffer, offset, stride);
+            vbuffers_.push_back(buffer);
+            return index;
+        }
+
+        // Rebinds binding index, typically to the slice of the current frame.
+        void set_vbuffer_range(size_t index, GLuint buffer, GLintptr offset, GLsizei stride)
+        {
+            ::glVertexArrayVertexBuffer(this->handle_, static_cast<GLuint>(index), buffer, offset, stride);
+            vbuffers_.at(index) = buffer;
+        }
+
         template <typename... VertexBuffers>
         void attach_vbuffers(VertexBuffers &&...vbuffers)
         {
@@ -494,34 +1278,84 @@ namespace glwrap
         template <typename Index>
         void set_ibuffer(index_buffer<Index> &ibuffer)
         {
-            if (ibuffer_.has_value())
-            {
-                throw std::runtime_error("Vertex array already has index buffer");
-            }
-            ibuffer_ = ibuffer.handle();
-            index_type_ = details::gl_type_traits<Index>::type;
-            index_size_ = details::gl_type_traits<Index>::size;
-            icount_ = ibuffer.size();
-            ::glVertexArrayElementBuffer(handle_, ibuffer.handle());
+            bind_ibuffer(ibuffer.handle(), ibuffer.offset(), ibuffer.size(), details::gl_type_traits<Index>::type, details::gl_type_traits<Index>::size);
         }
 
         template <typename Index>
         void set_ibuffer(index_buffer<Index> &&moved_ibuffer)
+        {
+            auto holded_ptr = std::make_unique<index_buffer<Index>>(std::move(moved_ibuffer));
+            bind_ibuffer(holded_ptr->handle(), holded_ptr->offset(), holded_ptr->size(), details::gl_type_traits<Index>::type, details::gl_type_traits<Index>::size);
+            holded_buffers_.push_back(std::move(holded_ptr));
+        }
+
+        void set_ibuffer(any_index_buffer &ibuffer)
+        {
+            bind_ibuffer(ibuffer.handle(), ibuffer.offset(), ibuffer.size(), ibuffer.index_type(), ibuffer.index_size());
+        }
+
+        void set_ibuffer(any_index_buffer &&moved_ibuffer)
+        {
+            auto holded_ptr = std::make_unique<any_index_buffer>(std::move(moved_ibuffer));
+            bind_ibuffer(holded_ptr->handle(), holded_ptr->offset(), holded_ptr->size(), holded_ptr->index_type(), holded_ptr->index_size());
+            holded_buffers_.push_back(std::move(holded_ptr));
+        }
+
+        GLenum index_type() const noexcept { return index_type_; }
+
+        // First index of the index buffer within its GL buffer, non-zero for suballocated index buffers
+        GLint index_offset() const noexcept { return index_offset_; }
+
+        // Extent of the vertex positions, empty unless whoever filled the buffers set it
+        // (load_simple_json and utils::create_uv_sphere do).
+        glwrap::bounds const &bounds() const noexcept { return bounds_; }
+        void set_bounds(glwrap::bounds const &b) noexcept { bounds_ = b; }
+
+        // Limits draw() and draw_instanced() without a range to the first count indices,
+        // for index buffers that hold more than one triangle list (e.g. LODs after the full mesh)
+        void set_index_count(GLsizei count)
+        {
+            if (!ibuffer_.has_value())
+            {
+                throw std::runtime_error("Vertex array has no index buffer");
+            }
+            icount_ = count;
+        }
+
+    private:
+        void bind_ibuffer(GLuint ibuffer, GLintptr offset, GLsizei count, GLenum type, size_t size)
         {
             if (ibuffer_.has_value())
             {
                 throw std::runtime_error("Vertex array already has index buffer");
             }
-            auto holded_ptr = std::make_unique<index_buffer<Index>>(std::move(moved_ibuffer));
-            ibuffer_ = holded_ptr->handle();
-            index_type_ = details::gl_type_traits<Index>::type;
-            index_size_ = details::gl_type_traits<Index>::size;
-            icount_ = holded_ptr->size();
-            ::glVertexArrayElementBuffer(handle_, holded_ptr->handle());
-            holded_buffers_.push_back(std::move(holded_ptr));
+            ibuffer_ = ibuffer;
+            index_type_ = type;
+            index_size_ = size;
+            index_offset_ = static_cast<GLint>(offset / static_cast<GLintptr>(size));
+            icount_ = count;
+            ::glVertexArrayElementBuffer(handle_, ibuffer);
+        }
+
+        template <typename Command>
+        void check_indirect(indirect_buffer<Command> const &commands, size_t first, size_t count) const
+        {
+            if (ibuffer_.has_value() != std::is_same_v<Command, draw_elements_indirect_command>)
+            {
+                throw std::invalid_argument(ibuffer_.has_value() ? "Indexed vertex array needs draw_elements_indirect_command"
+                                                                 : "Vertex array without index buffer needs draw_arrays_indirect_command");
+            }
+            if (first > commands.size() || count > commands.size() - first)
+            {
+                throw std::out_of_range(std::format("Indirect commands [{}, {}) out of {}", first, first + count, commands.size()));
+            }
+        }
+
+        const void *index_pointer(GLint start) const noexcept
+        {
+            return reinterpret_cast<const void *>(static_cast<intptr_t>(index_offset_ + start) * static_cast<intptr_t>(index_size_));
         }
 
-    private:
         GLuint handle_{};
         std::vector<GLuint> vbuffers_{};
         std::optional<GLsizei> vcount_{};
@@ -529,6 +1363,8 @@ namespace glwrap
         std::optional<GLuint> ibuffer_{};
         GLenum index_type_{};
         size_t index_size_{};
+        GLint index_offset_{};
+        glwrap::bounds bounds_{};
         std::vector<std::unique_ptr<buffer_base>> holded_buffers_{};
     };
 
@@ -585,6 +1421,35 @@ namespace glwrap
             }
         };
 
+        template <>
+        struct attrib_format_helper<half> : arithmetic_attrib_format_helper<half>
+        {
+        };
+
+        template <glm::length_t L, typename T, bool Normalized>
+        struct attrib_format_helper<packed_vec<L, T, Normalized>>
+        {
+            static_assert(sizeof(packed_vec<L, T, Normalized>) == L * sizeof(T), "packed_vec must not be padded");
+
+            static int run(vertex_array &varray, int attrib_index, int buffer_index, int offset)
+            {
+                varray.enable_attrib(attrib_index);
+                varray.attrib_format(attrib_index, buffer_index, L, gl_type_traits<T>::type, Normalized ? GL_TRUE : GL_FALSE, offset);
+                return attrib_index + 1;
+            }
+        };
+
+        template <>
+        struct attrib_format_helper<snorm_2_10_10_10>
+        {
+            static int run(vertex_array &varray, int attrib_index, int buffer_index, int offset)
+            {
+                varray.enable_attrib(attrib_index);
+                varray.attrib_format(attrib_index, buffer_index, 4, GL_INT_2_10_10_10_REV, GL_TRUE, offset);
+                return attrib_index + 1;
+            }
+        };
+
         inline int tuple_attrib_format_iter(vertex_array &, int attrib_index, int, int) { return attrib_index; }
 
         template <typename T, typename... Rest>
@@ -656,6 +1521,22 @@ namespace glwrap
         return varray;
     }
 
+    template <typename... VertexBuffers>
+    auto auto_vertex_array(any_index_buffer &ibuffer, VertexBuffers &&...vbuffers)
+    {
+        auto varray = vertex_array(ibuffer, std::forward<VertexBuffers>(vbuffers)...);
+        details::auto_attrib_formats<VertexBuffers...>(varray);
+        return varray;
+    }
+
+    template <typename... VertexBuffers>
+    auto auto_vertex_array(any_index_buffer &&moved_ibuffer, VertexBuffers &&...vbuffers)
+    {
+        auto varray = vertex_array(std::move(moved_ibuffer), std::forward<VertexBuffers>(vbuffers)...);
+        details::auto_attrib_formats<VertexBuffers...>(varray);
+        return varray;
+    }
+
     // ----------------- shaders -------------------------
 
     enum class shader_type : GLenum
@@ -693,11 +1574,12 @@ namespace glwrap
             std::swap(handle_, other.handle_);
         }
 
-        static shader compile(std::string const &str, shader_type type)
+        static shader compile(std::string_view str, shader_type type)
         {
             GLuint handle = glCreateShader(static_cast<GLenum>(type));
             const char *const p_char = str.data();
-            glShaderSource(handle, 1, &p_char, nullptr);
+            const GLint length = static_cast<GLint>(str.size());
+            glShaderSource(handle, 1, &p_char, &length);
             glCompileShader(handle);
             int success;
             glGetShaderiv(handle, GL_COMPILE_STATUS, &success);
@@ -715,15 +1597,8 @@ namespace glwrap
         {
             try
             {
-                std::ifstream f(path);
-                if (!f)
-                    throw std::invalid_argument("Open file " + path.string() + " failed");
-                f.seekg(0, std::ios_base::end);
-                auto size = f.tellg();
-                f.seekg(0, std::ios_base::beg);
-                std::string text(size, '\0');
-                f.read(text.data(), size);
-                return compile(text, type);
+                auto file = mapped_file{path};
+                return compile(file.text(), type);
             }
             catch (std::exception &e)
             {
@@ -1000,6 +1875,18 @@ namespace glwrap
             return u;
         }
 
+        // Points the uniform block named name at binding, see typed_uniform_buffer::bind_base.
+        void uniform_block_binding(std::string_view name, GLuint binding) const
+        {
+            auto index = glGetUniformBlockIndex(handle_, std::string(name).c_str());
+            if (index == GL_INVALID_INDEX)
+            {
+                std::cout << std::format("Cannot find uniform block \"{}\"", name) << std::endl;
+                return;
+            }
+            glUniformBlockBinding(handle_, index, binding);
+        }
+
         GLuint handle() const noexcept { return handle_; }
 
     private:
@@ -1108,6 +1995,15 @@ namespace glwrap
         srgb,
         srgba,
         grey,
+        // block compressed, u8 only, see bcn.hpp
+        bc1,
+        bc1_srgb,
+        bc3,
+        bc3_srgb,
+        bc4,
+        bc5,
+        bc7,
+        bc7_srgb,
     };
 
     enum class texture2d_elem_type : GLenum
@@ -1117,6 +2013,86 @@ namespace glwrap
         f32,
     };
 
+    /*! \brief A persistently mapped GL_PIXEL_UNPACK_BUFFER used as a ring for asynchronous texture uploads.
+     *         Pixels are copied into the ring and the texture copy is queued from the buffer, so glTextureSubImage*
+     *         returns without waiting for the driver to copy client memory. Every submission is fenced and its region
+     *         of the ring is only reused once the GPU has consumed it. Images larger than the ring go in row bands.
+     *         The texture can be used by later GL commands right away; tickets only tell when the copy itself is done.
+     */
+    class upload_ring final
+    {
+    public:
+        using ticket = uint64_t;
+
+        static constexpr size_t default_capacity = 64 << 20;
+
+        explicit upload_ring(size_t capacity = default_capacity);
+
+        upload_ring(upload_ring const &) = delete;
+        upload_ring(upload_ring &&other) noexcept { swap(other); }
+        upload_ring &operator=(upload_ring const &) = delete;
+        upload_ring &operator=(upload_ring &&other) noexcept
+        {
+            swap(other);
+            return *this;
+        }
+
+        ~upload_ring();
+
+        void swap(upload_ring &other) noexcept
+        {
+            std::swap(handle_, other.handle_);
+            std::swap(mapped_, other.mapped_);
+            std::swap(capacity_, other.capacity_);
+            std::swap(head_, other.head_);
+            std::swap(in_flight_, other.in_flight_);
+            std::swap(submitted_, other.submitted_);
+            std::swap(completed_, other.completed_);
+        }
+
+        // Queue pixels (tightly packed rows, format/type as for glTextureSubImage*) into a level of texture.
+        // layer < 0 targets a 2D texture, otherwise the array layer or cube face.
+        ticket upload(GLuint texture, GLint level, GLint layer, GLsizei width, GLsizei height, GLenum format, GLenum type, std::span<std::byte const> pixels);
+
+        // Same for block compressed data, internal_format is the compressed format of the texture storage.
+        ticket upload_compressed(GLuint texture, GLint level, GLint layer, GLsizei width, GLsizei height, GLenum internal_format, std::span<std::byte const> blocks);
+
+        // Ticket of the last submission, everything queued so far is done once it completes.
+        ticket submitted() const noexcept { return submitted_; }
+
+        // Polls the fences without blocking.
+        bool is_complete(ticket t);
+
+        // Blocks until the GPU has consumed every submission up to t.
+        void wait(ticket t);
+
+        void wait_all() { wait(submitted_); }
+
+        size_t capacity() const noexcept { return capacity_; }
+
+    private:
+        struct region
+        {
+            size_t begin, end;
+            GLsync fence;
+            ticket id;
+        };
+
+        ticket upload_rows(GLuint texture, GLint level, GLint layer, GLsizei width, GLsizei height, GLenum format, GLenum type,
+                           std::span<std::byte const> data, size_t rows, GLsizei row_height);
+        size_t allocate(size_t size);
+        // Retires the oldest region if its fence signals within timeout, returns whether it did.
+        bool retire_oldest(GLuint64 timeout_ns);
+
+        GLuint handle_{0};
+        std::byte *mapped_{nullptr};
+        size_t capacity_{0};
+        size_t head_{0};
+        std::deque<region> in_flight_;
+        ticket submitted_{0};
+        ticket completed_{0};
+    };
+
     enum class image_bind_access : GLenum
     {
         read = GL_READ_ONLY,
@@ -1136,6 +2112,21 @@ namespace glwrap
         explicit texture2d(std::filesystem::path const &filename, bool srgb = false, texture2d_elem_type elem_type = texture2d_elem_type::u8,
                            texture2d_format format = texture2d_format::unspecified, GLenum wrap_mode = GL_REPEAT);
 
+        explicit texture2d(bitmap &bmp, bool srgb = false, texture2d_elem_type elem_type = texture2d_elem_type::u8,
+                           texture2d_format format = texture2d_format::unspecified, GLenum wrap_mode = GL_REPEAT);
+
+        // Uploads bmp as level 0 and mip_chain (e.g. from mipmap::build_chain) as levels 1.., no glGenerateTextureMipmap.
+        texture2d(bitmap const &bmp, std::span<bitmap const> mip_chain, bool srgb = false, GLenum wrap_mode = GL_REPEAT);
+
+        // Same, with the levels streamed through ring.
+        texture2d(bitmap const &bmp, std::span<bitmap const> mip_chain, upload_ring &ring, bool srgb = false, GLenum wrap_mode = GL_REPEAT);
+
+        // Uploads every baked mip level, no glGenerateTextureMipmap.
+        explicit texture2d(texture_container const &container, GLenum wrap_mode = GL_REPEAT);
+
+        // Same, with the levels streamed through ring.
+        texture2d(texture_container const &container, upload_ring &ring, GLenum wrap_mode = GL_REPEAT);
+
         texture2d(GLsizei width, GLsizei height, GLenum internal_format, GLenum format, GLenum type, GLenum wrap_mode, const void *data);
 
         texture2d(texture2d const &) = delete;
@@ -1182,6 +2173,9 @@ namespace glwrap
 
         void set_border_color(glm::vec4 const &color);
 
+        // Replaces a level with bmp (same size and channels as the level) through ring.
+        upload_ring::ticket upload(upload_ring &ring, bitmap const &bmp, GLint level = 0);
+
         GLuint handle() const noexcept
         {
             return handle_;
@@ -1192,6 +2186,8 @@ namespace glwrap
 
     private:
         texture2d() {}
+        texture2d(bitmap const &bmp, std::span<bitmap const> mip_chain, upload_ring *ring, bool srgb, GLenum wrap_mode);
+        texture2d(texture_container const &container, upload_ring *ring, GLenum wrap_mode);
 
         GLuint handle_{0};
         GLsizei width_{}, height_{};
@@ -1246,6 +2242,9 @@ namespace glwrap
 
         void set_border_color(glm::vec4 const &color);
 
+        // Replaces a level of one layer with bmp through ring.
+        upload_ring::ticket upload(upload_ring &ring, bitmap const &bmp, GLint layer, GLint level = 0);
+
         GLuint handle() const noexcept
         {
             return handle_;
@@ -1289,6 +2288,12 @@ namespace glwrap
 
         explicit cubemap(GLsizei size, GLenum internal_format = GL_RGBA16F, int mipmap_levels = 0);
 
+        // Uploads every baked mip level of the six faces, no glGenerateTextureMipmap.
+        explicit cubemap(texture_container const &container);
+
+        // Same, with the levels streamed through ring.
+        cubemap(texture_container const &container, upload_ring &ring);
+
         cubemap(cubemap &&other) noexcept
         {
             this->swap(other);
@@ -1319,6 +2324,9 @@ namespace glwrap
             glBindImageTexture(unit, handle_, level, GL_TRUE, 0, static_cast<GLenum>(access), internal_format_);
         }
 
+        // Replaces a level of one face (0..5, +X -X +Y -Y +Z -Z) with bmp through ring.
+        upload_ring::ticket upload(upload_ring &ring, bitmap const &bmp, GLint face, GLint level = 0);
+
         GLuint handle() { return handle_; }
 
         void swap(cubemap &other)
@@ -1329,6 +2337,7 @@ namespace glwrap
 
     private:
         cubemap();
+        cubemap(texture_container const &container, upload_ring *ring);
         GLenum internal_format_{};
         GLuint handle_{0};
     };
@@ -1445,8 +2454,28 @@ struct std::formatter<glwrap::texture2d_format>
             return std::format_to(out, "rgb");
         case glwrap::texture2d_format::rgba:
             return std::format_to(out, "rgba");
+        case glwrap::texture2d_format::srgb:
+            return std::format_to(out, "srgb");
+        case glwrap::texture2d_format::srgba:
+            return std::format_to(out, "srgba");
         case glwrap::texture2d_format::grey:
             return std::format_to(out, "grey");
+        case glwrap::texture2d_format::bc1:
+            return std::format_to(out, "bc1");
+        case glwrap::texture2d_format::bc1_srgb:
+            return std::format_to(out, "bc1_srgb");
+        case glwrap::texture2d_format::bc3:
+            return std::format_to(out, "bc3");
+        case glwrap::texture2d_format::bc3_srgb:
+            return std::format_to(out, "bc3_srgb");
+        case glwrap::texture2d_format::bc4:
+            return std::format_to(out, "bc4");
+        case glwrap::texture2d_format::bc5:
+            return std::format_to(out, "bc5");
+        case glwrap::texture2d_format::bc7:
+            return std::format_to(out, "bc7");
+        case glwrap::texture2d_format::bc7_srgb:
+            return std::format_to(out, "bc7_srgb");
         default:
             throw std::invalid_argument(std::format("Invalid texture2d_format type: {}", static_cast<int>(format)));
         }
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace utils
+{
+    // IEEE 754 binary16 conversions, round to nearest even; inf and NaN are preserved, tiny values become subnormals.
+    uint16_t float_to_half(float value) noexcept;
+    float half_to_float(uint16_t value) noexcept;
+
+    // Bulk conversions, 8 values per instruction with F16C when the CPU has it.
+    void floats_to_halves(float const *src, uint16_t *dst, size_t count) noexcept;
+    void halves_to_floats(uint16_t const *src, float *dst, size_t count) noexcept;
+}
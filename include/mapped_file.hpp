@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <string_view>
+
+/*! \brief Read-only memory mapping of a whole file.
+ *         The mapping stays valid for the lifetime of the object; empty files map to an empty span.
+ */
+class mapped_file final
+{
+public:
+    explicit mapped_file(std::filesystem::path const &path);
+    mapped_file(mapped_file const &) = delete;
+    mapped_file(mapped_file &&other) noexcept;
+    ~mapped_file();
+    mapped_file &operator=(mapped_file const &) = delete;
+    mapped_file &operator=(mapped_file &&other) noexcept;
+
+    std::byte const *data() const noexcept;
+    size_t size() const noexcept;
+    std::span<std::byte const> bytes() const noexcept;
+    std::string_view text() const noexcept;
+    std::filesystem::path const &path() const noexcept;
+
+    void swap(mapped_file &other) noexcept;
+
+private:
+    struct mapped_file_impl;
+    std::unique_ptr<mapped_file_impl> impl_;
+};
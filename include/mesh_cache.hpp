@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "mapped_file.hpp"
+#include "model.hpp"
+
+/*
+    Binary mesh cache written next to a model file (<model file>.meshcache).
+    Stores the final interleaved compact vertex streams, uint32 indices (all LODs), meshlets, LOD ranges, bounds, mesh names, texture bindings
+    and the node hierarchy,
+    so that a warm load can upload straight from the mapped file without running Assimp.
+
+    Layout (little-endian, every block 16-byte aligned):
+        header:         { char magic[8], u32 version, u32 vertex_size, u64 source_hash, u32 import_flags, u32 texture_types, u32 mesh_flags,
+                          u32 texture_count, u32 node_count, u32 mesh_count }
+        texture table:  { u32 name_length, u32 texture_type, name bytes }...
+        node table:     { u32 name_length, u32 parent, f32 local[16], name bytes }... (breadth-first, see transform_graph)
+        mesh table:     { u32 name_length, u32 node, u32 vertex_count, u32 index_count, u32 meshlet_count, u32 lod_count, u32 binding_count, bounds,
+                          { u32 texture_type, u32 texture_index }..., name bytes, vertices, indices, meshlets, lods }...
+    A cache is only used if magic, version and the whole cache_key match. The source hash covers the model file and the side files it
+    references (OBJ material libraries, external glTF buffers and images), so editing a material invalidates the cache too.
+ */
+
+namespace glwrap::mesh_cache
+{
+    inline constexpr uint32_t version = 9;
+
+    struct cache_key
+    {
+        uint64_t source_hash;
+        uint32_t import_flags;
+        uint32_t texture_types;
+        // load_flags that change the stored meshes
+        uint32_t mesh_flags;
+
+        bool operator==(cache_key const &) const = default;
+    };
+
+    struct texture_entry
+    {
+        std::string name;
+        texture_type role;
+    };
+
+    struct node_entry
+    {
+        std::string name;
+        uint32_t parent;
+        glm::mat4 local;
+    };
+
+    struct mesh_entry
+    {
+        std::string name;
+        // index into the node table
+        uint32_t node;
+        std::span<compact_vertex const> vertices;
+        std::span<uint32_t const> indices;
+        std::span<meshlets::meshlet const> meshlets;
+        std::span<mesh_lod const> lods;
+        glwrap::bounds bounds;
+        std::vector<std::pair<texture_type, uint32_t>> textures;
+    };
+
+    inline constexpr uint64_t hash_seed = 0xcbf29ce484222325ull;
+
+    // FNV-1a, 64 bit; pass the previous hash as seed to continue it
+    uint64_t hash_bytes(std::span<std::byte const> bytes, uint64_t seed = hash_seed) noexcept;
+
+    // Hash of the model file bytes and of every side file it references, relative to the model's directory.
+    // Missing side files only contribute their name, so the cache is invalidated once they appear.
+    uint64_t hash_sources(std::filesystem::path const &model_path, std::span<std::byte const> bytes);
+
+    std::filesystem::path cache_path_for(std::filesystem::path const &model_path);
+
+    class cache_view final
+    {
+    public:
+        // Returns std::nullopt if the cache file does not exist, is corrupted or was written for another key.
+        static std::optional<cache_view> open(std::filesystem::path const &path, cache_key const &key);
+
+        std::vector<texture_entry> const &textures() const noexcept { return textures_; }
+        std::vector<node_entry> const &nodes() const noexcept { return nodes_; }
+        std::vector<mesh_entry> const &meshes() const noexcept { return meshes_; }
+
+    private:
+        explicit cache_view(mapped_file &&file) : file_{std::move(file)} {}
+
+        mapped_file file_;
+        std::vector<texture_entry> textures_;
+        std::vector<node_entry> nodes_;
+        std::vector<mesh_entry> meshes_;
+    };
+
+    // Writes to a temporary file first and renames it, so a crashed write never leaves a half cache behind.
+    void write(std::filesystem::path const &path, cache_key const &key,
+               std::span<texture_entry const> textures, std::span<node_entry const> nodes, std::span<mesh_entry const> meshes);
+}
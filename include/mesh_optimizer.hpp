@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <format>
+#include <span>
+#include <vector>
+
+#include "model.hpp"
+
+/*
+    Offline reordering of imported meshes, run once per import (the mesh cache stores the result):
+        1. Tipsify (Sander, Nehab, Barczak 2007) reorders triangles for the post-transform vertex cache,
+           and splits the result into clusters wherever it has to jump to a dead-end vertex.
+        2. Clusters are sorted by how much they face away from the mesh center, so outer surfaces are
+           drawn before the ones they hide. Kept only if the cache efficiency stays within a threshold.
+        3. Vertices are renumbered in first-use order so vertex fetch walks the buffer linearly.
+ */
+
+namespace glwrap::mesh_optimizer
+{
+    inline constexpr uint32_t default_cache_size = 16;
+
+    struct cache_stats
+    {
+        size_t triangles;
+        size_t vertices;
+        size_t misses;
+
+        // average cache miss ratio: transformed vertices per triangle, 0.5 at best for large meshes, 3 at worst
+        float acmr() const noexcept { return triangles > 0 ? static_cast<float>(misses) / triangles : 0.0f; }
+        // average transform to vertex ratio, 1 at best
+        float atvr() const noexcept { return vertices > 0 ? static_cast<float>(misses) / vertices : 0.0f; }
+
+        cache_stats &operator+=(cache_stats const &other) noexcept
+        {
+            triangles += other.triangles;
+            vertices += other.vertices;
+            misses += other.misses;
+            return *this;
+        }
+    };
+
+    // Simulates a FIFO post-transform cache of cache_size entries over a triangle list.
+    cache_stats analyze_vertex_cache(std::span<uint32_t const> indices, size_t vertex_count, uint32_t cache_size = default_cache_size);
+
+    // Returns the reordered triangle list, and the first index of every cluster in clusters (if given).
+    // Indices past the last whole triangle are dropped.
+    std::vector<uint32_t> tipsify(std::span<uint32_t const> indices, size_t vertex_count, uint32_t cache_size = default_cache_size,
+                                  std::vector<size_t> *clusters = nullptr);
+
+    // Sorts clusters of a tipsified list, keeps the input order if the ACMR grows by more than threshold.
+    std::vector<uint32_t> optimize_overdraw(std::span<uint32_t const> indices, std::span<size_t const> clusters, std::span<vertex const> vertices,
+                                            float threshold = 1.05f, uint32_t cache_size = default_cache_size);
+
+    // Renumbers vertices in first-use order and drops unreferenced ones, indices are rewritten in place.
+    std::vector<vertex> optimize_vertex_fetch(std::span<vertex const> vertices, std::span<uint32_t> indices);
+
+    struct report
+    {
+        cache_stats before;
+        cache_stats after;
+    };
+
+    // Runs all three passes.
+    report optimize(std::vector<vertex> &vertices, std::vector<uint32_t> &indices, uint32_t cache_size = default_cache_size);
+}
+
+template <>
+struct std::formatter<glwrap::mesh_optimizer::cache_stats>
+{
+    constexpr auto parse(std::format_parse_context &ctx)
+    {
+        return ctx.begin();
+    }
+
+    auto format(glwrap::mesh_optimizer::cache_stats const &stats, std::format_context &ctx) const
+    {
+        return std::format_to(ctx.out(), "ACMR {:.3f}, ATVR {:.3f}", stats.acmr(), stats.atvr());
+    }
+};
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "model.hpp"
+
+/*
+    Quadric error metric simplification (Garland, Heckbert 1997) for LOD chains built at import time.
+    Edges are collapsed onto one of their existing vertices, so every LOD indexes the vertex buffer of the full mesh
+    and only adds an index range. Vertices on open borders and attribute seams (uv or normal splits, which look like
+    borders to the index topology) are never moved, so LODs keep their silhouette and do not crack along seams.
+    Each pass collapses the cheapest edges whose neighbourhoods do not overlap, rejecting collapses that flip a triangle.
+ */
+
+namespace glwrap::mesh_simplifier
+{
+    inline constexpr size_t default_lod_count = 4;
+
+    // Returns a triangle list of at most target_index_count indices into vertices, or the closest it can get.
+    // result_error receives the geometric deviation of the result from the input, in model units.
+    std::vector<uint32_t> simplify(std::span<vertex const> vertices, std::span<uint32_t const> indices, size_t target_index_count,
+                                   float *result_error = nullptr);
+
+    // Appends up to lod_count - 1 coarser triangle lists to indices, each with about reduction times the triangles of the
+    // previous one. Stops early once a level barely shrinks. The first returned LOD is the original list.
+    std::vector<mesh_lod> build_lods(std::span<vertex const> vertices, std::vector<uint32_t> &indices, size_t lod_count = default_lod_count,
+                                     float reduction = 0.5f);
+}
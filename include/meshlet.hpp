@@ -0,0 +1,125 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <format>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "glwrap.hpp"
+
+/*
+    Meshlets: clusters of at most 64 vertices and 124 triangles, cut from the final triangle order of a mesh
+    (after mesh_optimizer, so neighbouring triangles are already close together). Every meshlet is a contiguous
+    range of the mesh's index buffer with a bounding sphere and a normal cone, which lets whole clusters be dropped:
+        - off-screen:  the sphere lies outside one of the frustum planes
+        - back-facing: dot(center - eye, cone_axis) >= cone_cutoff * |center - eye| + radius
+    The culler runs these tests on the CPU or in shaders/compute/meshlet_cull.glsl, and draws the surviving
+    meshlets with a single glMultiDrawElementsIndirect per mesh.
+ */
+
+namespace glwrap
+{
+    struct vertex;
+    class mesh;
+}
+
+namespace glwrap::meshlets
+{
+    inline constexpr size_t max_vertices = 64;
+    inline constexpr size_t max_triangles = 124;
+
+    // std430 layout, mirrored in shaders/compute/meshlet_cull.glsl
+    struct meshlet
+    {
+        glm::vec3 center;
+        float radius;
+        glm::vec3 cone_axis;
+        // 1 if the triangle normals spread too far for the cluster to ever face away as a whole
+        float cone_cutoff;
+        uint32_t first_index;
+        uint32_t index_count;
+        uint32_t vertex_count;
+        uint32_t padding;
+    };
+    static_assert(sizeof(meshlet) == 48, "meshlet must match the std430 layout of the culling shader");
+
+    // Splits the triangle list in order, starting a new meshlet whenever one of the limits would be exceeded.
+    std::vector<meshlet> build(std::span<vertex const> vertices, std::span<uint32_t const> indices);
+
+    // Planes of the clip volume of matrix, in the space matrix transforms from. Normals point inwards.
+    std::array<glm::vec4, 6> frustum_planes(glm::mat4 const &matrix) noexcept;
+
+    enum class cull_mode
+    {
+        // draw whole meshes
+        none,
+        cpu,
+        gpu,
+    };
+
+    struct cull_params
+    {
+        cull_mode mode = cull_mode::gpu;
+        // enables the normal cone test that culls back-facing meshlets; set to false for passes drawn without face culling
+        bool backfaces = true;
+        // grows every bounding sphere, for vertex or geometry shaders that move vertices
+        float radius_padding = 0.0f;
+    };
+
+    bool is_visible(meshlet const &m, std::span<glm::vec4 const, 6> planes, glm::vec3 eye, cull_params const &params) noexcept;
+
+    class culler final
+    {
+    public:
+        struct statistics
+        {
+            size_t meshlets;
+            // only counted by cpu culling (and cull_mode::none), the gpu pass is never read back
+            size_t visible;
+        };
+
+        culler();
+        culler(culler const &) = delete;
+        culler &operator=(culler const &) = delete;
+
+        // model_view_projection and eye are both in the model space of the mesh.
+        // Meshes without meshlets are drawn whole. The current program is restored after the gpu pass.
+        void draw(mesh &m, glm::mat4 const &model_view_projection, glm::vec3 eye, cull_params const &params = {});
+
+        statistics stats() const noexcept { return stats_; }
+        void reset_stats() noexcept { stats_ = {}; }
+
+    private:
+        void reserve(size_t command_count);
+
+        shader_program program_;
+        shader_uniform meshlet_count_;
+        shader_uniform frustum_planes_;
+        shader_uniform eye_;
+        shader_uniform cull_backfaces_;
+        shader_uniform radius_padding_;
+        shader_uniform first_index_;
+        shader_uniform base_vertex_;
+
+        std::optional<indirect_buffer<draw_elements_indirect_command>> commands_;
+        storage_buffer<GLuint> counter_{1};
+        std::vector<draw_elements_indirect_command> staging_;
+        statistics stats_{};
+    };
+}
+
+template <>
+struct std::formatter<glwrap::meshlets::culler::statistics>
+{
+    constexpr auto parse(std::format_parse_context &ctx)
+    {
+        return ctx.begin();
+    }
+
+    auto format(glwrap::meshlets::culler::statistics const &stats, std::format_context &ctx) const
+    {
+        return std::format_to(ctx.out(), "{} of {} meshlets visible", stats.visible, stats.meshlets);
+    }
+};
@@ -1,17 +1,36 @@
 #pragma once
 
-#include "glm/glm.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
 
-namespace mikkt
-{
-    namespace details
-    {
-        template <typename T>
-        inline constexpr const T pi = static_cast<T>(3.1415926535897932384626433832795);
-    }
+#include "glm/glm.hpp"
+#include "parallel.hpp"
 
-    using glm::vec3;
+/*
+    Tangent generation following MikkTSpace (Mikkelsen 2008), the convention glTF and most bakers expect:
+        - vertices are welded when position, normal and texcoords are identical, so split vertices of an
+          unindexed or per-face mesh still share one tangent
+        - every triangle contributes its texture space u direction, normalized and flipped for mirrored uvs,
+          projected onto the tangent plane of the vertex normal and weighted by the corner angle
+        - faces with mirrored and non-mirrored uvs never share a tangent, such vertices are split
+        - the bitangent is cross(normal, tangent) * sign, sign being -1 on mirrored faces
+    Defaults of the reference implementation are assumed (180 degree angular threshold, so all faces of a vertex
+    with the same orientation are merged). Disconnected fans around one welded vertex are not separated.
+    Triangles without area in position or texture space only receive tangents, they do not contribute any.
+ */
 
+namespace glwrap
+{
+    struct vertex;
+}
 
+namespace mikkt
+{
+    // triangles per work item, smaller meshes run on the calling thread only
+    inline constexpr size_t triangles_per_task = 4096;
 
+    // Rewrites tangent and bitangent of every vertex. Vertices are welded and split as described above,
+    // so vertices and indices are replaced by the result; unreferenced vertices are dropped.
+    void generate_tangents(std::vector<glwrap::vertex> &vertices, std::vector<uint32_t> &indices, size_t max_workers = utils::worker_count());
 }
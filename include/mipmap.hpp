@@ -0,0 +1,42 @@
+#pragma once
+
+#include <span>
+#include <vector>
+
+#include "bitmap.hpp"
+
+namespace mipmap
+{
+    enum class filter
+    {
+        // 2x2 average
+        box,
+        // 6-tap Kaiser-windowed sinc, sharper than box with less aliasing
+        kaiser,
+    };
+
+    enum class instruction_set
+    {
+        scalar,
+        sse,
+        // AVX2 + FMA
+        avx2,
+        // best set supported by the running CPU
+        best,
+    };
+
+    // Best instruction set supported by the running CPU, never returns instruction_set::best.
+    instruction_set detected_instruction_set() noexcept;
+
+    // Number of levels of a full chain down to 1x1, level 0 included.
+    int level_count(int width, int height) noexcept;
+
+    /*! \brief Build mip levels 1 .. level_count - 1 of source (u8, u16 or f32, any channel count).
+     *         Levels are filtered from a float copy of the previous level, so rounding does not accumulate down the chain;
+     *         level 1 is filtered from the source in row bands, so no float copy of the full-resolution source is made.
+     *         With srgb set, the color channels of u8 rgb/rgba bitmaps are linearized through a LUT and filtered in linear space; alpha stays linear.
+     *         A requested instruction set the CPU does not support falls back to the best supported one.
+     */
+    std::vector<bitmap> build_chain(bitmap const &source, bool srgb, filter f = filter::box,
+                                    instruction_set isa = instruction_set::best);
+}
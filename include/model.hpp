@@ -3,8 +3,11 @@
 #include <memory>
 #include <string>
 #include <filesystem>
+#include <span>
 
 #include "glwrap.hpp"
+#include "meshlet.hpp"
+#include "transform_graph.hpp"
 
 namespace glwrap
 {
@@ -18,6 +21,53 @@ namespace glwrap
         glm::vec3 bitangent;
     };
 
+    // Vertex layout of model meshes, 20 bytes instead of the 56 of vertex: half positions and texcoords, normal and
+    // tangent as snorm 10:10:10. The tangent's w holds the bitangent sign, shaders rebuild it as cross(normal, tangent) * w.
+    struct compact_vertex final
+    {
+        using vertex_desc_t = std::tuple<half_vec<4>, snorm_2_10_10_10, half_vec<2>, snorm_2_10_10_10>;
+        half_vec<4> position;
+        snorm_2_10_10_10 normal;
+        half_vec<2> texcoords;
+        snorm_2_10_10_10 tangent;
+
+        static compact_vertex pack(vertex const &v) noexcept;
+    };
+    static_assert(sizeof(compact_vertex) == 20, "compact_vertex must be tightly packed");
+
+    // Index range of one level of detail in the index buffer of a mesh, all levels share the vertex buffer.
+    struct mesh_lod final
+    {
+        uint32_t first_index;
+        uint32_t index_count;
+        // geometric deviation from the full mesh, in model units
+        float error;
+    };
+
+    // Where a mesh lives in the buffers of mesh::get_vbuffer and mesh::get_ibuffer
+    struct draw_range final
+    {
+        uint32_t first_index;
+        uint32_t index_count;
+        int32_t base_vertex;
+    };
+
+    // Picks the coarsest LOD whose error, projected to the screen, stays within threshold pixels.
+    // pixels_per_unit is the on-screen size of one model unit at distance 1: projection[1][1] * viewport_height / 2 * model scale.
+    inline size_t select_lod(std::span<mesh_lod const> lods, float distance, float pixels_per_unit, float threshold = 1.0f) noexcept
+    {
+        size_t selected = 0;
+        for (size_t i = 1; i < lods.size(); ++i)
+        {
+            if (lods[i].error * pixels_per_unit > threshold * distance)
+            {
+                break;
+            }
+            selected = i;
+        }
+        return selected;
+    }
+
     enum class texture_type
     {
         none = 0,
@@ -61,6 +111,43 @@ namespace glwrap
         }
     }
 
+    enum class load_flags
+    {
+        none = 0,
+        // decode all textures of the model on worker threads, only GL uploads stay on the calling thread
+        parallel_textures = 0x01,
+        // keep a binary cache of the imported meshes next to the model file, warm loads skip Assimp entirely
+        mesh_cache = 0x02,
+        // upload file textures from pre-baked containers with the full mip chain (baked on first load)
+        baked_textures = 0x04,
+        // block compress baked textures: BC1/BC7 for diffuse, BC5 for normal maps (shaders reconstruct z), BC4 for single-channel maps
+        compressed_textures = 0x08,
+        // reorder triangles and vertices of imported meshes for the post-transform cache, overdraw and vertex fetch
+        optimize_meshes = 0x10,
+        // split imported meshes into meshlets with bounds and normal cones, for meshlets::culler
+        meshlets = 0x20,
+        // append simplified LODs to the index buffers of imported meshes, see mesh::get_lods
+        lods = 0x40,
+        // pack all meshes into one vertex and one index buffer behind a single vertex array, see mesh::get_range
+        shared_arena = 0x80,
+        // convert and process imported meshes on worker threads, GL objects are still created on the calling thread
+        parallel_meshes = 0x100,
+    };
+
+    constexpr load_flags operator|(load_flags a, load_flags b)
+    {
+        return static_cast<load_flags>(static_cast<std::underlying_type_t<load_flags>>(a) | static_cast<std::underlying_type_t<load_flags>>(b));
+    }
+
+    constexpr load_flags operator&(load_flags a, load_flags b)
+    {
+        return static_cast<load_flags>(static_cast<std::underlying_type_t<load_flags>>(a) & static_cast<std::underlying_type_t<load_flags>>(b));
+    }
+
+    inline constexpr load_flags default_load_flags = load_flags::parallel_textures | load_flags::mesh_cache | load_flags::baked_textures | load_flags::compressed_textures |
+                                                     load_flags::optimize_meshes | load_flags::meshlets |
+                                                     load_flags::parallel_meshes;
+
     class mesh
     {
     public:
@@ -73,9 +160,25 @@ namespace glwrap
         bool has_texture(texture_type) const noexcept;
         texture2d &get_texture(texture_type);
 
-        vertex_buffer<vertex> &get_vbuffer() noexcept;
-        index_buffer<uint32_t> &get_ibuffer() noexcept;
+        // With load_flags::shared_arena these are shared by all meshes of the model, draw through draw() or get_range() then
+        vertex_buffer<compact_vertex> &get_vbuffer() noexcept;
+        any_index_buffer &get_ibuffer() noexcept;
         vertex_array &get_varray() noexcept;
+        // the full mesh (LOD 0)
+        draw_range get_range() const noexcept;
+        // get_range() as a command for vertex_array::multi_draw_indirect on the shared arena
+        draw_elements_indirect_command draw_command(GLuint instance_count = 1, GLuint base_instance = 0) const noexcept;
+        void draw(draw_mode mode = draw_mode::triangles);
+        // empty if the model was loaded without load_flags::meshlets
+        std::span<meshlets::meshlet const> get_meshlets() const noexcept;
+        buffer<meshlets::meshlet> &get_meshlet_buffer();
+        // LOD 0 is the full mesh, a single entry without load_flags::lods. Index ranges are relative to get_range().first_index
+        std::span<mesh_lod const> get_lods() const noexcept;
+        // in the local space of the mesh's node, computed at import
+        glwrap::bounds const &bounds() const noexcept;
+        // node of the model's transform graph this mesh instance hangs off, and its current world matrix
+        uint32_t node() const noexcept;
+        glm::mat4 const &transform() const;
 
     private:
         friend class model;
@@ -92,8 +195,16 @@ namespace glwrap
         ~model();
         model &operator=(model &&other) noexcept;
         model &operator=(model const &) = delete;
-        static model load_file(std::filesystem::path const &path, texture_type texture_types);
+        static model load_file(std::filesystem::path const &path, texture_type texture_types, load_flags flags = default_load_flags);
         std::vector<mesh> &meshes();
+        // every mesh without binding textures, one glMultiDrawElementsBaseVertex with load_flags::shared_arena.
+        // Node transforms are not applied, loop over meshes() with mesh::transform() for models that have them.
+        void draw(draw_mode mode = draw_mode::triangles);
+        // all meshes together in model space, with the node transforms at load time
+        glwrap::bounds const &bounds() const noexcept;
+        // the node hierarchy of the imported file, call update() after changing local matrices
+        transform_graph &nodes() noexcept;
+        transform_graph const &nodes() const noexcept;
 
     private:
         friend class mesh;
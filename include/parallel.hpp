@@ -0,0 +1,165 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace utils
+{
+    inline size_t worker_count() noexcept
+    {
+        auto n = std::thread::hardware_concurrency();
+        return n > 0 ? n : 4;
+    }
+
+    /*! \brief Run func(i) for every i in [0, count) on worker threads.
+     *         The calling thread also takes items. The first exception thrown by func is rethrown after all workers finish.
+     */
+    template <typename Func>
+    void parallel_for(size_t count, Func &&func, size_t max_workers = worker_count())
+    {
+        if (count == 0)
+        {
+            return;
+        }
+        auto workers = std::min(count, std::max<size_t>(max_workers, 1));
+        if (workers == 1)
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                func(i);
+            }
+            return;
+        }
+
+        std::atomic<size_t> next{0};
+        std::exception_ptr error;
+        std::mutex error_mutex;
+        auto run = [&]()
+        {
+            for (auto i = next++; i < count; i = next++)
+            {
+                try
+                {
+                    func(i);
+                }
+                catch (...)
+                {
+                    std::lock_guard lock(error_mutex);
+                    if (!error)
+                    {
+                        error = std::current_exception();
+                    }
+                    next = count;
+                }
+            }
+        };
+
+        {
+            std::vector<std::jthread> threads;
+            threads.reserve(workers - 1);
+            for (size_t i = 1; i < workers; ++i)
+            {
+                threads.emplace_back(run);
+            }
+            run();
+        }
+
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+    }
+
+    /*! \brief Run produce(i) for every i in [0, count) on worker threads, and hand each result to consume(i, result)
+     *         on the calling thread as soon as it is ready (in completion order, not index order).
+     *         Useful when the results must be consumed on the GL thread, e.g. decode on workers, upload on the caller.
+     */
+    template <typename Produce, typename Consume>
+    void parallel_produce(size_t count, Produce &&produce, Consume &&consume, size_t max_workers = worker_count())
+    {
+        using result_t = std::invoke_result_t<Produce &, size_t>;
+
+        if (count == 0)
+        {
+            return;
+        }
+
+        std::mutex mutex;
+        std::condition_variable ready_cv;
+        std::deque<std::pair<size_t, result_t>> ready;
+        std::exception_ptr error;
+        std::atomic<size_t> next{0};
+
+        auto run = [&]()
+        {
+            for (auto i = next++; i < count; i = next++)
+            {
+                try
+                {
+                    auto result = produce(i);
+                    std::lock_guard lock(mutex);
+                    ready.emplace_back(i, std::move(result));
+                }
+                catch (...)
+                {
+                    std::lock_guard lock(mutex);
+                    if (!error)
+                    {
+                        error = std::current_exception();
+                    }
+                    next = count;
+                }
+                ready_cv.notify_one();
+            }
+        };
+
+        auto workers = std::min(count, std::max<size_t>(max_workers, 1));
+        std::vector<std::jthread> threads;
+        threads.reserve(workers);
+        for (size_t i = 0; i < workers; ++i)
+        {
+            threads.emplace_back(run);
+        }
+
+        size_t consumed = 0;
+        try
+        {
+            while (consumed < count)
+            {
+                std::optional<std::pair<size_t, result_t>> item;
+                {
+                    std::unique_lock lock(mutex);
+                    ready_cv.wait(lock, [&]() { return !ready.empty() || error; });
+                    if (error)
+                    {
+                        break;
+                    }
+                    item.emplace(std::move(ready.front()));
+                    ready.pop_front();
+                }
+                consume(item->first, std::move(item->second));
+                ++consumed;
+            }
+        }
+        catch (...)
+        {
+            next = count;
+            throw;
+        }
+
+        threads.clear();
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+    }
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <compare>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include "glwrap.hpp"
+
+/*
+    Process-wide registry of textures loaded from files, so models and examples that use the same image
+    share one GPU texture. Entries are keyed by the canonical path plus every parameter that changes the
+    uploaded texture, and are held weakly: a texture is released as soon as its last user drops it.
+    Textures are created on the calling thread, which must own the GL context.
+ */
+
+namespace glwrap
+{
+    struct texture_key
+    {
+        std::filesystem::path path;
+        bool srgb{false};
+        texture2d_format format{texture2d_format::unspecified};
+        texture2d_elem_type elem_type{texture2d_elem_type::u8};
+        GLenum wrap_mode{GL_REPEAT};
+        // other load parameters of the creator, e.g. model load flags and texture usage
+        uint32_t variant{0};
+
+        auto operator<=>(texture_key const &) const = default;
+    };
+
+    class texture_cache final
+    {
+    public:
+        struct statistics
+        {
+            size_t hits;
+            size_t misses;
+            size_t live;
+        };
+
+        static texture_cache &instance();
+
+        // Same parameters as the texture2d file constructor.
+        std::shared_ptr<texture2d> load(std::filesystem::path const &path, bool srgb = false, texture2d_elem_type elem_type = texture2d_elem_type::u8,
+                                        texture2d_format format = texture2d_format::unspecified, GLenum wrap_mode = GL_REPEAT);
+
+        // key.path is canonicalized. Returns nullptr (and counts a miss) if no live texture matches.
+        std::shared_ptr<texture2d> find(texture_key key);
+
+        // Registers a texture created by the caller, replacing an expired entry.
+        std::shared_ptr<texture2d> insert(texture_key key, texture2d &&texture);
+
+        statistics stats() const;
+        void reset_stats();
+
+    private:
+        texture_cache() = default;
+
+        static void canonicalize(texture_key &key);
+        std::shared_ptr<texture2d> find_locked(texture_key const &key);
+
+        mutable std::mutex mutex_;
+        std::map<texture_key, std::weak_ptr<texture2d>> entries_;
+        size_t hits_{0};
+        size_t misses_{0};
+    };
+}
+
+template <>
+struct std::formatter<glwrap::texture_cache::statistics>
+{
+    constexpr auto parse(std::format_parse_context &ctx)
+    {
+        return ctx.begin();
+    }
+
+    auto format(glwrap::texture_cache::statistics const &stats, std::format_context &ctx) const
+    {
+        return std::format_to(ctx.out(), "{} hits, {} misses, {} live textures", stats.hits, stats.misses, stats.live);
+    }
+};
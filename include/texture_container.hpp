@@ -0,0 +1,112 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "bcn.hpp"
+#include "bitmap.hpp"
+#include "mipmap.hpp"
+
+class mapped_file;
+
+/*
+    Pre-baked texture container (<source file>.lgltex), a small KTX2-like format.
+    Stores every mip level of one (2D) or six (cubemap) faces, already filtered and optionally block compressed,
+    so that loading is a file mapping plus one upload per level: no image decode and no glGenerateTextureMipmap.
+
+    Layout (little-endian):
+        header
+        level table: { u64 offset, u64 size, u32 width, u32 height } for face 0 level 0..n-1, face 1 level 0..n-1, ...
+        level data, 16-byte aligned: tightly packed rows, or 4x4 blocks in row-major block order when compressed
+ */
+class texture_container final
+{
+public:
+    static constexpr uint32_t version = 2;
+
+    struct bake_options
+    {
+        // filter the color channels in linear space, the texture gets an sRGB internal format
+        bool srgb{false};
+        bool flip_vertically{false};
+        mipmap::filter mip_filter{mipmap::filter::box};
+        // block compress every level of u8 images, the format is picked by bcn::choose_format() from channels and usage
+        bool compress{false};
+        bcn::texture_usage usage{bcn::texture_usage::color};
+
+        bool operator==(bake_options const &) const = default;
+    };
+
+    struct level_view
+    {
+        int width;
+        int height;
+        std::span<std::byte const> data;
+    };
+
+    // Maps a baked file, throws std::runtime_error if it is not a valid container.
+    static texture_container load(std::filesystem::path const &path);
+
+    // Bake the full mip chain of every face into path, faces must have the same size and format.
+    static void bake(std::filesystem::path const &path, std::span<bitmap const> faces, bake_options const &options);
+
+    /*! \brief First-run baking: load the container next to source if it is up to date, otherwise decode source, bake and load it.
+     *         A container is stale if it is older than the source or was baked with different options.
+     */
+    static texture_container load_or_bake(std::filesystem::path const &source, bake_options const &options);
+
+    // Same as load_or_bake for the six faces of a cubemap (+x, -x, +y, -y, +z, -z), baked into one container.
+    static texture_container load_or_bake_cubemap(std::array<std::filesystem::path, 6> const &faces,
+                                                  std::filesystem::path const &container_path, bake_options const &options);
+
+    // Faces named like the cubemap folder constructor (right, left, top, bottom, front, back + file_ext), baked into folder/cubemap<file_ext>.lgltex.
+    static texture_container load_or_bake_cubemap(std::filesystem::path const &folder, std::string const &file_ext, bake_options const &options);
+
+    static std::filesystem::path baked_path_for(std::filesystem::path const &source);
+
+    int width() const noexcept { return width_; }
+    int height() const noexcept { return height_; }
+    int levels() const noexcept { return levels_; }
+    int faces() const noexcept { return faces_; }
+    bool srgb() const noexcept { return options_.srgb; }
+    bake_options const &options() const noexcept { return options_; }
+    bitmap_channel channels() const noexcept { return channels_; }
+    bitmap_internal_format internal_format() const noexcept { return internal_format_; }
+    bcn::block_format block_format() const noexcept { return block_format_; }
+    bool compressed() const noexcept { return block_format_ != bcn::block_format::none; }
+
+    // Raw bytes of one level, pixels or compressed blocks.
+    level_view level(int level, int face = 0) const;
+
+    // Zero-copy view of one uncompressed level, the bitmap keeps the mapping alive.
+    bitmap image(int level, int face = 0) const;
+
+private:
+    struct level_entry
+    {
+        uint64_t offset;
+        uint64_t size;
+        uint32_t width;
+        uint32_t height;
+    };
+
+    texture_container() = default;
+
+    level_entry const &entry(int level, int face) const;
+
+    std::shared_ptr<mapped_file const> file_;
+    std::vector<level_entry> entries_;
+    int width_{0};
+    int height_{0};
+    int levels_{0};
+    int faces_{0};
+    bake_options options_;
+    bitmap_channel channels_{bitmap_channel::unspecified};
+    bitmap_internal_format internal_format_{bitmap_internal_format::u8};
+    bcn::block_format block_format_{bcn::block_format::none};
+};
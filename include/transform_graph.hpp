@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+/*
+    Node hierarchy of a model, flattened into arrays in breadth-first order: every parent comes before its children
+    and the nodes of one depth are contiguous. Names, parent indices, local and world matrices and dirty flags are
+    separate arrays, so update() only streams through the parts it needs.
+    update() walks the depth levels in order. A node is recomputed if its local matrix changed or its parent was
+    recomputed in the same update, clean subtrees are skipped. The nodes of a level do not depend on each other,
+    so each level is gathered first and multiplied as one batch (SSE on x86).
+ */
+
+namespace glwrap
+{
+    class transform_graph final
+    {
+    public:
+        static constexpr uint32_t no_parent = std::numeric_limits<uint32_t>::max();
+
+        // Roots come first, then every node at most one level deeper than the node added before it.
+        // Returns the index of the new node.
+        uint32_t add_node(std::string name, uint32_t parent, glm::mat4 const &local);
+
+        size_t size() const noexcept { return parents_.size(); }
+        std::string const &name(uint32_t node) const { return names_.at(node); }
+        uint32_t parent(uint32_t node) const { return parents_.at(node); }
+        std::span<uint32_t const> parents() const noexcept { return parents_; }
+
+        glm::mat4 const &local(uint32_t node) const { return locals_.at(node); }
+        std::span<glm::mat4 const> locals() const noexcept { return locals_; }
+        void set_local(uint32_t node, glm::mat4 const &local);
+
+        // local to model space, valid after update()
+        glm::mat4 const &world(uint32_t node) const { return worlds_.at(node); }
+        std::span<glm::mat4 const> worlds() const noexcept { return worlds_; }
+
+        // Returns the number of recomputed world matrices.
+        size_t update();
+
+    private:
+        std::vector<std::string> names_;
+        std::vector<uint32_t> parents_;
+        std::vector<glm::mat4> locals_;
+        std::vector<glm::mat4> worlds_;
+        std::vector<uint8_t> dirty_;
+        // first node of every depth level
+        std::vector<uint32_t> level_starts_;
+        // nodes of the level being updated
+        std::vector<uint32_t> batch_;
+    };
+}
@@ -148,6 +148,29 @@ namespace utils
         return func();
     }
 
+    /*! \brief Wall time of consecutive stages of a longer task, e.g. "collect 1.2 ms, convert 3.4 ms".
+     *         Each lap() ends the current stage and starts the next one.
+     */
+    class stage_timer
+    {
+    public:
+        using clock_t = std::chrono::high_resolution_clock;
+
+        void lap(std::string_view stage)
+        {
+            auto now = clock_t::now();
+            auto ms = std::chrono::duration_cast<std::chrono::duration<float, std::milli>>(now - start_).count();
+            report_ += std::format("{}{} {:.1f} ms", report_.empty() ? "" : ", ", stage, ms);
+            start_ = now;
+        }
+
+        std::string const &report() const noexcept { return report_; }
+
+    private:
+        clock_t::time_point start_{clock_t::now()};
+        std::string report_;
+    };
+
     struct quad_vertex_t
     {
         using vertex_desc_t = std::tuple<glm::vec2, glm::vec2>;
@@ -21,12 +21,16 @@ struct DirLight
 {
     vec3 dir;
     vec3 color;
-    int cascadeCount;
-    float cascadePlaneDistances[8];
-    mat4 lightSpaceMats[8];
     sampler2DArray shadowMap;
 };
 
+layout(std140) uniform Cascades
+{
+    mat4 lightSpaceMats[8];
+    float cascadePlaneDistances[8];
+    int cascadeCount;
+};
+
 uniform mat4 view;
 uniform vec3 viewPosition;
 uniform Light lights[4];
@@ -102,17 +106,17 @@ void main()
         vec4 viewSpacePosition = view * vec4(fsInput.position, 1.0);
         float depth = abs(viewSpacePosition.z);
         int layer = -1;
-        for (int i = 0; i < dirLight.cascadeCount; ++i) {
-            if (depth <= dirLight.cascadePlaneDistances[i]) {
+        for (int i = 0; i < cascadeCount; ++i) {
+            if (depth <= cascadePlaneDistances[i]) {
                 layer = i;
                 break;
             }
         }
         if (layer < 0) {
-            layer = dirLight.cascadeCount - 1;
+            layer = cascadeCount - 1;
         }
 
-        float shadow = calcShadow(dirLight.lightSpaceMats[layer] * vec4(fsInput.position, 1.0), layer, bias);
+        float shadow = calcShadow(lightSpaceMats[layer] * vec4(fsInput.position, 1.0), layer, bias);
         result += rawLight * (1.0 - shadow);
     }
 
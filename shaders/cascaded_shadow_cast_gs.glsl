@@ -3,7 +3,12 @@
 layout(triangles, invocations = 5) in;
 layout(triangle_strip, max_vertices = 3) out;
 
-uniform mat4 lightSpaceMats[8];
+layout(std140) uniform Cascades
+{
+    mat4 lightSpaceMats[8];
+    float cascadePlaneDistances[8];
+    int cascadeCount;
+};
 
 void main()
 {
@@ -0,0 +1,77 @@
+#version 430 core
+
+// One invocation per meshlet, same tests as glwrap::meshlets::is_visible.
+// Visible meshlets append a draw command, the caller clears the rest of the command buffer to zero.
+
+layout(local_size_x = 64) in;
+
+struct Meshlet
+{
+    vec4 sphere; // center, radius
+    vec4 cone;   // axis, cutoff
+    uvec4 range; // first index, index count, vertex count, padding
+};
+
+struct DrawCommand
+{
+    uint count;
+    uint instanceCount;
+    uint firstIndex;
+    int baseVertex;
+    uint baseInstance;
+};
+
+layout(std430, binding = 0) readonly buffer Meshlets
+{
+    Meshlet meshlets[];
+};
+
+layout(std430, binding = 1) writeonly buffer Commands
+{
+    DrawCommand commands[];
+};
+
+layout(std430, binding = 2) buffer Counter
+{
+    uint drawCount;
+};
+
+uniform uint meshletCount;
+uniform vec4 frustumPlanes[6];
+uniform vec3 eye;
+uniform bool cullBackfaces;
+uniform float radiusPadding;
+// range of the mesh in a shared arena
+uniform uint firstIndex;
+uniform int baseVertex;
+
+void main()
+{
+    uint i = gl_GlobalInvocationID.x;
+    if (i >= meshletCount)
+    {
+        return;
+    }
+
+    Meshlet m = meshlets[i];
+    vec3 center = m.sphere.xyz;
+    float radius = m.sphere.w + radiusPadding;
+    for (int p = 0; p < 6; ++p)
+    {
+        if (dot(frustumPlanes[p].xyz, center) + frustumPlanes[p].w < -radius)
+        {
+            return;
+        }
+    }
+    if (cullBackfaces)
+    {
+        vec3 toCenter = center - eye;
+        if (dot(toCenter, m.cone.xyz) >= m.cone.w * length(toCenter) + radius)
+        {
+            return;
+        }
+    }
+
+    uint slot = atomicAdd(drawCount, 1u);
+    commands[slot] = DrawCommand(m.range.y, 1u, firstIndex + m.range.x, baseVertex, 0u);
+}
@@ -22,11 +22,18 @@ vec2 encodeOctahedral(vec3 n)
     return n.z >= 0 ? n.xy : (1 - abs(n.yx)) * sign(n.xy);
 }
 
+// Only xy is read, BC5 normal maps carry no z
+vec3 sampleTangentNormal(sampler2D tex, vec2 uv)
+{
+    vec2 xy = texture(tex, uv).rg * 2 - 1;
+    return vec3(xy, sqrt(max(1.0 - dot(xy, xy), 0.0)));
+}
+
 void main()
 {
     vec3 albedo = texture(diffuseTexture, fsInput.texCoords).rgb;
     vec3 specular = texture(specularTexture, fsInput.texCoords).rgb;
-    vec3 normal = normalize(fsInput.tbn * (texture(normalTexture, fsInput.texCoords).rgb * 2 - 1));
+    vec3 normal = normalize(fsInput.tbn * sampleTangentNormal(normalTexture, fsInput.texCoords));
 
     outputPosition = fsInput.position;
     outputNormal = encodeOctahedral(normal);
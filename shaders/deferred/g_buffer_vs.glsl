@@ -3,13 +3,14 @@
 layout (location = 0) in vec3 aPosition;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
-layout (location = 3) in vec3 aTangent;
-layout (location = 4) in vec3 aBitangent;
+// w is the handedness of the tangent frame
+layout (location = 3) in vec4 aTangent;
+// per instance, so one multi draw can place every mesh through its base instance
+layout (location = 4) in mat4 model;
+layout (location = 8) in mat4 normalMat;
 
 uniform mat4 projection;
 uniform mat4 view;
-uniform mat4 model;
-uniform mat4 normalMat;
 
 out VS_OUTPUT
 {
@@ -26,8 +27,8 @@ void main()
     vsOutput.texCoords = aTexCoords;
 
     vec3 normal = normalize((normalMat * vec4(aNormal, 0)).xyz);
-    vec3 tangent = normalize((model * vec4(aTangent, 0)).xyz);
-    vec3 bitangent = normalize((model * vec4(aBitangent, 0)).xyz);
+    vec3 tangent = normalize((model * vec4(aTangent.xyz, 0)).xyz);
+    vec3 bitangent = normalize((model * vec4(cross(aNormal, aTangent.xyz) * aTangent.w, 0)).xyz);
     
     vsOutput.tbn = mat3(tangent, bitangent, normal);
 
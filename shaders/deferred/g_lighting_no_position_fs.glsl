@@ -1,4 +1,4 @@
-#version 330 core
+#version 430 core
 
 in vec2 TexCoords;
 
@@ -14,8 +14,10 @@ struct Light
     vec3 color;
     float range;
 };
-uniform Light lights[32];
-uniform int lightCount;
+layout(std430, binding = 0) readonly buffer Lights
+{
+    Light lights[];
+};
 
 uniform vec3 viewPos;
 uniform vec2 frameSize;
@@ -48,7 +50,7 @@ void main()
     vec3 specular = texture(input2, TexCoords).rgb;
 
     vec3 color = vec3(0);
-    for (int i = 0; i < lightCount; ++i)
+    for (int i = 0; i < lights.length(); ++i)
     {
         vec3 lightDiff = lights[i].position - position;
         float dist = length(lightDiff);
@@ -0,0 +1,512 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <format>
+#include <limits>
+#include <stdexcept>
+
+#include "bcn.hpp"
+#include "parallel.hpp"
+
+namespace
+{
+    using bcn::block_format;
+
+    // 4x4 pixels, always expanded to rgba
+    using pixel_block = std::array<std::array<float, 4>, 16>;
+
+    pixel_block load_block(uint8_t const *pixels, int width, int height, int channels, int block_x, int block_y)
+    {
+        pixel_block block;
+        for (int i = 0; i < 16; ++i)
+        {
+            auto x = std::min(block_x * 4 + i % 4, width - 1);
+            auto y = std::min(block_y * 4 + i / 4, height - 1);
+            auto p = pixels + (static_cast<size_t>(y) * width + x) * channels;
+            auto &out = block[i];
+            out = {0.0f, 0.0f, 0.0f, 255.0f};
+            for (int c = 0; c < channels; ++c)
+            {
+                out[c] = p[c];
+            }
+            if (channels == 1)
+            {
+                out[1] = out[2] = out[0];
+            }
+        }
+        return block;
+    }
+
+    template <int N>
+    float distance2(std::array<float, 4> const &a, std::array<float, 4> const &b) noexcept
+    {
+        float d = 0.0f;
+        for (int c = 0; c < N; ++c)
+        {
+            d += (a[c] - b[c]) * (a[c] - b[c]);
+        }
+        return d;
+    }
+
+    // Principal axis of the first N channels by power iteration over the covariance matrix, endpoints are the extreme projections.
+    template <int N>
+    std::pair<std::array<float, 4>, std::array<float, 4>> principal_endpoints(pixel_block const &block)
+    {
+        std::array<float, 4> mean{};
+        for (auto &p : block)
+            for (int c = 0; c < N; ++c)
+                mean[c] += p[c] / 16.0f;
+
+        float cov[N][N] = {};
+        for (auto &p : block)
+            for (int i = 0; i < N; ++i)
+                for (int j = 0; j < N; ++j)
+                    cov[i][j] += (p[i] - mean[i]) * (p[j] - mean[j]);
+
+        // Power iteration seeded with the covariance column of the channel that varies most. A fixed grey seed is
+        // nearly orthogonal to the axis of chroma-only blocks (red to green) and would stop right away.
+        int widest = 0;
+        for (int c = 1; c < N; ++c)
+            if (cov[c][c] > cov[widest][widest])
+                widest = c;
+        std::array<float, 4> axis{};
+        if (cov[widest][widest] > 0.0f)
+        {
+            for (int c = 0; c < N; ++c)
+                axis[c] = cov[c][widest];
+        }
+        else
+        {
+            // flat block, any axis gives the same endpoints
+            constexpr std::array<float, 4> luminance{0.299f, 0.587f, 0.114f, 0.0f};
+            for (int c = 0; c < N; ++c)
+                axis[c] = N >= 3 ? luminance[c] : 1.0f;
+        }
+        for (int iter = 0; iter < 8; ++iter)
+        {
+            std::array<float, 4> next{};
+            for (int i = 0; i < N; ++i)
+                for (int j = 0; j < N; ++j)
+                    next[i] += cov[i][j] * axis[j];
+            float len = 0.0f;
+            for (int c = 0; c < N; ++c)
+                len = std::max(len, std::abs(next[c]));
+            if (len < 1e-6f)
+            {
+                break;
+            }
+            for (int c = 0; c < N; ++c)
+                axis[c] = next[c] / len;
+        }
+
+        float lo = std::numeric_limits<float>::max(), hi = std::numeric_limits<float>::lowest();
+        float norm2 = 0.0f;
+        for (int c = 0; c < N; ++c)
+            norm2 += axis[c] * axis[c];
+        for (auto &p : block)
+        {
+            float t = 0.0f;
+            for (int c = 0; c < N; ++c)
+                t += (p[c] - mean[c]) * axis[c];
+            lo = std::min(lo, t / norm2);
+            hi = std::max(hi, t / norm2);
+        }
+
+        std::array<float, 4> e0{}, e1{};
+        for (int c = 0; c < N; ++c)
+        {
+            e0[c] = std::clamp(mean[c] + axis[c] * hi, 0.0f, 255.0f);
+            e1[c] = std::clamp(mean[c] + axis[c] * lo, 0.0f, 255.0f);
+        }
+        return {e0, e1};
+    }
+
+    // ---------------------- BC1 color block ----------------------
+
+    uint16_t to_565(std::array<float, 4> const &c) noexcept
+    {
+        auto r = static_cast<uint16_t>(std::lround(c[0] * 31.0f / 255.0f));
+        auto g = static_cast<uint16_t>(std::lround(c[1] * 63.0f / 255.0f));
+        auto b = static_cast<uint16_t>(std::lround(c[2] * 31.0f / 255.0f));
+        return static_cast<uint16_t>(r << 11 | g << 5 | b);
+    }
+
+    std::array<float, 4> from_565(uint16_t v) noexcept
+    {
+        auto r = (v >> 11) & 0x1f, g = (v >> 5) & 0x3f, b = v & 0x1f;
+        return {static_cast<float>(r << 3 | r >> 2), static_cast<float>(g << 2 | g >> 4), static_cast<float>(b << 3 | b >> 2), 255.0f};
+    }
+
+    struct color_block
+    {
+        uint16_t c0;
+        uint16_t c1;
+        uint32_t indices;
+        float error;
+    };
+
+    // Always 4-color mode (c0 > c1), which is also what BC3 expects.
+    color_block fit_color_block(pixel_block const &block, uint16_t c0, uint16_t c1)
+    {
+        if (c0 < c1)
+        {
+            std::swap(c0, c1);
+        }
+        if (c0 == c1)
+        {
+            auto color = from_565(c0);
+            float error = 0.0f;
+            for (auto &p : block)
+                error += distance2<3>(p, color);
+            return {c0, c1, 0, error};
+        }
+
+        auto p0 = from_565(c0), p1 = from_565(c1);
+        std::array<std::array<float, 4>, 4> palette{p0, p1, {}, {}};
+        for (int c = 0; c < 3; ++c)
+        {
+            palette[2][c] = (2.0f * p0[c] + p1[c]) / 3.0f;
+            palette[3][c] = (p0[c] + 2.0f * p1[c]) / 3.0f;
+        }
+
+        color_block result{c0, c1, 0, 0.0f};
+        for (int i = 0; i < 16; ++i)
+        {
+            int best = 0;
+            float best_error = std::numeric_limits<float>::max();
+            for (int k = 0; k < 4; ++k)
+            {
+                auto e = distance2<3>(block[i], palette[k]);
+                if (e < best_error)
+                {
+                    best_error = e;
+                    best = k;
+                }
+            }
+            result.indices |= static_cast<uint32_t>(best) << (2 * i);
+            result.error += best_error;
+        }
+        return result;
+    }
+
+    // One least squares pass: solve the endpoints that best reproduce the pixels for the current index assignment.
+    std::pair<std::array<float, 4>, std::array<float, 4>> refine_endpoints(pixel_block const &block, uint32_t indices)
+    {
+        static constexpr float weights[4] = {0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f};
+        float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+        std::array<float, 4> ax{}, bx{};
+        for (int i = 0; i < 16; ++i)
+        {
+            auto t = weights[(indices >> (2 * i)) & 3];
+            auto a = 1.0f - t;
+            aa += a * a;
+            ab += a * t;
+            bb += t * t;
+            for (int c = 0; c < 3; ++c)
+            {
+                ax[c] += a * block[i][c];
+                bx[c] += t * block[i][c];
+            }
+        }
+        auto det = aa * bb - ab * ab;
+        if (std::abs(det) < 1e-6f)
+        {
+            return {};
+        }
+        std::array<float, 4> e0{}, e1{};
+        for (int c = 0; c < 3; ++c)
+        {
+            e0[c] = std::clamp((ax[c] * bb - bx[c] * ab) / det, 0.0f, 255.0f);
+            e1[c] = std::clamp((bx[c] * aa - ax[c] * ab) / det, 0.0f, 255.0f);
+        }
+        return {e0, e1};
+    }
+
+    void encode_color_block(pixel_block const &block, std::byte *out)
+    {
+        auto [e0, e1] = principal_endpoints<3>(block);
+        auto best = fit_color_block(block, to_565(e0), to_565(e1));
+        if (best.c0 != best.c1)
+        {
+            auto [r0, r1] = refine_endpoints(block, best.indices);
+            auto refined = fit_color_block(block, to_565(r0), to_565(r1));
+            if (refined.error < best.error)
+            {
+                best = refined;
+            }
+        }
+        std::memcpy(out, &best.c0, 2);
+        std::memcpy(out + 2, &best.c1, 2);
+        std::memcpy(out + 4, &best.indices, 4);
+    }
+
+    // ---------------------- BC4 single channel block ----------------------
+
+    void encode_channel_block(pixel_block const &block, int channel, std::byte *out)
+    {
+        float lo = 255.0f, hi = 0.0f;
+        for (auto &p : block)
+        {
+            lo = std::min(lo, p[channel]);
+            hi = std::max(hi, p[channel]);
+        }
+        auto e0 = static_cast<uint8_t>(std::lround(hi));
+        auto e1 = static_cast<uint8_t>(std::lround(lo));
+
+        // e0 > e1 selects the 8 value mode, e0 == e1 leaves every index at 0
+        std::array<float, 8> palette{static_cast<float>(e0), static_cast<float>(e1)};
+        for (int i = 2; i < 8; ++i)
+        {
+            palette[i] = ((8 - i) * static_cast<float>(e0) + (i - 1) * static_cast<float>(e1)) / 7.0f;
+        }
+
+        uint64_t bits = 0;
+        if (e0 != e1)
+        {
+            for (int i = 0; i < 16; ++i)
+            {
+                int best = 0;
+                float best_error = std::numeric_limits<float>::max();
+                for (int k = 0; k < 8; ++k)
+                {
+                    auto d = std::abs(block[i][channel] - palette[k]);
+                    if (d < best_error)
+                    {
+                        best_error = d;
+                        best = k;
+                    }
+                }
+                bits |= static_cast<uint64_t>(best) << (3 * i);
+            }
+        }
+        out[0] = static_cast<std::byte>(e0);
+        out[1] = static_cast<std::byte>(e1);
+        for (int i = 0; i < 6; ++i)
+        {
+            out[2 + i] = static_cast<std::byte>((bits >> (8 * i)) & 0xff);
+        }
+    }
+
+    // ---------------------- BC7 mode 6 ----------------------
+
+    class bit_writer final
+    {
+    public:
+        explicit bit_writer(std::byte *out) : out_{out} { std::memset(out_, 0, 16); }
+
+        void write(uint32_t value, int bits)
+        {
+            for (int i = 0; i < bits; ++i, ++pos_)
+            {
+                if ((value >> i) & 1)
+                {
+                    out_[pos_ / 8] |= static_cast<std::byte>(1 << (pos_ % 8));
+                }
+            }
+        }
+
+    private:
+        std::byte *out_;
+        int pos_{0};
+    };
+
+    struct mode6_block
+    {
+        std::array<std::array<uint8_t, 4>, 2> endpoints;
+        std::array<uint8_t, 2> pbits;
+        std::array<uint8_t, 16> indices;
+        float error;
+    };
+
+    mode6_block fit_mode6(pixel_block const &block, std::array<float, 4> const &e0, std::array<float, 4> const &e1, int p0, int p1)
+    {
+        static constexpr int weights[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+        mode6_block result{};
+        result.pbits = {static_cast<uint8_t>(p0), static_cast<uint8_t>(p1)};
+        std::array<std::array<int, 4>, 2> expanded;
+        for (int c = 0; c < 4; ++c)
+        {
+            for (int e = 0; e < 2; ++e)
+            {
+                auto v = e == 0 ? e0[c] : e1[c];
+                auto p = result.pbits[e];
+                auto q = static_cast<uint8_t>(std::clamp(std::lround((v - p) / 2.0f), 0l, 127l));
+                result.endpoints[e][c] = q;
+                expanded[e][c] = q << 1 | p;
+            }
+        }
+
+        std::array<std::array<float, 4>, 16> palette;
+        for (int k = 0; k < 16; ++k)
+        {
+            for (int c = 0; c < 4; ++c)
+            {
+                palette[k][c] = static_cast<float>(((64 - weights[k]) * expanded[0][c] + weights[k] * expanded[1][c] + 32) >> 6);
+            }
+        }
+
+        for (int i = 0; i < 16; ++i)
+        {
+            int best = 0;
+            float best_error = std::numeric_limits<float>::max();
+            for (int k = 0; k < 16; ++k)
+            {
+                auto e = distance2<4>(block[i], palette[k]);
+                if (e < best_error)
+                {
+                    best_error = e;
+                    best = k;
+                }
+            }
+            result.indices[i] = static_cast<uint8_t>(best);
+            result.error += best_error;
+        }
+        return result;
+    }
+
+    void encode_bc7_block(pixel_block const &block, std::byte *out)
+    {
+        auto [e0, e1] = principal_endpoints<4>(block);
+        auto best = fit_mode6(block, e0, e1, 0, 0);
+        for (int combo = 1; combo < 4; ++combo)
+        {
+            auto candidate = fit_mode6(block, e0, e1, combo & 1, combo >> 1);
+            if (candidate.error < best.error)
+            {
+                best = candidate;
+            }
+        }
+
+        // the MSB of the first index is implicit zero
+        if (best.indices[0] >= 8)
+        {
+            std::swap(best.endpoints[0], best.endpoints[1]);
+            std::swap(best.pbits[0], best.pbits[1]);
+            for (auto &index : best.indices)
+            {
+                index = static_cast<uint8_t>(15 - index);
+            }
+        }
+
+        bit_writer w{out};
+        w.write(1u << 6, 7);
+        for (int c = 0; c < 4; ++c)
+        {
+            w.write(best.endpoints[0][c], 7);
+            w.write(best.endpoints[1][c], 7);
+        }
+        w.write(best.pbits[0], 1);
+        w.write(best.pbits[1], 1);
+        w.write(best.indices[0], 3);
+        for (int i = 1; i < 16; ++i)
+        {
+            w.write(best.indices[i], 4);
+        }
+    }
+
+    void encode_block(pixel_block const &block, block_format format, std::byte *out)
+    {
+        switch (format)
+        {
+        case block_format::bc1:
+            encode_color_block(block, out);
+            break;
+        case block_format::bc3:
+            encode_channel_block(block, 3, out);
+            encode_color_block(block, out + 8);
+            break;
+        case block_format::bc4:
+            encode_channel_block(block, 0, out);
+            break;
+        case block_format::bc5:
+            encode_channel_block(block, 0, out);
+            encode_channel_block(block, 1, out + 8);
+            break;
+        case block_format::bc7:
+            encode_bc7_block(block, out);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+namespace bcn
+{
+    size_t block_size(block_format format) noexcept
+    {
+        switch (format)
+        {
+        case block_format::bc1:
+        case block_format::bc4:
+            return 8;
+        case block_format::bc3:
+        case block_format::bc5:
+        case block_format::bc7:
+            return 16;
+        default:
+            return 0;
+        }
+    }
+
+    size_t compressed_size(block_format format, int width, int height) noexcept
+    {
+        return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * block_size(format);
+    }
+
+    block_format choose_format(bitmap const &bmp, texture_usage usage) noexcept
+    {
+        if (bmp.internal_format() != bitmap_internal_format::u8)
+        {
+            return block_format::none;
+        }
+        if (usage == texture_usage::normal_map)
+        {
+            return block_format::bc5;
+        }
+        switch (bmp.channels())
+        {
+        case bitmap_channel::grey:
+            return block_format::bc4;
+        case bitmap_channel::grey_alpha:
+            return block_format::bc5;
+        case bitmap_channel::rgb:
+            return block_format::bc1;
+        case bitmap_channel::rgba:
+            return block_format::bc7;
+        default:
+            return block_format::none;
+        }
+    }
+
+    std::vector<std::byte> encode(bitmap const &bmp, block_format format)
+    {
+        if (format == block_format::none)
+        {
+            throw std::invalid_argument("Cannot encode with block format none");
+        }
+        if (bmp.internal_format() != bitmap_internal_format::u8)
+        {
+            throw std::invalid_argument(std::format("Block compression needs a u8 bitmap, got {}", bmp.internal_format()));
+        }
+
+        auto blocks_x = (bmp.width() + 3) / 4;
+        auto blocks_y = (bmp.height() + 3) / 4;
+        auto size = block_size(format);
+        std::vector<std::byte> result(static_cast<size_t>(blocks_x) * blocks_y * size);
+        auto pixels = reinterpret_cast<uint8_t const *>(bmp.pixels());
+        auto channels = static_cast<int>(bmp.channels());
+
+        utils::parallel_for(static_cast<size_t>(blocks_y), [&](size_t block_y)
+                            {
+                                auto out = result.data() + block_y * blocks_x * size;
+                                for (int block_x = 0; block_x < blocks_x; ++block_x, out += size)
+                                {
+                                    auto block = load_block(pixels, bmp.width(), bmp.height(), channels, block_x, static_cast<int>(block_y));
+                                    encode_block(block, format, out);
+                                } });
+        return result;
+    }
+}
@@ -1,4 +1,15 @@
-﻿#include "bitmap.hpp"
+﻿#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "bitmap.hpp"
+#include "half.hpp"
+#include "mapped_file.hpp"
 
 //#define STBI_NO_JPEG
 //#define STBI_NO_PNG
@@ -15,8 +26,9 @@
 
 struct bitmap::bitmap_impl final
 {
-    bitmap_impl(int width, int height, int channels, bitmap_internal_format internal_format, void *ptr, size_t size_in_bytes)
-        : width_{width}, height_{height}, channels_{channels}, internal_format_{internal_format}, ptr_{ptr}, size_in_bytes_{size_in_bytes}
+    // storage owns the memory ptr points into: either the stbi allocation itself, or a mapped file
+    bitmap_impl(int width, int height, int channels, bitmap_internal_format internal_format, std::shared_ptr<void const> storage, void *ptr, size_t size_in_bytes)
+        : width_{width}, height_{height}, channels_{channels}, internal_format_{internal_format}, storage_{std::move(storage)}, ptr_{ptr}, size_in_bytes_{size_in_bytes}
     {
         while (width > 1 && height > 1)
         {
@@ -25,11 +37,14 @@ struct bitmap::bitmap_impl final
             ++max_mipmap_level_;
         }
     }
-    ~bitmap_impl()
+
+    bitmap_impl(int width, int height, int channels, bitmap_internal_format internal_format, void *ptr, size_t size_in_bytes)
+        : bitmap_impl(width, height, channels, internal_format, std::shared_ptr<void const>(ptr, stbi_image_free), ptr, size_in_bytes)
     {
-        stbi_image_free(ptr_);
     }
 
+    ~bitmap_impl() = default;
+
     bitmap_impl(bitmap_impl const &) = delete;
     bitmap_impl(bitmap_impl &&) = delete;
     bitmap_impl &operator=(bitmap_impl const &) = delete;
@@ -39,11 +54,174 @@ struct bitmap::bitmap_impl final
     int height_;
     int channels_;
     bitmap_internal_format internal_format_;
+    std::shared_ptr<void const> storage_;
     void *ptr_;
     size_t size_in_bytes_;
     int max_mipmap_level_{0};
 };
 
+// ----------------- Radiance RGBE -> half -----------------
+
+namespace
+{
+    class rgbe_reader final
+    {
+    public:
+        rgbe_reader(std::byte const *p, size_t size) : p_{reinterpret_cast<uint8_t const *>(p)}, size_{size} {}
+
+        std::string_view line()
+        {
+            auto begin = pos_;
+            while (pos_ < size_ && p_[pos_] != '\n')
+            {
+                ++pos_;
+            }
+            auto result = std::string_view{reinterpret_cast<char const *>(p_ + begin), pos_ - begin};
+            if (pos_ < size_)
+            {
+                ++pos_;
+            }
+            return result;
+        }
+
+        bool has(size_t n) const noexcept { return n <= size_ - pos_; }
+
+        uint8_t const *take(size_t n)
+        {
+            if (!has(n))
+            {
+                throw std::invalid_argument("Radiance image truncated");
+            }
+            auto result = p_ + pos_;
+            pos_ += n;
+            return result;
+        }
+
+    private:
+        uint8_t const *p_;
+        size_t size_;
+        size_t pos_{0};
+    };
+
+    // Decodes one scanline of RGBE quads, new-style RLE or flat.
+    void read_rgbe_scanline(rgbe_reader &reader, uint8_t *rgbe, int width)
+    {
+        if (width < 8 || width > 0x7fff || !reader.has(4))
+        {
+            std::memcpy(rgbe, reader.take(static_cast<size_t>(width) * 4), static_cast<size_t>(width) * 4);
+            return;
+        }
+        auto head = reader.take(4);
+        if (head[0] != 2 || head[1] != 2 || (head[2] << 8 | head[3]) != width)
+        {
+            // flat scanline, the 4 bytes already read are its first pixel
+            std::memcpy(rgbe, head, 4);
+            std::memcpy(rgbe + 4, reader.take(static_cast<size_t>(width - 1) * 4), static_cast<size_t>(width - 1) * 4);
+            return;
+        }
+        // RLE stores the four components in separate runs
+        for (int component = 0; component < 4; ++component)
+        {
+            int x = 0;
+            while (x < width)
+            {
+                auto count = *reader.take(1);
+                if (count > 128)
+                {
+                    count -= 128;
+                    if (count > width - x)
+                    {
+                        throw std::invalid_argument("Radiance scanline overrun");
+                    }
+                    auto value = *reader.take(1);
+                    for (int i = 0; i < count; ++i)
+                    {
+                        rgbe[(x++) * 4 + component] = value;
+                    }
+                }
+                else
+                {
+                    if (count == 0 || count > width - x)
+                    {
+                        throw std::invalid_argument("Radiance scanline overrun");
+                    }
+                    auto values = reader.take(count);
+                    for (int i = 0; i < count; ++i)
+                    {
+                        rgbe[(x++) * 4 + component] = values[i];
+                    }
+                }
+            }
+        }
+    }
+}
+
+/*! \brief Decode a Radiance (.hdr) image to half floats row by row, so the image never exists as f32.
+ *         Returns std::nullopt for variants it does not handle (XYZE, rotated or flipped scan order), the caller falls back to stb_image.
+ */
+std::optional<bitmap> bitmap::decode_radiance_f16(std::byte const *p, size_t size, int channels, bool flip_vertically)
+{
+    rgbe_reader reader{p, size};
+    auto magic = reader.line();
+    if (magic != "#?RADIANCE" && magic != "#?RGBE")
+    {
+        return std::nullopt;
+    }
+    for (auto line = reader.line(); !line.empty(); line = reader.line())
+    {
+        if (line.starts_with("FORMAT=") && line != "FORMAT=32-bit_rle_rgbe")
+        {
+            return std::nullopt;
+        }
+    }
+    int width = 0, height = 0;
+    auto resolution = std::string{reader.line()};
+    if (std::sscanf(resolution.c_str(), "-Y %d +X %d", &height, &width) != 2 || width <= 0 || height <= 0)
+    {
+        return std::nullopt;
+    }
+
+    // 2^(e - 136): the mantissa bytes are fixed point with 8 fractional bits
+    float scales[256];
+    scales[0] = 0.0f;
+    for (int e = 1; e < 256; ++e)
+    {
+        scales[e] = std::ldexp(1.0f, e - 136);
+    }
+
+    auto bmp = allocate(width, height, static_cast<bitmap_channel>(channels), bitmap_internal_format::f16);
+    std::vector<uint8_t> rgbe(static_cast<size_t>(width) * 4);
+    std::vector<float> row(static_cast<size_t>(width) * channels);
+    auto row_halves = static_cast<size_t>(width) * channels;
+    for (int y = 0; y < height; ++y)
+    {
+        read_rgbe_scanline(reader, rgbe.data(), width);
+        for (int x = 0; x < width; ++x)
+        {
+            auto scale = scales[rgbe[x * 4 + 3]];
+            auto out = row.data() + static_cast<size_t>(x) * channels;
+            out[0] = rgbe[x * 4 + 0] * scale;
+            out[1] = rgbe[x * 4 + 1] * scale;
+            out[2] = rgbe[x * 4 + 2] * scale;
+            if (channels == 4)
+            {
+                out[3] = 1.0f;
+            }
+        }
+        auto dst_row = flip_vertically ? height - 1 - y : y;
+        utils::floats_to_halves(row.data(), reinterpret_cast<uint16_t *>(bmp.pixels()) + dst_row * row_halves, row_halves);
+    }
+    return bmp;
+}
+
+bitmap bitmap::to_f16(bitmap const &src)
+{
+    auto bmp = allocate(src.width(), src.height(), src.channels(), bitmap_internal_format::f16);
+    auto count = static_cast<size_t>(src.width()) * src.height() * static_cast<int>(src.channels());
+    utils::floats_to_halves(reinterpret_cast<float const *>(src.pixels()), reinterpret_cast<uint16_t *>(bmp.pixels()), count);
+    return bmp;
+}
+
 bitmap::bitmap()
 { }
 
@@ -79,87 +257,138 @@ int bitmap::max_mipmap_level() const noexcept
     return impl_->max_mipmap_level_;
 }
 
+size_t bitmap::size_in_bytes() const noexcept
+{
+    return impl_->size_in_bytes_;
+}
+
 std::byte *bitmap::pixels() noexcept
 {
     return reinterpret_cast<std::byte*>(impl_->ptr_);
 }
 
+std::byte const *bitmap::pixels() const noexcept
+{
+    return reinterpret_cast<std::byte const *>(impl_->ptr_);
+}
+
 void bitmap::swap(bitmap &other) noexcept
 {
     std::swap(impl_, other.impl_);
 }
 
-bitmap bitmap::from_memory(std::byte const *p, size_t size, bitmap_channel required_channels, bool flip_vertically)
+size_t bitmap::elem_size(bitmap_internal_format internal_format) noexcept
+{
+    switch (internal_format)
+    {
+    case bitmap_internal_format::u8:
+        return 1;
+    case bitmap_internal_format::u16:
+    case bitmap_internal_format::f16:
+        return 2;
+    default:
+        return 4;
+    }
+}
+
+bitmap bitmap::allocate(int width, int height, bitmap_channel channels, bitmap_internal_format internal_format)
+{
+    if (width <= 0 || height <= 0 || channels == bitmap_channel::unspecified)
+    {
+        throw std::invalid_argument(std::format("Invalid bitmap size: {}x{}, {}", width, height, channels));
+    }
+    auto size_in_bytes = static_cast<size_t>(width) * height * static_cast<int>(channels) * elem_size(internal_format);
+    auto ptr = std::malloc(size_in_bytes);
+    if (ptr == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    bitmap bmp;
+    bmp.impl_ = std::make_unique<bitmap_impl>(width, height, static_cast<int>(channels), internal_format, std::shared_ptr<void const>(ptr, std::free), ptr, size_in_bytes);
+    return bmp;
+}
+
+bitmap bitmap::from_memory(std::byte const *p, size_t size, bitmap_channel required_channels, bool flip_vertically, bitmap_internal_format hdr_format)
 {
     int width, height, channels;
     auto puc = reinterpret_cast<stbi_uc const *>(p);
     auto len = static_cast<int>(size);
     void *raw_data;
     bitmap_internal_format internal_format;
-    size_t size_in_bytes;
+    size_t elem_size;
     stbi_set_flip_vertically_on_load_thread(flip_vertically);
     if (stbi_is_hdr_from_memory(puc, len))
     {
+        if (hdr_format == bitmap_internal_format::f16)
+        {
+            if (required_channels == bitmap_channel::unspecified || required_channels == bitmap_channel::rgb || required_channels == bitmap_channel::rgba)
+            {
+                if (auto bmp = decode_radiance_f16(p, size, required_channels == bitmap_channel::rgba ? 4 : 3, flip_vertically))
+                {
+                    return std::move(*bmp);
+                }
+            }
+            return to_f16(from_memory(p, size, required_channels, flip_vertically, bitmap_internal_format::f32));
+        }
         raw_data = stbi_loadf_from_memory(puc, len, &width, &height, &channels, static_cast<int>(required_channels));
         internal_format = bitmap_internal_format::f32;
-        size_in_bytes = width * height * channels * 4;
+        elem_size = 4;
     }
     else if (stbi_is_16_bit_from_memory(puc, len))
     {
         raw_data = stbi_load_16_from_memory(puc, len, &width, &height, &channels, static_cast<int>(required_channels));
         internal_format = bitmap_internal_format::u16;
-        size_in_bytes = width * height * channels * 2;
+        elem_size = 2;
     }
     else
     {
         raw_data = stbi_load_from_memory(puc, len, &width, &height, &channels, static_cast<int>(required_channels));
         internal_format = bitmap_internal_format::u8;
-        size_in_bytes = width * height * channels;
+        elem_size = 1;
     }
     if (raw_data == nullptr)
     {
         throw std::invalid_argument("bitmap from memory load failed");
     }
+    // stbi reports the channel count of the file, the returned data has the required count
+    if (required_channels != bitmap_channel::unspecified)
+    {
+        channels = static_cast<int>(required_channels);
+    }
+    auto size_in_bytes = static_cast<size_t>(width) * height * channels * elem_size;
     bitmap bmp;
     bmp.impl_ = std::make_unique<bitmap_impl>(width, height, channels, internal_format, raw_data, size_in_bytes);
     return bmp;
 }
 
-bitmap bitmap::from_file(std::filesystem::path const& path, bitmap_channel required_channels, bool flip_vertically)
+bitmap bitmap::from_file(std::filesystem::path const& path, bitmap_channel required_channels, bool flip_vertically, bitmap_internal_format hdr_format)
 {
-    auto fp = std::fopen(path.string().c_str(), "rb");
-    if (!fp)
-    {
-        throw std::runtime_error(std::format("Cannot open file: {}", path.string()));
-    }
-    int width, height, channels;
-    void *raw_data;
-    bitmap_internal_format internal_format;
-    size_t size_in_bytes;
-    stbi_set_flip_vertically_on_load_thread(flip_vertically);
-    if (stbi_is_hdr_from_file(fp))
-    {
-        raw_data = stbi_loadf_from_file(fp, &width, &height, &channels, static_cast<int>(required_channels));
-        internal_format = bitmap_internal_format::f32;
-        size_in_bytes = width * height * channels * 4;
-    }
-    else if (stbi_is_16_bit_from_file(fp))
+    return from_mapped_file(mapped_file{path}, required_channels, flip_vertically, hdr_format);
+}
+
+bitmap bitmap::from_mapped_file(mapped_file const &file, bitmap_channel required_channels, bool flip_vertically, bitmap_internal_format hdr_format)
+{
+    try
     {
-        raw_data = stbi_load_from_file_16(fp, &width, &height, &channels, static_cast<int>(required_channels));
-        internal_format = bitmap_internal_format::u16;
-        size_in_bytes = width * height * channels * 2;
+        return from_memory(file.data(), file.size(), required_channels, flip_vertically, hdr_format);
     }
-    else
+    catch (std::invalid_argument const &)
     {
-        raw_data = stbi_load_from_file(fp, &width, &height, &channels, static_cast<int>(required_channels));
-        internal_format = bitmap_internal_format::u8;
-        size_in_bytes = width * height * channels;
+        throw std::invalid_argument(std::format("Bitmap file load failed: {}", file.path().string()));
     }
-    if (raw_data == nullptr)
+}
+
+bitmap bitmap::from_mapped_pixels(std::shared_ptr<mapped_file const> file, size_t offset, int width, int height,
+                                  bitmap_channel channels, bitmap_internal_format internal_format)
+{
+    auto size_in_bytes = static_cast<size_t>(width) * height * static_cast<int>(channels) * elem_size(internal_format);
+    if (offset > file->size() || size_in_bytes > file->size() - offset)
     {
-        throw std::invalid_argument(std::format("Bitmap file load failed: {}", path.string()));
+        throw std::invalid_argument(std::format("Mapped pixels out of range: {}", file->path().string()));
     }
+    // pixels live in read-only pages, constness is dropped only to share the bitmap_impl representation
+    auto ptr = const_cast<std::byte *>(file->data() + offset);
     bitmap bmp;
-    bmp.impl_ = std::make_unique<bitmap_impl>(width, height, channels, internal_format, raw_data, size_in_bytes);
+    bmp.impl_ = std::make_unique<bitmap_impl>(width, height, static_cast<int>(channels), internal_format, std::move(file), ptr, size_in_bytes);
     return bmp;
 }
@@ -0,0 +1,180 @@
+#include <algorithm>
+#include <cmath>
+
+#include "bounds.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define BOUNDS_X86 1
+#include <immintrin.h>
+#else
+#define BOUNDS_X86 0
+#endif
+
+namespace glwrap
+{
+    namespace
+    {
+        float const *position_at(float const *positions, size_t stride, size_t i) noexcept
+        {
+            return reinterpret_cast<float const *>(reinterpret_cast<unsigned char const *>(positions) + i * stride);
+        }
+
+        glm::vec3 load(float const *positions, size_t stride, size_t i) noexcept
+        {
+            auto p = position_at(positions, stride, i);
+            return {p[0], p[1], p[2]};
+        }
+
+#if BOUNDS_X86
+        float horizontal_min(__m128 v) noexcept
+        {
+            v = _mm_min_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+            v = _mm_min_ss(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+            return _mm_cvtss_f32(v);
+        }
+
+        float horizontal_max(__m128 v) noexcept
+        {
+            v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+            v = _mm_max_ss(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+            return _mm_cvtss_f32(v);
+        }
+
+        // Loads positions i..i+3 as rows and transposes them to x, y and z columns.
+        // Each row reads one float past its position, so the caller keeps at least one position after i + 3.
+        void load4(float const *positions, size_t stride, size_t i, __m128 &x, __m128 &y, __m128 &z) noexcept
+        {
+            auto r0 = _mm_loadu_ps(position_at(positions, stride, i));
+            auto r1 = _mm_loadu_ps(position_at(positions, stride, i + 1));
+            auto r2 = _mm_loadu_ps(position_at(positions, stride, i + 2));
+            auto r3 = _mm_loadu_ps(position_at(positions, stride, i + 3));
+            _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+            x = r0;
+            y = r1;
+            z = r2;
+        }
+#endif
+    }
+
+    bounds bounds::compute(float const *positions, size_t count, size_t stride) noexcept
+    {
+        bounds result{};
+        if (count == 0)
+        {
+            return result;
+        }
+
+        size_t i = 0;
+#if BOUNDS_X86
+        if (count > 4)
+        {
+            auto min_x = _mm_set1_ps(result.min.x), min_y = min_x, min_z = min_x;
+            auto max_x = _mm_set1_ps(result.max.x), max_y = max_x, max_z = max_x;
+            for (; i + 4 < count; i += 4)
+            {
+                __m128 x, y, z;
+                load4(positions, stride, i, x, y, z);
+                min_x = _mm_min_ps(min_x, x), min_y = _mm_min_ps(min_y, y), min_z = _mm_min_ps(min_z, z);
+                max_x = _mm_max_ps(max_x, x), max_y = _mm_max_ps(max_y, y), max_z = _mm_max_ps(max_z, z);
+            }
+            result.min = {horizontal_min(min_x), horizontal_min(min_y), horizontal_min(min_z)};
+            result.max = {horizontal_max(max_x), horizontal_max(max_y), horizontal_max(max_z)};
+        }
+#endif
+        for (; i < count; ++i)
+        {
+            auto p = load(positions, stride, i);
+            result.min = glm::min(result.min, p);
+            result.max = glm::max(result.max, p);
+        }
+
+        result.center = (result.min + result.max) * 0.5f;
+        float max_distance2 = 0.0f;
+        i = 0;
+#if BOUNDS_X86
+        if (count > 4)
+        {
+            auto center_x = _mm_set1_ps(result.center.x);
+            auto center_y = _mm_set1_ps(result.center.y);
+            auto center_z = _mm_set1_ps(result.center.z);
+            auto max_d2 = _mm_setzero_ps();
+            for (; i + 4 < count; i += 4)
+            {
+                __m128 x, y, z;
+                load4(positions, stride, i, x, y, z);
+                auto dx = _mm_sub_ps(x, center_x);
+                auto dy = _mm_sub_ps(y, center_y);
+                auto dz = _mm_sub_ps(z, center_z);
+                auto d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+                max_d2 = _mm_max_ps(max_d2, d2);
+            }
+            max_distance2 = horizontal_max(max_d2);
+        }
+#endif
+        for (; i < count; ++i)
+        {
+            auto d = load(positions, stride, i) - result.center;
+            max_distance2 = std::max(max_distance2, glm::dot(d, d));
+        }
+        result.radius = std::sqrt(max_distance2);
+        return result;
+    }
+
+    bounds bounds::merge(bounds const &other) const noexcept
+    {
+        if (other.is_empty())
+        {
+            return *this;
+        }
+        if (is_empty())
+        {
+            return other;
+        }
+
+        bounds result{};
+        result.min = glm::min(min, other.min);
+        result.max = glm::max(max, other.max);
+
+        auto offset = other.center - center;
+        auto distance = glm::length(offset);
+        if (distance + other.radius <= radius)
+        {
+            result.center = center;
+            result.radius = radius;
+        }
+        else if (distance + radius <= other.radius)
+        {
+            result.center = other.center;
+            result.radius = other.radius;
+        }
+        else
+        {
+            result.radius = (distance + radius + other.radius) * 0.5f;
+            result.center = center + offset * ((result.radius - radius) / distance);
+        }
+        return result;
+    }
+
+    bounds bounds::transform(glm::mat4 const &matrix) const noexcept
+    {
+        if (is_empty())
+        {
+            return *this;
+        }
+
+        bounds result{};
+        for (int corner = 0; corner < 8; ++corner)
+        {
+            glm::vec3 p{corner & 1 ? max.x : min.x, corner & 2 ? max.y : min.y, corner & 4 ? max.z : min.z};
+            auto q = glm::vec3(matrix * glm::vec4(p, 1.0f));
+            result.min = glm::min(result.min, q);
+            result.max = glm::max(result.max, q);
+        }
+        result.center = glm::vec3(matrix * glm::vec4(center, 1.0f));
+        auto scale2 = std::max({glm::dot(glm::vec3(matrix[0]), glm::vec3(matrix[0])),
+                                glm::dot(glm::vec3(matrix[1]), glm::vec3(matrix[1])),
+                                glm::dot(glm::vec3(matrix[2]), glm::vec3(matrix[2]))});
+        result.radius = radius * std::sqrt(scale2);
+        return result;
+    }
+}
@@ -0,0 +1,397 @@
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <format>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "buffer_allocator.hpp"
+
+namespace glwrap
+{
+    namespace
+    {
+        constexpr uint32_t no_node = buffer_allocation::no_node;
+
+        // Ranges of one block, offsets and sizes in units of the granularity
+        class tlsf final
+        {
+        public:
+            explicit tlsf(size_t units)
+            {
+                for (auto &heads : heads_)
+                {
+                    heads.fill(no_node);
+                }
+                insert_free(new_node(0, units, no_node, no_node));
+            }
+
+            // Node of a used range of units starting at a multiple of alignment_units, no_node if none fits.
+            uint32_t allocate(size_t units, size_t alignment_units)
+            {
+                auto node = find_free(units + alignment_units - 1);
+                if (node == no_node)
+                {
+                    return no_node;
+                }
+                remove_free(node);
+
+                auto offset = nodes_[node].offset;
+                auto aligned = (offset + alignment_units - 1) / alignment_units * alignment_units;
+                if (aligned != offset)
+                {
+                    auto rest = split(node, aligned - offset);
+                    insert_free(node);
+                    node = rest;
+                }
+                if (nodes_[node].size > units)
+                {
+                    insert_free(split(node, units));
+                }
+                ++used_count_;
+                return node;
+            }
+
+            void free(uint32_t node)
+            {
+                if (node >= nodes_.size() || nodes_[node].free || nodes_[node].unused)
+                {
+                    throw std::invalid_argument(std::format("Buffer range {} is not allocated", node));
+                }
+                --used_count_;
+                auto next = nodes_[node].next_physical;
+                if (next != no_node && nodes_[next].free)
+                {
+                    remove_free(next);
+                    nodes_[node].size += nodes_[next].size;
+                    unlink(next);
+                }
+                auto prev = nodes_[node].prev_physical;
+                if (prev != no_node && nodes_[prev].free)
+                {
+                    remove_free(prev);
+                    nodes_[prev].size += nodes_[node].size;
+                    unlink(node);
+                    node = prev;
+                }
+                insert_free(node);
+            }
+
+            size_t offset(uint32_t node) const { return nodes_[node].offset; }
+            size_t size(uint32_t node) const { return nodes_[node].size; }
+            bool empty() const noexcept { return used_count_ == 0; }
+
+            void add_stats(buffer_allocator::statistics &stats, size_t granularity) const
+            {
+                stats.allocations += used_count_;
+                for (auto &r : nodes_)
+                {
+                    if (r.unused)
+                    {
+                        continue;
+                    }
+                    auto bytes = r.size * granularity;
+                    if (r.free)
+                    {
+                        stats.free += bytes;
+                        stats.largest_free = std::max(stats.largest_free, bytes);
+                        ++stats.free_ranges;
+                    }
+                    else
+                    {
+                        stats.used += bytes;
+                    }
+                }
+            }
+
+        private:
+            static constexpr size_t sl_bits = 4;
+            static constexpr size_t sl_count = size_t{1} << sl_bits;
+            static constexpr size_t fl_count = 64 - sl_bits + 1;
+
+            struct range
+            {
+                size_t offset;
+                size_t size;
+                uint32_t prev_physical;
+                uint32_t next_physical;
+                uint32_t prev_free;
+                uint32_t next_free;
+                bool free;
+                // in unused_, waiting for reuse
+                bool unused;
+            };
+
+            // Sizes below sl_count units map linearly to the first level 0, larger ones to the level of their
+            // highest bit, split into sl_count classes by the next sl_bits bits.
+            static std::pair<size_t, size_t> mapping(size_t units) noexcept
+            {
+                if (units < sl_count)
+                {
+                    return {0, units};
+                }
+                auto f = static_cast<size_t>(std::bit_width(units)) - 1;
+                return {f - sl_bits + 1, (units >> (f - sl_bits)) ^ sl_count};
+            }
+
+            // A free range of at least units from the first non-empty class that only holds large enough ranges
+            uint32_t find_free(size_t units) const noexcept
+            {
+                if (units >= sl_count)
+                {
+                    auto round = (size_t{1} << (static_cast<size_t>(std::bit_width(units)) - 1 - sl_bits)) - 1;
+                    if (units > std::numeric_limits<size_t>::max() - round)
+                    {
+                        return no_node;
+                    }
+                    units += round;
+                }
+                auto [fl, sl] = mapping(units);
+                if (fl >= fl_count)
+                {
+                    return no_node;
+                }
+                auto sl_map = sl_bitmaps_[fl] & (~uint32_t{0} << sl);
+                if (sl_map == 0)
+                {
+                    auto fl_map = fl + 1 < fl_count ? fl_bitmap_ & (~uint64_t{0} << (fl + 1)) : 0;
+                    if (fl_map == 0)
+                    {
+                        return no_node;
+                    }
+                    fl = static_cast<size_t>(std::countr_zero(fl_map));
+                    sl_map = sl_bitmaps_[fl];
+                }
+                return heads_[fl][static_cast<size_t>(std::countr_zero(sl_map))];
+            }
+
+            uint32_t new_node(size_t offset, size_t size, uint32_t prev_physical, uint32_t next_physical)
+            {
+                range r{offset, size, prev_physical, next_physical, no_node, no_node, false, false};
+                if (!unused_.empty())
+                {
+                    auto node = unused_.back();
+                    unused_.pop_back();
+                    nodes_[node] = r;
+                    return node;
+                }
+                nodes_.push_back(r);
+                return static_cast<uint32_t>(nodes_.size() - 1);
+            }
+
+            // node keeps the first first_size units, returns the node of the rest
+            uint32_t split(uint32_t node, size_t first_size)
+            {
+                auto rest = new_node(nodes_[node].offset + first_size, nodes_[node].size - first_size, node, nodes_[node].next_physical);
+                if (auto next = nodes_[rest].next_physical; next != no_node)
+                {
+                    nodes_[next].prev_physical = rest;
+                }
+                nodes_[node].next_physical = rest;
+                nodes_[node].size = first_size;
+                return rest;
+            }
+
+            // removes a range merged into its physical neighbour
+            void unlink(uint32_t node)
+            {
+                auto prev = nodes_[node].prev_physical;
+                auto next = nodes_[node].next_physical;
+                if (prev != no_node)
+                {
+                    nodes_[prev].next_physical = next;
+                }
+                if (next != no_node)
+                {
+                    nodes_[next].prev_physical = prev;
+                }
+                nodes_[node].unused = true;
+                unused_.push_back(node);
+            }
+
+            void insert_free(uint32_t node)
+            {
+                auto [fl, sl] = mapping(nodes_[node].size);
+                auto &head = heads_[fl][sl];
+                nodes_[node].free = true;
+                nodes_[node].prev_free = no_node;
+                nodes_[node].next_free = head;
+                if (head != no_node)
+                {
+                    nodes_[head].prev_free = node;
+                }
+                head = node;
+                fl_bitmap_ |= uint64_t{1} << fl;
+                sl_bitmaps_[fl] |= uint32_t{1} << sl;
+            }
+
+            void remove_free(uint32_t node)
+            {
+                auto [fl, sl] = mapping(nodes_[node].size);
+                auto prev = nodes_[node].prev_free;
+                auto next = nodes_[node].next_free;
+                if (prev != no_node)
+                {
+                    nodes_[prev].next_free = next;
+                }
+                else
+                {
+                    heads_[fl][sl] = next;
+                }
+                if (next != no_node)
+                {
+                    nodes_[next].prev_free = prev;
+                }
+                nodes_[node].free = false;
+                if (heads_[fl][sl] == no_node)
+                {
+                    sl_bitmaps_[fl] &= ~(uint32_t{1} << sl);
+                    if (sl_bitmaps_[fl] == 0)
+                    {
+                        fl_bitmap_ &= ~(uint64_t{1} << fl);
+                    }
+                }
+            }
+
+            std::vector<range> nodes_;
+            std::vector<uint32_t> unused_;
+            uint64_t fl_bitmap_{};
+            std::array<uint32_t, fl_count> sl_bitmaps_{};
+            std::array<std::array<uint32_t, sl_count>, fl_count> heads_{};
+            size_t used_count_{};
+        };
+
+        struct block final
+        {
+            block(size_t bytes, size_t granularity) : size(bytes), ranges(bytes / granularity)
+            {
+                glCreateBuffers(1, &handle);
+                glNamedBufferStorage(handle, static_cast<GLsizeiptr>(bytes), nullptr, GL_DYNAMIC_STORAGE_BIT);
+            }
+
+            block(block const &) = delete;
+            block &operator=(block const &) = delete;
+
+            ~block() { glDeleteBuffers(1, &handle); }
+
+            GLuint handle{};
+            size_t size;
+            tlsf ranges;
+        };
+    }
+
+    struct buffer_allocator::buffer_allocator_impl final
+    {
+        size_t block_size;
+        size_t granularity;
+        // released blocks leave empty slots, so the block index of live allocations stays valid
+        std::vector<std::unique_ptr<block>> blocks;
+
+        buffer_allocation allocate_in(uint32_t index, size_t units, size_t alignment_units)
+        {
+            auto &b = *blocks[index];
+            auto node = b.ranges.allocate(units, alignment_units);
+            if (node == no_node)
+            {
+                return {};
+            }
+            return {
+                .buffer = b.handle,
+                .offset = static_cast<GLintptr>(b.ranges.offset(node) * granularity),
+                .size = static_cast<GLsizeiptr>(b.ranges.size(node) * granularity),
+                .block = index,
+                .node = node,
+            };
+        }
+    };
+
+    buffer_allocator &buffer_allocator::instance()
+    {
+        // blocks go with their last allocation, so nothing is left to delete once the GL context is gone
+        static buffer_allocator allocator;
+        return allocator;
+    }
+
+    buffer_allocator::buffer_allocator(size_t block_size, size_t granularity)
+        : impl_(std::make_unique<buffer_allocator_impl>())
+    {
+        if (!std::has_single_bit(granularity) || block_size < granularity)
+        {
+            throw std::invalid_argument(std::format("Invalid buffer allocator granularity {} for blocks of {} bytes", granularity, block_size));
+        }
+        impl_->block_size = block_size / granularity * granularity;
+        impl_->granularity = granularity;
+    }
+
+    buffer_allocator::buffer_allocator(buffer_allocator &&other) noexcept = default;
+    buffer_allocator &buffer_allocator::operator=(buffer_allocator &&other) noexcept = default;
+    buffer_allocator::~buffer_allocator() = default;
+
+    buffer_allocation buffer_allocator::allocate(size_t size, size_t alignment)
+    {
+        if (size == 0 || !std::has_single_bit(alignment))
+        {
+            throw std::invalid_argument(std::format("Invalid buffer allocation of {} bytes aligned to {}", size, alignment));
+        }
+        auto granularity = impl_->granularity;
+        auto units = (size + granularity - 1) / granularity;
+        auto alignment_units = std::max(alignment, granularity) / granularity;
+
+        auto &blocks = impl_->blocks;
+        for (uint32_t i = 0; i < blocks.size(); ++i)
+        {
+            if (blocks[i])
+            {
+                if (auto allocation = impl_->allocate_in(i, units, alignment_units); allocation.is_valid())
+                {
+                    return allocation;
+                }
+            }
+        }
+
+        // offset 0 of a new block is aligned to anything
+        auto slot = std::ranges::find_if(blocks, [](auto const &b) { return !b; });
+        auto index = static_cast<uint32_t>(slot - blocks.begin());
+        auto b = std::make_unique<block>(std::max(impl_->block_size, units * granularity), granularity);
+        if (slot == blocks.end())
+        {
+            blocks.push_back(std::move(b));
+        }
+        else
+        {
+            *slot = std::move(b);
+        }
+        return impl_->allocate_in(index, units, alignment_units);
+    }
+
+    void buffer_allocator::free(buffer_allocation const &allocation)
+    {
+        auto &blocks = impl_->blocks;
+        if (allocation.block >= blocks.size() || !blocks[allocation.block] || blocks[allocation.block]->handle != allocation.buffer)
+        {
+            throw std::invalid_argument(std::format("Buffer allocation of block {} does not belong to this allocator", allocation.block));
+        }
+        auto &b = blocks[allocation.block];
+        b->ranges.free(allocation.node);
+        if (b->ranges.empty())
+        {
+            b.reset();
+        }
+    }
+
+    buffer_allocator::statistics buffer_allocator::stats() const
+    {
+        statistics result{};
+        for (auto &b : impl_->blocks)
+        {
+            if (b)
+            {
+                ++result.blocks;
+                result.reserved += b->size;
+                b->ranges.add_stats(result, impl_->granularity);
+            }
+        }
+        return result;
+    }
+}
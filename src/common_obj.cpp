@@ -1,4 +1,5 @@
 #include "common_obj.hpp"
+#include "texture_cache.hpp"
 
 using namespace std::literals;
 using namespace glwrap;
@@ -144,8 +145,8 @@ struct wooden_box::wooden_box_impl
     shader_uniform dir_light_color{program_.uniform("dirLight.color")};
     shader_uniform ambient_light_{program_.uniform("ambientLight")};
 
-    texture2d diffuse_tex_{"resources/textures/container2.png"sv, true};
-    texture2d specular_tex_{"resources/textures/container2_specular.png"sv, true};
+    std::shared_ptr<texture2d> diffuse_tex_{texture_cache::instance().load("resources/textures/container2.png"sv, true)};
+    std::shared_ptr<texture2d> specular_tex_{texture_cache::instance().load("resources/textures/container2_specular.png"sv, true)};
 
     vertex_array varray_{vertex_array::load_simple_json("resources/simple_vertices/wooden_box.jsonc")};
 
@@ -208,8 +209,8 @@ struct wooden_box::wooden_box_impl
             view_position_.set_vec3(view_info.position());
         }
 
-        diffuse_tex_.bind_unit(0);
-        specular_tex_.bind_unit(1);
+        diffuse_tex_->bind_unit(0);
+        specular_tex_->bind_unit(1);
 
         varray_.draw(draw_mode::triangles, 0, 36);
 
@@ -0,0 +1,77 @@
+#include "cpu_features.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#define CPU_FEATURES_X86 1
+#else
+#define CPU_FEATURES_X86 0
+#endif
+
+namespace
+{
+#if CPU_FEATURES_X86
+    void cpuid(unsigned leaf, unsigned (&regs)[4]) noexcept
+    {
+#if defined(_MSC_VER) && !defined(__clang__)
+        int info[4];
+        __cpuidex(info, static_cast<int>(leaf), 0);
+        for (int i = 0; i < 4; ++i)
+        {
+            regs[i] = static_cast<unsigned>(info[i]);
+        }
+#else
+        __cpuid_count(leaf, 0, regs[0], regs[1], regs[2], regs[3]);
+#endif
+    }
+
+    // YMM state enabled by the OS
+    bool os_saves_ymm() noexcept
+    {
+#if defined(_MSC_VER) && !defined(__clang__)
+        return (_xgetbv(0) & 0x6) == 0x6;
+#else
+        unsigned eax, edx;
+        __asm__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+        return (eax & 0x6) == 0x6;
+#endif
+    }
+
+    utils::cpu_features detect() noexcept
+    {
+        unsigned regs[4];
+        cpuid(0, regs);
+        auto max_leaf = regs[0];
+
+        cpuid(1, regs);
+        bool osxsave = (regs[2] & (1u << 27)) != 0;
+        bool avx = (regs[2] & (1u << 28)) != 0 && osxsave && os_saves_ymm();
+        utils::cpu_features features{};
+        features.fma = avx && (regs[2] & (1u << 12)) != 0;
+        features.f16c = avx && (regs[2] & (1u << 29)) != 0;
+        if (max_leaf >= 7)
+        {
+            cpuid(7, regs);
+            features.avx2 = avx && (regs[1] & (1u << 5)) != 0;
+        }
+        return features;
+    }
+#else
+    utils::cpu_features detect() noexcept
+    {
+        return {};
+    }
+#endif
+}
+
+namespace utils
+{
+    cpu_features const &detect_cpu_features() noexcept
+    {
+        static cpu_features const features = detect();
+        return features;
+    }
+}
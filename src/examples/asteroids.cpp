@@ -5,6 +5,7 @@
 #include "model.hpp"
 #include "examples.hpp"
 #include "utils.hpp"
+#include "imgui.h"
 
 using namespace glwrap;
 
@@ -44,19 +45,32 @@ public:
             mats_.push_back(mat);
         }
 
-        attach_to_varray2(mats_);
+        attach_to_varray2();
+
+        // largest error of every level over all meshes, so one instance order serves all of them
+        for (auto &m : asteroid_model_.meshes())
+        {
+            auto lods = m.get_lods();
+            lod_bounds_.resize(std::max(lod_bounds_.size(), lods.size()), mesh_lod{0, 0, 0.0f});
+            for (size_t i = 0; i < lod_bounds_.size(); ++i)
+            {
+                lod_bounds_[i].error = std::max(lod_bounds_[i].error, lods[std::min(i, lods.size() - 1)].error);
+            }
+        }
 
         glClearColor(0, 0, 0, 0);
     }
 
-    void attach_to_varray2(std::vector<glm::mat4> const &mats)
+    // The instance matrices are streamed every frame, so they are bound as a range of the ring and rebound per frame
+    void attach_to_varray2()
     {
-        auto models = vertex_buffer(mats);
+        instances_.emplace(static_cast<size_t>(amount_));
 
         for (auto &m : asteroid_model_.meshes())
         {
             auto &varray = m.get_varray();
-            auto binding_index = varray.attach_vbuffer(models);
+            auto binding_index = varray.attach_vbuffer_range(instances_->handle(), 0, sizeof(glm::mat4));
+            instance_bindings_.push_back(binding_index);
 
             varray.enable_attrib(3);
             varray.attrib_format(3, binding_index, 4, GL_FLOAT, GL_FALSE, 0);
@@ -80,6 +94,28 @@ public:
         //return camera(glm::vec3(0, 0, 50.0f), glm::vec3(0, 1, 0), -100);
     }
 
+    void reset_frame_buffer(GLsizei screen_width, GLsizei screen_height) override
+    {
+        screen_height_ = screen_height;
+    }
+
+    void draw_gui() override
+    {
+        ImGui::Checkbox("LODs", &use_lods_);
+        ImGui::SameLine();
+        ImGui::SliderFloat("Max error (px)", &lod_threshold_, 0.25f, 8.0f);
+
+        auto fps = ImGui::GetIO().Framerate;
+        ImGui::Text("%s", std::format("Triangles: {} per frame, {:.1f} M/s", drawn_triangles_, drawn_triangles_ * fps / 1e6f).c_str());
+        ImGui::Text("%s", std::format("Without LODs: {} per frame, {:.1f} M/s", full_triangles_, full_triangles_ * fps / 1e6f).c_str());
+        std::string per_lod = "Instances per LOD:";
+        for (auto count : lod_instances_)
+        {
+            per_lod += std::format(" {}", count);
+        }
+        ImGui::Text("%s", per_lod.c_str());
+    }
+
     void draw(glm::mat4 const &projection, camera &cam) override
     {
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -103,9 +139,54 @@ public:
         }
     }
 
+    // LOD level of an instance from the projected size of its geometric error
+    size_t select_instance_lod(glm::mat4 const &projection, glm::mat4 const &view, glm::mat4 const &mat) const
+    {
+        if (!use_lods_)
+        {
+            return 0;
+        }
+        auto scale = glm::length(glm::vec3(mat[0]));
+        auto distance = glm::length(glm::vec3(view * mat[3]));
+        auto pixels_per_unit = projection[1][1] * static_cast<float>(screen_height_) * 0.5f * scale;
+        return select_lod(lod_bounds_, distance, pixels_per_unit, lod_threshold_);
+    }
+
+    // Writes this frame's instance matrices so that the instances of every LOD level are contiguous
+    void bucket_instances(glm::mat4 const &projection, glm::mat4 const &view)
+    {
+        instance_lods_.resize(amount_);
+        lod_instances_.assign(lod_bounds_.size(), 0);
+        for (auto i = 0; i < amount_; ++i)
+        {
+            instance_lods_[i] = select_instance_lod(projection, view, mats_[i]);
+            ++lod_instances_[instance_lods_[i]];
+        }
+
+        std::vector<size_t> offsets(lod_instances_.size(), 0);
+        for (size_t level = 1; level < offsets.size(); ++level)
+        {
+            offsets[level] = offsets[level - 1] + lod_instances_[level - 1];
+        }
+        auto slice = instances_->allocate(static_cast<size_t>(amount_));
+        for (auto i = 0; i < amount_; ++i)
+        {
+            slice.data[offsets[instance_lods_[i]]++] = mats_[i];
+        }
+        auto &meshes = asteroid_model_.meshes();
+        for (size_t i = 0; i < instance_bindings_.size(); ++i)
+        {
+            meshes[i].get_varray().set_vbuffer_range(instance_bindings_[i], instances_->handle(), slice.offset, sizeof(glm::mat4));
+        }
+    }
+
     void draw_asteroids(glm::mat4 const &projection, glm::mat4 const &view)
     {
+        drawn_triangles_ = 0;
+        full_triangles_ = 0;
         if (draw_instanced_) {
+            bucket_instances(projection, view);
+
             asteroid_instanced_program_.use();
             asteroid_instanced_projection_.set_mat4(projection);
             asteroid_instanced_view_.set_mat4(view);
@@ -114,8 +195,23 @@ public:
                 m.get_texture(texture_type::diffuse).bind_unit(0);
                 asteroid_diffuse0_.set_int(0);
                 auto &varray = m.get_varray();
-                varray.draw_instanced(draw_mode::triangles, amount_);
+                auto lods = m.get_lods();
+                GLuint base_instance = 0;
+                for (size_t level = 0; level < lod_instances_.size(); ++level)
+                {
+                    auto count = static_cast<GLsizei>(lod_instances_[level]);
+                    if (count == 0)
+                    {
+                        continue;
+                    }
+                    auto &lod = lods[std::min(level, lods.size() - 1)];
+                    varray.draw_instanced(draw_mode::triangles, lod.first_index, lod.index_count, count, base_instance);
+                    base_instance += count;
+                    drawn_triangles_ += lod_instances_[level] * lod.index_count / 3;
+                }
+                full_triangles_ += amount_ * lods[0].index_count / 3;
             }
+            instances_->end_frame();
         }
         else {
             asteroid_program_.use();
@@ -123,12 +219,17 @@ public:
             for (auto i = 0; i < amount_; ++i) {
                 auto &mat = mats_[i];
                 asteroid_model_view_.set_mat4(view * mat);
+                auto level = select_instance_lod(projection, view, mat);
                 for (auto &m : asteroid_model_.meshes())
                 {
                     m.get_texture(texture_type::diffuse).bind_unit(0);
                     asteroid_diffuse0_.set_int(0);
                     auto &varray = m.get_varray();
-                    varray.draw(draw_mode::triangles);
+                    auto lods = m.get_lods();
+                    auto &lod = lods[std::min(level, lods.size() - 1)];
+                    varray.draw(lod.first_index, lod.index_count);
+                    drawn_triangles_ += lod.index_count / 3;
+                    full_triangles_ += lods[0].index_count / 3;
                 }
             }
         }
@@ -148,7 +249,7 @@ public:
     shader_uniform planet_model_view_{planet_program_.uniform("modelView")};
     shader_uniform planet_diffuse0_{planet_program_.uniform("textureDiffuse0")};
 
-    model asteroid_model_{model::load_file("resources/models/rock/rock.obj", texture_type::diffuse)};
+    model asteroid_model_{model::load_file("resources/models/rock/rock.obj", texture_type::diffuse, default_load_flags | load_flags::lods)};
 
     shader_program asteroid_program_{
         shader::compile_file("shaders/straight_vs.glsl", shader_type::vertex),
@@ -169,6 +270,17 @@ public:
     shader_uniform asteroid_instanced_diffuse0_{asteroid_instanced_program_.uniform("textureDiffuse0")};
 
     std::vector<glm::mat4> mats_;
+    std::optional<dynamic_ring_buffer<glm::mat4>> instances_;
+    std::vector<size_t> instance_bindings_;
+
+    bool use_lods_{true};
+    float lod_threshold_{1.0f};
+    GLsizei screen_height_{1};
+    std::vector<mesh_lod> lod_bounds_;
+    std::vector<size_t> instance_lods_;
+    std::vector<size_t> lod_instances_;
+    size_t drawn_triangles_{};
+    size_t full_triangles_{};
 };
 
 std::unique_ptr<example> create_asteroids()
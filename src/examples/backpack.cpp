@@ -3,8 +3,10 @@
 #include "examples.hpp"
 
 #include "model.hpp"
+#include "meshlet.hpp"
 #include "skybox.hpp"
 #include "camera.hpp"
+#include "imgui.h"
 
 using namespace glwrap;
 
@@ -16,6 +18,21 @@ public:
         return camera::look_at_camera(glm::vec3(-5.0f, 2.0f, 10.0f));
     }
 
+    void draw_gui() override
+    {
+        auto mode = static_cast<int>(cull_mode_);
+        ImGui::RadioButton("Whole meshes", &mode, static_cast<int>(meshlets::cull_mode::none));
+        ImGui::SameLine();
+        ImGui::RadioButton("CPU culling", &mode, static_cast<int>(meshlets::cull_mode::cpu));
+        ImGui::SameLine();
+        ImGui::RadioButton("GPU culling", &mode, static_cast<int>(meshlets::cull_mode::gpu));
+        cull_mode_ = static_cast<meshlets::cull_mode>(mode);
+        if (cull_mode_ != meshlets::cull_mode::gpu)
+        {
+            ImGui::Text("%s", std::format("{}", culler_.stats()).c_str());
+        }
+    }
+
     void draw(glm::mat4 const &projection, camera & cam) override
     {
         auto view = cam.view();
@@ -24,22 +41,26 @@ public:
 
         program_.use();
         projection_.set_mat4(projection);
-        model_view_.set_mat4(view);
+        culler_.reset_stats();
         for (auto & mesh : model_.meshes()) {
-            auto & varray = mesh.get_varray();
+            auto &world = mesh.transform();
+            model_view_.set_mat4(view * world);
             if (mesh.has_texture(texture_type::diffuse))
             {
                 auto &texture = mesh.get_texture(texture_type::diffuse);
                 texture.bind_unit(0);
                 diffuse0_.set_int(0);
             }
-            varray.draw(draw_mode::triangles);
+            auto mesh_eye = glm::vec3(glm::inverse(world) * glm::vec4(cam.position(), 1.0f));
+            culler_.draw(mesh, projection * view * world, mesh_eye, {.mode = cull_mode_});
         }
     }
 
 private:
-    skybox skybox_{glwrap::cubemap{"resources/cubemaps/skybox", ".jpg"}};
+    skybox skybox_{glwrap::cubemap{texture_container::load_or_bake_cubemap("resources/cubemaps/skybox", ".jpg", {.srgb = true})}};
     model model_{model::load_file("resources/models/backpack_modified/backpack.obj", texture_type::diffuse | texture_type::specular)};
+    meshlets::culler culler_;
+    meshlets::cull_mode cull_mode_{meshlets::cull_mode::gpu};
 
     shader_program program_{
         shader::compile_file("shaders/straight_vs.glsl", shader_type::vertex),
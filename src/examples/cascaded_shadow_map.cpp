@@ -7,6 +7,7 @@
 #include "common_obj.hpp"
 #include "examples.hpp"
 #include "skybox.hpp"
+#include "texture_cache.hpp"
 #include "imgui.h"
 
 using namespace glwrap;
@@ -22,6 +23,13 @@ class cascaded_shadow_map final : public example
     const int shadow_map_unit = 3;
 
 public:
+    cascaded_shadow_map()
+    {
+        floor_program_.uniform_block_binding("Cascades", cascades_binding);
+        wbox_.program().uniform_block_binding("Cascades", cascades_binding);
+        shadow_cast_program_.uniform_block_binding("Cascades", cascades_binding);
+    }
+
     bool custom_render() override { return true; }
 
     void reset_frame_buffer(GLsizei width, GLsizei height) override
@@ -109,8 +117,12 @@ public:
             min_z = min_z < 0 ? min_z * z_mult : min_z / z_mult;
             max_z = max_z < 0 ? max_z / z_mult : max_z * z_mult;
             auto light_projection = glm::ortho(min_x, max_x, min_y, max_y, min_z, max_z);
-            light_space_mats_[i] = light_projection * light_view;
+            cascades_.light_space_mats[i] = light_projection * light_view;
+            cascades_.plane_distances[i].x = fz;
         }
+        cascades_.count = cascaded_level_count;
+        cascades_buffer_.set(cascades_);
+        cascades_buffer_.bind_base(cascades_binding);
 
         glCullFace(GL_FRONT);
         draw_scene(projection, nullptr, true);
@@ -193,23 +205,32 @@ private:
         return res;
     }
 
-    std::array<glm::mat4, cascaded_level_count> light_space_mats_;
+    // Cascades block shared by the shadow cast and lighting programs
+    struct cascades_block
+    {
+        using block_desc_t = std::tuple<std::array<glm::mat4, 8>, std::array<glm::vec4, 8>, std::int32_t>;
+        std::array<glm::mat4, 8> light_space_mats;
+        // float[8] in the shader, std140 gives every element of a scalar array 16 bytes
+        std::array<glm::vec4, 8> plane_distances;
+        std::int32_t count;
+    };
+    static_assert(cascaded_level_count <= 8, "Cascades block holds up to 8 levels");
+
+    static constexpr GLuint cascades_binding = 0;
+    cascades_block cascades_{};
+    typed_uniform_buffer<cascades_block> cascades_buffer_;
 
     void draw_scene(glm::mat4x4 const &proj, camera *cam, bool shadow_casting)
     {
         if (shadow_casting)
         {
             shadow_cast_program_.use();
-            for (int i = 0; i < cascaded_level_count; ++i)
-            {
-                shadow_cast_mats_[i].set(light_space_mats_[i]);
-            }
             shadow_cast_model_.set(glm::mat4(1.0f));
         }
         else
         {
             floor_program_.use();
-            floor_tex_.bind_unit(0);
+            floor_tex_->bind_unit(0);
             floor_projection_.set(proj);
             floor_view_.set(cam->view());
             floor_model_.set(glm::mat4(1.0f));
@@ -217,17 +238,7 @@ private:
             floor_view_position_.set(cam->position());
             floor_dir_light_color_.set(light_color);
             floor_dir_light_dir_.set(light_dir);
-            for (int i = 0; i < cascaded_level_count; ++i)
-            {
-                floor_light_space_mats_[i].set(light_space_mats_[i]);
-            }
             floor_ambient_light_.set(ambient_light);
-
-            auto near_z = cam->near_z(), far_z = cam->far_z(), range_z = far_z - near_z;
-            for (int i = 0; i < cascaded_level_count; ++i) {
-                floor_cascade_plane_distances_[i].set(cascaded_levels[i + 1] * range_z + near_z);
-                wbox_cascade_plane_distances_[i].set(cascaded_levels[i + 1] * range_z + near_z);
-            }
         }
 
         floor_varray_.draw(draw_mode::triangles);
@@ -278,14 +289,13 @@ private:
             {{25.0f, -0.5f, -25.0f}, {0.0f, 1.0f, 0.0f}, {25.0f, 25.0f}},
             {{-25.0f, -0.5f, -25.0f}, {0.0f, 1.0f, 0.0f}, {0.0f, 25.0f}},
         })};
-    texture2d floor_tex_{"resources/textures/wood.png"_path, true, texture2d_elem_type::u8, texture2d_format::unspecified};
+    std::shared_ptr<texture2d> floor_tex_{texture_cache::instance().load("resources/textures/wood.png"_path, true, texture2d_elem_type::u8, texture2d_format::unspecified)};
     shader_program floor_program_{make_vf_program(
         "shaders/common/simple_position_normal_texcoord_vs.glsl"_path,
         "shaders/cascaded_shadow_blinn_phong_fs.glsl"_path,
         "diffuseTexture", 0,
         "specularTexture", 1,
         "dirLight.shadowMap", shadow_map_unit,
-        "dirLight.cascadeCount", cascaded_level_count,
         "hasDirLight", true)};
     shader_uniform floor_projection_{floor_program_.uniform("projection")};
     shader_uniform floor_model_{floor_program_.uniform("model")};
@@ -294,24 +304,18 @@ private:
     shader_uniform floor_normal_mat_{floor_program_.uniform("normalMat")};
     shader_uniform floor_dir_light_color_{floor_program_.uniform("dirLight.color")};
     shader_uniform floor_dir_light_dir_{floor_program_.uniform("dirLight.dir")};
-    std::array<shader_uniform, cascaded_level_count> floor_light_space_mats_ = utils::make_uniform_array<cascaded_level_count>(floor_program_, "dirLight.lightSpaceMats");
-    std::array<shader_uniform, cascaded_level_count> floor_cascade_plane_distances_ = utils::make_uniform_array<cascaded_level_count>(floor_program_, "dirLight.cascadePlaneDistances");
     shader_uniform floor_ambient_light_{floor_program_.uniform("ambientLight")};
 
     wooden_box wbox_{
         make_vf_program(
             "shaders/common/simple_position_normal_texcoord_vs.glsl"_path,
             "shaders/cascaded_shadow_blinn_phong_fs.glsl"_path,
-            "dirLight.shadowMap", shadow_map_unit,
-            "dirLight.cascadeCount", cascaded_level_count)};
-    std::array<shader_uniform, cascaded_level_count> wbox_light_space_mats_ = utils::make_uniform_array<cascaded_level_count>(wbox_.program(), "dirLight.lightSpaceMats");
-    std::array<shader_uniform, cascaded_level_count> wbox_cascade_plane_distances_ = utils::make_uniform_array<cascaded_level_count>(wbox_.program(), "dirLight.cascadePlaneDistances");
+            "dirLight.shadowMap", shadow_map_unit)};
 
     shader_program shadow_cast_program_{make_vgf_program(
         "shaders/cascaded_shadow_cast_vs.glsl"_path,
         "shaders/cascaded_shadow_cast_gs.glsl"_path,
         "shaders/shadow_cast_fs.glsl"_path)};
-    std::array<shader_uniform, cascaded_level_count> shadow_cast_mats_ = utils::make_uniform_array<cascaded_level_count>(shadow_cast_program_, "lightSpaceMats");
 
     shader_uniform shadow_cast_model_{shadow_cast_program_.uniform("model")};
 
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <random>
 #include <cmath>
 
@@ -15,14 +16,15 @@ class deferred final : public example
 public:
     deferred()
     {
-        for (size_t i = 0; i < lights_.size(); ++i)
+        // instance i of the multi draw reads the matrices of instance i, base_instance included
+        auto &varray = backpack_.meshes().front().get_varray();
+        auto binding_index = static_cast<GLuint>(varray.attach_vbuffer_range(backpack_instances_.handle(), backpack_instances_.offset(), sizeof(instance_t)));
+        for (GLuint column = 0; column < 8; ++column)
         {
-            auto &light = lights_[i];
-            light_uniform_t{g_lighting_program_, i}.set(light);
-            light_uniform_t{g_lighting_no_position_program_, i}.set(light);
+            varray.enable_attrib(4 + column);
+            varray.attrib_format(4 + column, binding_index, 4, GL_FLOAT, GL_FALSE, column * static_cast<GLuint>(sizeof(glm::vec4)));
         }
-        g_lighting_program_.uniform("lightCount").set_int(light_count);
-        g_lighting_no_position_program_.uniform("lightCount").set_int(light_count);
+        varray.binding_divisor(binding_index, 1);
     }
 
     std::optional<camera> get_camera() override
@@ -91,20 +93,14 @@ public:
         (reconstruct_position_ ? g_no_position_projection_ : g_projection_).set_mat4(projection);
         (reconstruct_position_ ? g_no_position_view_ : g_view_).set_mat4(view);
 
-        for (auto &pos : backpack_positions_)
+        auto &meshes = backpack_.meshes();
+        auto &varray = meshes.front().get_varray();
+        for (auto [first, count] : backpack_batches_)
         {
-            auto model = glm::translate(glm::mat4(1), pos);
-
-            (reconstruct_position_ ? g_no_position_model_ : g_model_).set_mat4(model);
-            (reconstruct_position_ ? g_no_position_normal_mat_ : g_normal_mat_).set_mat4(glm::transpose(glm::inverse(model)));
-            for (auto &mesh : backpack_.meshes())
-            {
-                mesh.get_texture(texture_type::diffuse).bind_unit(0);
-                mesh.get_texture(texture_type::specular).bind_unit(1);
-                mesh.get_texture(texture_type::normal).bind_unit(2);
-                auto &varray = mesh.get_varray();
-                varray.draw(draw_mode::triangles);
-            }
+            meshes[first].get_texture(texture_type::diffuse).bind_unit(0);
+            meshes[first].get_texture(texture_type::specular).bind_unit(1);
+            meshes[first].get_texture(texture_type::normal).bind_unit(2);
+            varray.multi_draw_indirect(draw_mode::triangles, backpack_commands_, first, count);
         }
 
         auto &pb = post_buffer_.value();
@@ -117,6 +113,7 @@ public:
         if (draw_type_ == draw_type::single_pass)
         {
             // lighting pass
+            lights_buffer_.bind_base(lights_binding);
             if (reconstruct_position_)
             {
                 gb.depth_texture().bind_unit(0);
@@ -311,9 +308,7 @@ private:
         "specularTexture", 1,
         "normalTexture", 2)};
     shader_uniform g_projection_{g_buffer_program_.uniform("projection")};
-    shader_uniform g_model_{g_buffer_program_.uniform("model")};
     shader_uniform g_view_{g_buffer_program_.uniform("view")};
-    shader_uniform g_normal_mat_{g_buffer_program_.uniform("normalMat")};
 
     shader_program g_buffer_no_position_program_{make_vf_program(
         "shaders/deferred/g_buffer_no_position_vs.glsl"_path,
@@ -322,9 +317,7 @@ private:
         "specularTexture", 1,
         "normalTexture", 2)};
     shader_uniform g_no_position_projection_{g_buffer_no_position_program_.uniform("projection")};
-    shader_uniform g_no_position_model_{g_buffer_no_position_program_.uniform("model")};
     shader_uniform g_no_position_view_{g_buffer_no_position_program_.uniform("view")};
-    shader_uniform g_no_position_normal_mat_{g_buffer_no_position_program_.uniform("normalMat")};
 
     shader_program g_lighting_program_{make_vf_program(
         "shaders/base/fbuffer_vs.glsl"_path,
@@ -401,7 +394,62 @@ private:
         "shaders/common/pure_color_fs.glsl"_path)};
 
     model backpack_{model::load_file("resources/models/backpack_modified/backpack.obj",
-                                     texture_type::diffuse | texture_type::normal | texture_type::specular)};
+                                     texture_type::diffuse | texture_type::normal | texture_type::specular,
+                                     default_load_flags | load_flags::shared_arena)};
+
+    struct instance_t
+    {
+        glm::mat4 model;
+        glm::mat4 normal_mat;
+    };
+
+    // mesh-major: the instances of mesh m start at m * backpack_positions_.size()
+    vertex_buffer<instance_t> backpack_instances_ = [this]
+    {
+        std::vector<instance_t> instances;
+        for (auto &mesh : backpack_.meshes())
+        {
+            for (auto &pos : backpack_positions_)
+            {
+                auto model = glm::translate(glm::mat4(1), pos) * mesh.transform();
+                instances.push_back({model, glm::transpose(glm::inverse(model))});
+            }
+        }
+        return vertex_buffer<instance_t>(instances);
+    }();
+
+    // one command per mesh, drawing it at every position
+    indirect_buffer<draw_elements_indirect_command> backpack_commands_ = [this]
+    {
+        auto instance_count = static_cast<GLuint>(backpack_positions_.size());
+        std::vector<draw_elements_indirect_command> commands;
+        for (auto &mesh : backpack_.meshes())
+        {
+            commands.push_back(mesh.draw_command(instance_count, static_cast<GLuint>(commands.size()) * instance_count));
+        }
+        return indirect_buffer<draw_elements_indirect_command>(std::span<draw_elements_indirect_command const>(commands));
+    }();
+
+    // (first mesh, mesh count) of consecutive meshes sharing their textures, one multi draw each
+    std::vector<std::pair<size_t, size_t>> backpack_batches_ = [this]
+    {
+        auto same_textures = [](mesh &a, mesh &b)
+        {
+            return std::ranges::all_of(std::array{texture_type::diffuse, texture_type::specular, texture_type::normal},
+                                       [&](auto type) { return &a.get_texture(type) == &b.get_texture(type); });
+        };
+        auto &meshes = backpack_.meshes();
+        std::vector<std::pair<size_t, size_t>> batches;
+        for (size_t i = 0; i < meshes.size(); ++i)
+        {
+            if (batches.empty() || !same_textures(meshes[batches.back().first], meshes[i]))
+            {
+                batches.emplace_back(i, 0);
+            }
+            ++batches.back().second;
+        }
+        return batches;
+    }();
 
     shader_program post_program_{make_vf_program(
         "shaders/base/fbuffer_vs.glsl"_path,
@@ -447,28 +495,35 @@ private:
         return lights;
     }();
 
-    struct light_uniform_t
+    // Light of the single pass lighting shaders, read from a storage buffer so the light count has no fixed limit
+    struct light_block
     {
-        shader_uniform position;
-        shader_uniform attenuation;
-        shader_uniform color;
-        shader_uniform range;
-        light_uniform_t(shader_program &p, size_t index)
-            : position{p.uniform(std::format("lights[{}].position", index))},
-              attenuation{p.uniform(std::format("lights[{}].attenuation", index))},
-              color{p.uniform(std::format("lights[{}].color", index))},
-              range{p.uniform(std::format("lights[{}].range", index))}
-        {
-        }
+        using block_desc_t = std::tuple<glm::vec3, float, glm::vec3, float, glm::vec3, float>;
+        glm::vec3 position;
+        float padding0;
+        glm::vec3 attenuation;
+        float padding1;
+        glm::vec3 color;
+        float range;
+    };
 
-        void set(light_t const &light)
+    static constexpr GLuint lights_binding = 0;
+    storage_buffer<light_block> lights_buffer_ = [this]
+    {
+        std::vector<light_block> blocks;
+        for (auto &light : lights_)
         {
-            position.set_vec3(light.position);
-            attenuation.set_vec3(light.attenuation);
-            color.set_vec3(light.color);
-            range.set_float(light.range);
+            blocks.push_back(light_block{
+                .position = light.position,
+                .padding0 = 0.0f,
+                .attenuation = light.attenuation,
+                .padding1 = 0.0f,
+                .color = light.color,
+                .range = light.range,
+            });
         }
-    };
+        return storage_buffer<light_block>(std::span<light_block const>(blocks));
+    }();
 
     // -------- frame buffer --------------
 
@@ -1,6 +1,7 @@
 #include "examples.hpp"
 #include "utils.hpp"
 #include "common_obj.hpp"
+#include "texture_cache.hpp"
 
 using namespace glwrap;
 using namespace std::literals;
@@ -75,11 +76,11 @@ public:
             texture_projection_.set_mat4(projection);
             texture_view_uniform_.set_mat4(view);
             texture_view_pos_.set_vec3(view_pos);
-            base_color_tex_.bind_unit(0);
-            normal_tex_.bind_unit(1);
-            metallic_tex_.bind_unit(2);
-            roughness_tex_.bind_unit(3);
-            ao_tex_.bind_unit(4);
+            base_color_tex_->bind_unit(0);
+            normal_tex_->bind_unit(1);
+            metallic_tex_->bind_unit(2);
+            roughness_tex_->bind_unit(3);
+            ao_tex_->bind_unit(4);
 
             for (int i = 0; i < count; ++i)
             {
@@ -171,11 +172,11 @@ private:
     shader_uniform texture_model_uniform_{texture_program_.uniform("model")};
     shader_uniform texture_normal_mat_uniform_{texture_program_.uniform("normalMat")};
     shader_uniform texture_view_pos_{texture_program_.uniform("viewPos")};
-    texture2d base_color_tex_{"resources/textures/rustediron/basecolor.png", true};
-    texture2d normal_tex_{"resources/textures/rustediron/normal.png"};
-    texture2d metallic_tex_{"resources/textures/rustediron/metallic.png"};
-    texture2d roughness_tex_{"resources/textures/rustediron/roughness.png"};
-    texture2d ao_tex_{"resources/textures/rustediron/ao.png"};
+    std::shared_ptr<texture2d> base_color_tex_{texture_cache::instance().load("resources/textures/rustediron/basecolor.png", true)};
+    std::shared_ptr<texture2d> normal_tex_{texture_cache::instance().load("resources/textures/rustediron/normal.png")};
+    std::shared_ptr<texture2d> metallic_tex_{texture_cache::instance().load("resources/textures/rustediron/metallic.png")};
+    std::shared_ptr<texture2d> roughness_tex_{texture_cache::instance().load("resources/textures/rustediron/roughness.png")};
+    std::shared_ptr<texture2d> ao_tex_{texture_cache::instance().load("resources/textures/rustediron/ao.png")};
 };
 
 std::unique_ptr<example> create_direct_light_pbr()
@@ -3,6 +3,7 @@
 #include "examples.hpp"
 #include "utils.hpp"
 
+#include "texture_cache.hpp"
 #include "imgui.h"
 
 using namespace std::literals;
@@ -70,7 +71,7 @@ public:
         model = glm::scale(model, glm::vec3(2.5f, 2.5f, 27.5f));
         model_.set_mat4(model);
 
-        diffuse_.bind_unit(0);
+        diffuse_->bind_unit(0);
 
         varray_.draw(draw_mode::triangles);
     }
@@ -87,7 +88,7 @@ private:
 
     vertex_array varray_{vertex_array::load_simple_json("resources/simple_vertices/hdr_scene.jsonc")};
 
-    texture2d diffuse_{"resources/textures/wood.png"sv, true};
+    std::shared_ptr<texture2d> diffuse_{texture_cache::instance().load("resources/textures/wood.png"sv, true)};
 
     shader_program hdr_light_program_{make_vf_program(
         "shaders/hdr_light_vs.glsl"_path,
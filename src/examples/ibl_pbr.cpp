@@ -2,6 +2,7 @@
 #include "common_obj.hpp"
 #include "utils.hpp"
 #include "skybox.hpp"
+#include "texture_cache.hpp"
 
 using namespace glwrap;
 using namespace std::literals;
@@ -163,11 +164,11 @@ public:
             texture_projection_.set_mat4(projection);
             texture_view_uniform_.set_mat4(view);
             texture_view_pos_.set_vec3(view_pos);
-            base_color_tex_.bind_unit(0);
-            normal_tex_.bind_unit(1);
-            metallic_tex_.bind_unit(2);
-            roughness_tex_.bind_unit(3);
-            ao_tex_.bind_unit(4);
+            base_color_tex_->bind_unit(0);
+            normal_tex_->bind_unit(1);
+            metallic_tex_->bind_unit(2);
+            roughness_tex_->bind_unit(3);
+            ao_tex_->bind_unit(4);
             env_diffuse_.bind_unit(5);
             env_prefiltered_.bind_unit(6);
             split_sum_.bind_unit(7);
@@ -309,11 +310,11 @@ private :
     shader_uniform texture_model_uniform_{texture_program_.uniform("model")};
     shader_uniform texture_normal_mat_uniform_{texture_program_.uniform("normalMat")};
     shader_uniform texture_view_pos_{texture_program_.uniform("viewPos")};
-    texture2d base_color_tex_{"resources/textures/rustediron/basecolor.png", true};
-    texture2d normal_tex_{"resources/textures/rustediron/normal.png"};
-    texture2d metallic_tex_{"resources/textures/rustediron/metallic.png"};
-    texture2d roughness_tex_{"resources/textures/rustediron/roughness.png"};
-    texture2d ao_tex_{"resources/textures/rustediron/ao.png"};
+    std::shared_ptr<texture2d> base_color_tex_{texture_cache::instance().load("resources/textures/rustediron/basecolor.png", true)};
+    std::shared_ptr<texture2d> normal_tex_{texture_cache::instance().load("resources/textures/rustediron/normal.png")};
+    std::shared_ptr<texture2d> metallic_tex_{texture_cache::instance().load("resources/textures/rustediron/metallic.png")};
+    std::shared_ptr<texture2d> roughness_tex_{texture_cache::instance().load("resources/textures/rustediron/roughness.png")};
+    std::shared_ptr<texture2d> ao_tex_{texture_cache::instance().load("resources/textures/rustediron/ao.png")};
 
     shader_program quad_program_{make_vf_program(
         "shaders/base/quad_vs.glsl",
@@ -334,7 +335,7 @@ private :
         "resources/textures/Alexs_Apartment/Alexs_Apt_2k.hdr",
     };
 
-    texture2d env_tex_{env_entries[0]};
+    texture2d env_tex_{env_entries[0], false, texture2d_elem_type::f16};
     cubemap env_{cubemap::from_single_texture(env_tex_, cubemap_size)};
     skybox env_skybox_{env_};
 
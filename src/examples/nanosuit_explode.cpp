@@ -3,6 +3,7 @@
 #include "examples.hpp"
 
 #include "model.hpp"
+#include "meshlet.hpp"
 #include "skybox.hpp"
 
 using namespace glwrap;
@@ -36,31 +37,40 @@ public:
 
         explode_.set_float(ratio);
         projection_.set_mat4(projection);
-        model_view_.set_mat4(view);
+        // faces are drawn from both sides and move up to explodeDistance along their normal.
+        // Culled on the CPU, which keeps the triangle order the blending relies on.
+        // The gltf scene places its meshes through node transforms, so the padding is scaled into the space of each mesh.
         for (auto &mesh : model_.meshes())
         {
-            auto &varray = mesh.get_varray();
+            auto &world = mesh.transform();
+            model_view_.set_mat4(view * world);
+            auto scale = glm::length(glm::vec3(world[0]));
+            auto cull = meshlets::cull_params{.mode = meshlets::cull_mode::cpu, .backfaces = false, .radius_padding = explode_distance / scale};
             if (mesh.has_texture(texture_type::diffuse))
             {
                 auto &texture = mesh.get_texture(texture_type::diffuse);
                 texture.bind_unit(0);
                 diffuse0_.set_int(0);
             }
-            varray.draw(draw_mode::triangles);
+            auto mesh_eye = glm::vec3(glm::inverse(world) * glm::vec4(cam.position(), 1.0f));
+            culler_.draw(mesh, projection * view * world, mesh_eye, cull);
         }
 
         glDisable(GL_BLEND);
     }
 
 private:
-    glwrap::skybox skybox_{glwrap::cubemap{"resources/cubemaps/skybox", ".jpg"}};
+    static constexpr float explode_distance = 2.0f;
+
+    glwrap::skybox skybox_{glwrap::cubemap{texture_container::load_or_bake_cubemap("resources/cubemaps/skybox", ".jpg", {.srgb = true})}};
     glwrap::model model_{model::load_file("resources/models/crysis_nano_suit_2/scene.gltf", texture_type::diffuse)};
+    meshlets::culler culler_;
 
     shader_program program_{make_vgf_program(
         "shaders/geometry/explode_vs.glsl"_path,
         "shaders/geometry/explode_gs.glsl"_path,
         "shaders/geometry/explode_fs.glsl"_path,
-        "explodeDistance", 2.0f
+        "explodeDistance", explode_distance
     )};
 
     shader_uniform explode_{program_.uniform("explodeRatio")};
@@ -4,6 +4,7 @@
 #include "glwrap.hpp"
 #include "model.hpp"
 #include "common_obj.hpp"
+#include "texture_cache.hpp"
 
 using namespace glwrap;
 using namespace std::literals;
@@ -43,8 +44,8 @@ public:
         program_.use();
         projection_.set_mat4(projection);
         view_mat_.set_mat4(view);
-        diffuse_map_.bind_unit(0);
-        normal_map_.bind_unit(1);
+        diffuse_map_->bind_unit(0);
+        normal_map_->bind_unit(1);
         diffuse_sampler_.set_int(0);
         normal_sampler_.set_int(1);
         view_position_.set_vec3(cam.position());
@@ -81,11 +82,11 @@ private:
     shader_uniform normal_sampler_{program_.uniform("normalTexture")};
     shader_uniform view_position_{program_.uniform("viewPosition")};
 
-    texture2d diffuse_map_{"resources/textures/brickwall.jpg"sv, true};
-    texture2d normal_map_{"resources/textures/brickwall_normal.jpg"sv};
+    std::shared_ptr<texture2d> diffuse_map_{texture_cache::instance().load("resources/textures/brickwall.jpg"sv, true)};
+    std::shared_ptr<texture2d> normal_map_{texture_cache::instance().load("resources/textures/brickwall_normal.jpg"sv)};
 
     vertex_array varray_{auto_vertex_array(
-        index_buffer<GLuint>{0, 1, 2, 2, 3, 0},
+        index_buffer<uint16_t>{0, 1, 2, 2, 3, 0},
         vertex_buffer<vert_t>{
             {glm::vec3(0, -5, +5), glm::vec3(1, 0, 0), glm::vec2(0, 0), glm::vec3(0, 0, -1), glm::vec3(0, 1, 0)},
             {glm::vec3(0, -5, -5), glm::vec3(1, 0, 0), glm::vec2(1, 0), glm::vec3(0, 0, -1), glm::vec3(0, 1, 0)},
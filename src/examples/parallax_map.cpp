@@ -93,7 +93,7 @@ private:
     texture2d depth_map2_{"resources/textures/wooden_toy_disp.png"sv};
 
     vertex_array varray_{auto_vertex_array(
-        index_buffer<GLuint>{0, 1, 2, 2, 3, 0},
+        index_buffer<uint16_t>{0, 1, 2, 2, 3, 0},
         vertex_buffer<vert_t>{
             {glm::vec3(0, -5, +5), glm::vec3(1, 0, 0), glm::vec2(0, 0), glm::vec3(0, 0, -1), glm::vec3(0, 1, 0)},
             {glm::vec3(0, -5, -5), glm::vec3(1, 0, 0), glm::vec2(1, 0), glm::vec3(0, 0, -1), glm::vec3(0, 1, 0)},
@@ -2,6 +2,7 @@
 #include "common_obj.hpp"
 #include "examples.hpp"
 #include "skybox.hpp"
+#include "texture_cache.hpp"
 #include "imgui.h"
 
 using namespace glwrap;
@@ -130,7 +131,7 @@ private:
 
     void draw_scene(glm::mat4x4 const &proj, view_info &view_info, bool shadow_casting)
     {
-        floor_tex_.bind_unit(0);
+        floor_tex_->bind_unit(0);
         auto light_space_mat = light_view_.projection() * light_view_.view();
         if (shadow_casting)
         {
@@ -209,7 +210,7 @@ private:
             {{25.0f, -0.5f, -25.0f}, {0.0f, 1.0f, 0.0f}, {25.0f, 25.0f}},
             {{-25.0f, -0.5f, -25.0f}, {0.0f, 1.0f, 0.0f}, {0.0f, 25.0f}},
         })};
-    texture2d floor_tex_{"resources/textures/wood.png"_path, true, texture2d_elem_type::u8, texture2d_format::unspecified};
+    std::shared_ptr<texture2d> floor_tex_{texture_cache::instance().load("resources/textures/wood.png"_path, true, texture2d_elem_type::u8, texture2d_format::unspecified)};
     shader_program floor_program_{make_vf_program(
         "shaders/common/simple_position_normal_texcoord_vs.glsl"_path,
         "shaders/shadow_blinn_phong_fs.glsl"_path,
@@ -5,6 +5,7 @@
 #include "examples.hpp"
 #include "skybox.hpp"
 #include "utils.hpp"
+#include "texture_cache.hpp"
 #include "imgui.h"
 
 using namespace glwrap;
@@ -12,6 +13,18 @@ using namespace glwrap;
 class ssao final : public example
 {
 public:
+    ssao()
+    {
+        auto &varray = backpack_.meshes().front().get_varray();
+        auto binding_index = static_cast<GLuint>(varray.attach_vbuffer_range(backpack_instances_.handle(), backpack_instances_.offset(), sizeof(instance_t)));
+        for (GLuint column = 0; column < 8; ++column)
+        {
+            varray.enable_attrib(4 + column);
+            varray.attrib_format(4 + column, binding_index, 4, GL_FLOAT, GL_FALSE, column * static_cast<GLuint>(sizeof(glm::vec4)));
+        }
+        varray.binding_divisor(binding_index, 1);
+    }
+
     std::optional<camera> get_camera() override
     {
         return camera::look_at_camera({6.45f, 4.30f, 9.34f});
@@ -79,21 +92,17 @@ public:
         g_projection_.set(projection);
         g_view_.set(cam.view());
 
-        auto model = glm::scale(glm::rotate(glm::translate(glm::mat4(1.0f), {0.0f, 0.8f, 0.0}), glm::radians(-90.0f), {1.0f, 0, 0}), glm::vec3(1.0f));
-
-        g_model_.set(model);
-        g_normal_mat_.set(glm::transpose(glm::inverse(model)));
-        for (auto &mesh : backpack_.meshes())
+        auto &meshes = backpack_.meshes();
+        for (size_t i = 0; i < meshes.size(); ++i)
         {
-            mesh.get_texture(texture_type::diffuse).bind_unit(0);
-            mesh.get_texture(texture_type::specular).bind_unit(1);
-            mesh.get_texture(texture_type::normal).bind_unit(2);
-            auto &varray = mesh.get_varray();
-            varray.draw();
+            meshes[i].get_texture(texture_type::diffuse).bind_unit(0);
+            meshes[i].get_texture(texture_type::specular).bind_unit(1);
+            meshes[i].get_texture(texture_type::normal).bind_unit(2);
+            meshes[i].get_varray().draw_indirect(draw_mode::triangles, backpack_commands_, i);
         }
 
         g_plane_program_.use();
-        plane_tex_.bind_unit(0);
+        plane_tex_->bind_unit(0);
         plane_projection_.set(projection);
         plane_view_.set(cam.view());
 
@@ -226,7 +235,37 @@ private:
     std::optional<frame_buffer> ssao_blur_buffer_{};
     std::optional<frame_buffer> f_buffer_{};
 
-    model backpack_{model::load_file("resources/models/backpack_modified/backpack.obj", texture_type::diffuse | texture_type::specular | texture_type::normal)};
+    model backpack_{model::load_file("resources/models/backpack_modified/backpack.obj", texture_type::diffuse | texture_type::specular | texture_type::normal,
+                                     default_load_flags | load_flags::shared_arena)};
+
+    struct instance_t
+    {
+        glm::mat4 model;
+        glm::mat4 normal_mat;
+    };
+
+    // the g-buffer vertex shader reads its matrices per instance, mesh i uses instance i
+    vertex_buffer<instance_t> backpack_instances_ = [this]
+    {
+        auto model = glm::scale(glm::rotate(glm::translate(glm::mat4(1.0f), {0.0f, 0.8f, 0.0}), glm::radians(-90.0f), {1.0f, 0, 0}), glm::vec3(1.0f));
+        std::vector<instance_t> instances;
+        for (auto &mesh : backpack_.meshes())
+        {
+            auto mesh_model = model * mesh.transform();
+            instances.push_back({mesh_model, glm::transpose(glm::inverse(mesh_model))});
+        }
+        return vertex_buffer<instance_t>(instances);
+    }();
+
+    indirect_buffer<draw_elements_indirect_command> backpack_commands_ = [this]
+    {
+        std::vector<draw_elements_indirect_command> commands;
+        for (auto &mesh : backpack_.meshes())
+        {
+            commands.push_back(mesh.draw_command(1, static_cast<GLuint>(commands.size())));
+        }
+        return indirect_buffer<draw_elements_indirect_command>(std::span<draw_elements_indirect_command const>(commands));
+    }();
 
     shader_program g_buffer_program_{make_vf_program(
         "shaders/deferred/g_buffer_no_position_vs.glsl"_path,
@@ -235,9 +274,7 @@ private:
         "specularTexture", 1,
         "normalTexture", 2)};
     shader_uniform g_projection_{g_buffer_program_.uniform("projection")};
-    shader_uniform g_model_{g_buffer_program_.uniform("model")};
     shader_uniform g_view_{g_buffer_program_.uniform("view")};
-    shader_uniform g_normal_mat_{g_buffer_program_.uniform("normalMat")};
 
     shader_program g_plane_program_{make_vf_program(
         "shaders/ssao/g_plane_vs.glsl"_path,
@@ -247,7 +284,7 @@ private:
     shader_uniform plane_model_{g_plane_program_.uniform("model")};
     shader_uniform plane_normal_mat_{g_plane_program_.uniform("normalMat")};
 
-    texture2d plane_tex_{"resources/textures/wood.png", true};
+    std::shared_ptr<texture2d> plane_tex_{texture_cache::instance().load("resources/textures/wood.png", true)};
 
     shader_program lighting_program_{make_vf_program(
         "shaders/base/fbuffer_vs.glsl"_path,
@@ -1,7 +1,10 @@
+#include <algorithm>
+#include <cstring>
 #include <fstream>
 #include <vector>
 #include <nlohmann/json.hpp>
 #include "glwrap.hpp"
+#include "parallel.hpp"
 #include "utils.hpp"
 
 using namespace glwrap;
@@ -19,6 +22,8 @@ inline GLenum get_bitmap_texture_type(bitmap const &bmp)
         return GL_UNSIGNED_SHORT;
     case bitmap_internal_format::f32:
         return GL_FLOAT;
+    case bitmap_internal_format::f16:
+        return GL_HALF_FLOAT;
     default:
         throw std::runtime_error(std::format("Unknown bitmap internal format: {}", bmp.internal_format()));
     }
@@ -61,6 +66,15 @@ GLenum to_internal_format(texture2d_format format, texture2d_elem_type elem_type
         {{texture2d_format::grey, texture2d_elem_type::u8}, GL_R8},
         {{texture2d_format::grey, texture2d_elem_type::f16}, GL_R16F},
         {{texture2d_format::grey, texture2d_elem_type::f32}, GL_R32F},
+
+        {{texture2d_format::bc1, texture2d_elem_type::u8}, GL_COMPRESSED_RGB_S3TC_DXT1_EXT},
+        {{texture2d_format::bc1_srgb, texture2d_elem_type::u8}, GL_COMPRESSED_SRGB_S3TC_DXT1_EXT},
+        {{texture2d_format::bc3, texture2d_elem_type::u8}, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT},
+        {{texture2d_format::bc3_srgb, texture2d_elem_type::u8}, GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT},
+        {{texture2d_format::bc4, texture2d_elem_type::u8}, GL_COMPRESSED_RED_RGTC1},
+        {{texture2d_format::bc5, texture2d_elem_type::u8}, GL_COMPRESSED_RG_RGTC2},
+        {{texture2d_format::bc7, texture2d_elem_type::u8}, GL_COMPRESSED_RGBA_BPTC_UNORM},
+        {{texture2d_format::bc7_srgb, texture2d_elem_type::u8}, GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM},
     };
 
     auto iter = map_.find({format, elem_type});
@@ -115,6 +129,391 @@ void create_texture_resources(GLuint &handle, bool srgb, texture2d_format format
     height = bmp.height();
 }
 
+// internal format and pixel format of a bitmap or baked container, 1/2 channel images have no sRGB format and stay linear
+std::pair<GLenum, GLenum> get_bitmap_formats(bitmap_channel channels, bitmap_internal_format internal_format, bool srgb)
+{
+    static std::map<std::tuple<bitmap_channel, bitmap_internal_format, bool>, GLenum> map_{
+        {{bitmap_channel::grey, bitmap_internal_format::u8, false}, GL_R8},
+        {{bitmap_channel::grey, bitmap_internal_format::u16, false}, GL_R16},
+        {{bitmap_channel::grey, bitmap_internal_format::f16, false}, GL_R16F},
+        {{bitmap_channel::grey, bitmap_internal_format::f32, false}, GL_R32F},
+        {{bitmap_channel::grey_alpha, bitmap_internal_format::u8, false}, GL_RG8},
+        {{bitmap_channel::grey_alpha, bitmap_internal_format::u16, false}, GL_RG16},
+        {{bitmap_channel::grey_alpha, bitmap_internal_format::f16, false}, GL_RG16F},
+        {{bitmap_channel::grey_alpha, bitmap_internal_format::f32, false}, GL_RG32F},
+        {{bitmap_channel::rgb, bitmap_internal_format::u8, false}, GL_RGB8},
+        {{bitmap_channel::rgb, bitmap_internal_format::u8, true}, GL_SRGB8},
+        {{bitmap_channel::rgb, bitmap_internal_format::u16, false}, GL_RGB16},
+        {{bitmap_channel::rgb, bitmap_internal_format::f16, false}, GL_RGB16F},
+        {{bitmap_channel::rgb, bitmap_internal_format::f32, false}, GL_RGB32F},
+        {{bitmap_channel::rgba, bitmap_internal_format::u8, false}, GL_RGBA8},
+        {{bitmap_channel::rgba, bitmap_internal_format::u8, true}, GL_SRGB8_ALPHA8},
+        {{bitmap_channel::rgba, bitmap_internal_format::u16, false}, GL_RGBA16},
+        {{bitmap_channel::rgba, bitmap_internal_format::f16, false}, GL_RGBA16F},
+        {{bitmap_channel::rgba, bitmap_internal_format::f32, false}, GL_RGBA32F},
+    };
+
+    srgb = srgb && internal_format == bitmap_internal_format::u8 && (channels == bitmap_channel::rgb || channels == bitmap_channel::rgba);
+    auto iter = map_.find({channels, internal_format, srgb});
+    if (iter == map_.end())
+    {
+        throw std::invalid_argument(std::format("Cannot create internal format for {}, {}", channels, internal_format));
+    }
+
+    GLenum image_format = channels == bitmap_channel::grey         ? GL_RED
+                          : channels == bitmap_channel::grey_alpha ? GL_RG
+                          : channels == bitmap_channel::rgb        ? GL_RGB
+                                                                   : GL_RGBA;
+    return {iter->second, image_format};
+}
+
+// Rows of small mip levels are not 4-byte aligned, so the unpack alignment is dropped to 1 while uploading them.
+class unpack_alignment_scope final
+{
+public:
+    unpack_alignment_scope()
+    {
+        glGetIntegerv(GL_UNPACK_ALIGNMENT, &prev_alignment_);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    }
+    ~unpack_alignment_scope() { glPixelStorei(GL_UNPACK_ALIGNMENT, prev_alignment_); }
+    unpack_alignment_scope(unpack_alignment_scope const &) = delete;
+    unpack_alignment_scope &operator=(unpack_alignment_scope const &) = delete;
+
+private:
+    GLint prev_alignment_{4};
+};
+
+// --------------------- upload ring -------------------------------
+
+// Ring offsets are kept aligned for every texel size and for the buffer map alignment.
+constexpr size_t upload_ring_alignment = 256;
+
+class unpack_buffer_scope final
+{
+public:
+    explicit unpack_buffer_scope(GLuint buffer) { glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer); }
+    ~unpack_buffer_scope() { glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0); }
+    unpack_buffer_scope(unpack_buffer_scope const &) = delete;
+    unpack_buffer_scope &operator=(unpack_buffer_scope const &) = delete;
+};
+
+upload_ring::upload_ring(size_t capacity) : capacity_{capacity}
+{
+    constexpr GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glCreateBuffers(1, &handle_);
+    glNamedBufferStorage(handle_, static_cast<GLsizeiptr>(capacity_), nullptr, flags);
+    mapped_ = static_cast<std::byte *>(glMapNamedBufferRange(handle_, 0, static_cast<GLsizeiptr>(capacity_), flags));
+    if (mapped_ == nullptr)
+    {
+        auto err = glGetError();
+        glDeleteBuffers(1, &handle_);
+        handle_ = 0;
+        throw gl_error(std::format("Create upload ring of {} bytes failed: 0x{:04x}", capacity_, err));
+    }
+}
+
+upload_ring::~upload_ring()
+{
+    for (auto &r : in_flight_)
+    {
+        glDeleteSync(r.fence);
+    }
+    if (handle_ != 0)
+    {
+        // the driver keeps the storage alive until queued copies from it are done
+        glUnmapNamedBuffer(handle_);
+        glDeleteBuffers(1, &handle_);
+    }
+}
+
+upload_ring::ticket upload_ring::upload(GLuint texture, GLint level, GLint layer, GLsizei width, GLsizei height, GLenum format, GLenum type, std::span<std::byte const> pixels)
+{
+    return upload_rows(texture, level, layer, width, height, format, type, pixels, static_cast<size_t>(height), 1);
+}
+
+upload_ring::ticket upload_ring::upload_compressed(GLuint texture, GLint level, GLint layer, GLsizei width, GLsizei height, GLenum internal_format, std::span<std::byte const> blocks)
+{
+    return upload_rows(texture, level, layer, width, height, internal_format, 0, blocks, static_cast<size_t>(height + 3) / 4, 4);
+}
+
+// type 0 means format is a compressed internal format and a row is a row of 4x4 blocks
+upload_ring::ticket upload_ring::upload_rows(GLuint texture, GLint level, GLint layer, GLsizei width, GLsizei height, GLenum format, GLenum type,
+                                             std::span<std::byte const> data, size_t rows, GLsizei row_height)
+{
+    if (rows == 0 || data.size() % rows != 0)
+    {
+        throw std::invalid_argument(std::format("Upload of {} bytes does not split into {} rows", data.size(), rows));
+    }
+    auto row_bytes = data.size() / rows;
+    // a band takes at most half the ring, so the next one can be filled while the GPU copies the previous one
+    auto band_rows = std::min(rows, capacity_ / 2 / row_bytes);
+    if (band_rows == 0)
+    {
+        throw std::invalid_argument(std::format("Upload ring of {} bytes cannot hold a row of {} bytes", capacity_, row_bytes));
+    }
+
+    // drop the fences that already signaled
+    is_complete(submitted_);
+
+    unpack_alignment_scope alignment;
+    unpack_buffer_scope binding{handle_};
+    for (size_t row = 0; row < rows; row += band_rows)
+    {
+        auto count = std::min(band_rows, rows - row);
+        auto size = count * row_bytes;
+        auto offset = allocate(size);
+        std::memcpy(mapped_ + offset, data.data() + row * row_bytes, size);
+
+        auto y = static_cast<GLint>(row) * row_height;
+        auto band_height = std::min(static_cast<GLsizei>(count) * row_height, height - y);
+        auto buffer_offset = reinterpret_cast<void const *>(offset);
+        if (type == 0 && layer < 0)
+        {
+            glCompressedTextureSubImage2D(texture, level, 0, y, width, band_height, format, static_cast<GLsizei>(size), buffer_offset);
+        }
+        else if (type == 0)
+        {
+            glCompressedTextureSubImage3D(texture, level, 0, y, layer, width, band_height, 1, format, static_cast<GLsizei>(size), buffer_offset);
+        }
+        else if (layer < 0)
+        {
+            glTextureSubImage2D(texture, level, 0, y, width, band_height, format, type, buffer_offset);
+        }
+        else
+        {
+            glTextureSubImage3D(texture, level, 0, y, layer, width, band_height, 1, format, type, buffer_offset);
+        }
+        in_flight_.push_back({offset, offset + size, glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), ++submitted_});
+    }
+    return submitted_;
+}
+
+size_t upload_ring::allocate(size_t size)
+{
+    auto begin = (head_ + upload_ring_alignment - 1) / upload_ring_alignment * upload_ring_alignment;
+    if (begin + size > capacity_)
+    {
+        begin = 0;
+    }
+    auto end = begin + size;
+    // fences signal in submission order, so retire the oldest regions until none overlaps
+    while (std::ranges::any_of(in_flight_, [&](region const &r) { return r.begin < end && begin < r.end; }))
+    {
+        while (!retire_oldest(1'000'000'000))
+        {
+        }
+    }
+    head_ = end;
+    return begin;
+}
+
+bool upload_ring::retire_oldest(GLuint64 timeout_ns)
+{
+    auto &oldest = in_flight_.front();
+    auto status = glClientWaitSync(oldest.fence, timeout_ns > 0 ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, timeout_ns);
+    if (status == GL_WAIT_FAILED)
+    {
+        throw gl_error(std::format("Wait for upload {} failed: 0x{:04x}", oldest.id, glGetError()));
+    }
+    if (status == GL_TIMEOUT_EXPIRED)
+    {
+        return false;
+    }
+    glDeleteSync(oldest.fence);
+    completed_ = oldest.id;
+    in_flight_.pop_front();
+    return true;
+}
+
+bool upload_ring::is_complete(ticket t)
+{
+    while (completed_ < t && !in_flight_.empty() && retire_oldest(0))
+    {
+    }
+    return completed_ >= t;
+}
+
+void upload_ring::wait(ticket t)
+{
+    while (completed_ < t && !in_flight_.empty())
+    {
+        retire_oldest(1'000'000'000);
+    }
+}
+
+// --------------------- dynamic ring -------------------------------
+
+details::dynamic_ring::dynamic_ring(size_t frame_bytes, size_t frames, size_t alignment)
+    : fences_(frames, nullptr)
+{
+    if (frames == 0 || frame_bytes == 0)
+    {
+        throw std::invalid_argument(std::format("Dynamic ring of {} frames of {} bytes", frames, frame_bytes));
+    }
+    GLint uniform_alignment = 0;
+    GLint storage_alignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniform_alignment);
+    glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &storage_alignment);
+    // all of them are powers of two
+    alignment_ = std::max({alignment, size_t{16}, static_cast<size_t>(uniform_alignment), static_cast<size_t>(storage_alignment)});
+    frame_bytes_ = (frame_bytes + alignment_ - 1) & ~(alignment_ - 1);
+
+    constexpr GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    auto total = static_cast<GLsizeiptr>(frame_bytes_ * frames);
+    glCreateBuffers(1, &handle_);
+    glNamedBufferStorage(handle_, total, nullptr, flags);
+    mapped_ = static_cast<std::byte *>(glMapNamedBufferRange(handle_, 0, total, flags));
+    if (mapped_ == nullptr)
+    {
+        auto err = glGetError();
+        glDeleteBuffers(1, &handle_);
+        handle_ = 0;
+        throw gl_error(std::format("Create dynamic ring of {} x {} bytes failed: 0x{:04x}", frames, frame_bytes_, err));
+    }
+}
+
+details::dynamic_ring::~dynamic_ring()
+{
+    for (auto fence : fences_)
+    {
+        if (fence != nullptr)
+        {
+            glDeleteSync(fence);
+        }
+    }
+    if (handle_ != 0)
+    {
+        glUnmapNamedBuffer(handle_);
+        glDeleteBuffers(1, &handle_);
+    }
+}
+
+size_t details::dynamic_ring::allocate(size_t bytes)
+{
+    if (!acquired_)
+    {
+        // the region was last written frames() frames ago, wait until the GPU has read it
+        if (auto &fence = fences_[frame_]; fence != nullptr)
+        {
+            GLenum status;
+            while ((status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1'000'000'000)) == GL_TIMEOUT_EXPIRED)
+            {
+            }
+            if (status == GL_WAIT_FAILED)
+            {
+                throw gl_error(std::format("Wait for dynamic ring frame {} failed: 0x{:04x}", frame_, glGetError()));
+            }
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+        acquired_ = true;
+        head_ = 0;
+    }
+
+    auto begin = (head_ + alignment_ - 1) & ~(alignment_ - 1);
+    if (begin + bytes > frame_bytes_)
+    {
+        throw std::length_error(std::format("Dynamic ring frame of {} bytes cannot fit {} more bytes at {}", frame_bytes_, bytes, begin));
+    }
+    head_ = begin + bytes;
+    return frame_ * frame_bytes_ + begin;
+}
+
+void details::dynamic_ring::end_frame()
+{
+    if (acquired_)
+    {
+        fences_[frame_] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        acquired_ = false;
+    }
+    frame_ = (frame_ + 1) % fences_.size();
+}
+
+texture2d_format to_texture2d_format(bcn::block_format block_format, bool srgb)
+{
+    switch (block_format)
+    {
+    case bcn::block_format::bc1:
+        return srgb ? texture2d_format::bc1_srgb : texture2d_format::bc1;
+    case bcn::block_format::bc3:
+        return srgb ? texture2d_format::bc3_srgb : texture2d_format::bc3;
+    case bcn::block_format::bc4:
+        return texture2d_format::bc4;
+    case bcn::block_format::bc5:
+        return texture2d_format::bc5;
+    case bcn::block_format::bc7:
+        return srgb ? texture2d_format::bc7_srgb : texture2d_format::bc7;
+    default:
+        throw std::invalid_argument(std::format("No texture2d_format for block format {}", block_format));
+    }
+}
+
+// internal format and pixel format (0 for block compressed data) of a baked container
+std::pair<GLenum, GLenum> get_container_formats(texture_container const &container)
+{
+    if (container.compressed())
+    {
+        return {to_internal_format(to_texture2d_format(container.block_format(), container.srgb()), texture2d_elem_type::u8), 0};
+    }
+    return get_bitmap_formats(container.channels(), container.internal_format(), container.srgb());
+}
+
+std::span<std::byte const> bitmap_bytes(bitmap const &bmp)
+{
+    return {static_cast<std::byte const *>(bmp.pixels()), bmp.size_in_bytes()};
+}
+
+// Uploads bmp into a level (and layer, when >= 0) of handle, directly or through ring when given.
+void upload_bitmap(GLuint handle, GLint level, GLint layer, bitmap const &bmp, GLenum image_format, upload_ring *ring)
+{
+    if (ring != nullptr)
+    {
+        ring->upload(handle, level, layer, bmp.width(), bmp.height(), image_format, get_bitmap_texture_type(bmp), bitmap_bytes(bmp));
+        return;
+    }
+    unpack_alignment_scope alignment;
+    if (layer < 0)
+    {
+        glTextureSubImage2D(handle, level, 0, 0, bmp.width(), bmp.height(), image_format, get_bitmap_texture_type(bmp), bmp.pixels());
+    }
+    else
+    {
+        glTextureSubImage3D(handle, level, 0, 0, layer, bmp.width(), bmp.height(), 1, image_format, get_bitmap_texture_type(bmp), bmp.pixels());
+    }
+}
+
+void upload_container_levels(GLuint handle, texture_container const &container, GLenum internal_format, GLenum image_format, upload_ring *ring)
+{
+    for (int face = 0; face < container.faces(); ++face)
+    {
+        auto layer = container.faces() == 1 ? -1 : face;
+        for (int level = 0; level < container.levels(); ++level)
+        {
+            if (container.compressed())
+            {
+                auto [width, height, data] = container.level(level, face);
+                auto size = static_cast<GLsizei>(data.size());
+                if (ring != nullptr)
+                {
+                    ring->upload_compressed(handle, level, layer, width, height, internal_format, data);
+                }
+                else if (layer < 0)
+                {
+                    glCompressedTextureSubImage2D(handle, level, 0, 0, width, height, internal_format, size, data.data());
+                }
+                else
+                {
+                    glCompressedTextureSubImage3D(handle, level, 0, 0, face, width, height, 1, internal_format, size, data.data());
+                }
+                continue;
+            }
+
+            upload_bitmap(handle, level, layer, container.image(level, face), image_format, ring);
+        }
+    }
+}
+
 texture2d::texture2d(GLsizei width, GLsizei height, GLsizei multisamples, GLenum internal_format, GLenum wrap_mode)
     : width_{width}, height_{height}, internal_format_{internal_format}
 {
@@ -191,6 +590,99 @@ texture2d::texture2d(std::filesystem::path const &filename, bool srgb, texture2d
     }
 }
 
+texture2d::texture2d(bitmap &bmp, bool srgb, texture2d_elem_type elem_type, texture2d_format format, GLenum wrap_mode)
+{
+    auto prev_err = glGetError();
+    if (prev_err != GL_NO_ERROR)
+    {
+        std::cout << std::format("Previous operation failed with err = 0x{:04x}", prev_err) << std::endl;
+    }
+    create_texture_resources(handle_, srgb, format, elem_type, bmp, width_, height_, internal_format_, wrap_mode);
+    auto err = glGetError();
+    if (err != GL_NO_ERROR)
+    {
+        throw gl_error(std::format("Create texture2d failed: 0x{:04x}", err));
+    }
+}
+
+texture2d::texture2d(bitmap const &bmp, std::span<bitmap const> mip_chain, bool srgb, GLenum wrap_mode)
+    : texture2d(bmp, mip_chain, nullptr, srgb, wrap_mode)
+{
+}
+
+texture2d::texture2d(bitmap const &bmp, std::span<bitmap const> mip_chain, upload_ring &ring, bool srgb, GLenum wrap_mode)
+    : texture2d(bmp, mip_chain, &ring, srgb, wrap_mode)
+{
+}
+
+texture2d::texture2d(bitmap const &bmp, std::span<bitmap const> mip_chain, upload_ring *ring, bool srgb, GLenum wrap_mode)
+    : width_{bmp.width()}, height_{bmp.height()}
+{
+    auto prev_err = glGetError();
+    if (prev_err != GL_NO_ERROR)
+    {
+        std::cout << std::format("Previous operation failed with err = 0x{:04x}", prev_err) << std::endl;
+    }
+
+    auto [internal_format, image_format] = get_bitmap_formats(bmp.channels(), bmp.internal_format(), srgb);
+    internal_format_ = internal_format;
+    glCreateTextures(GL_TEXTURE_2D, 1, &handle_);
+    glTextureParameteri(handle_, GL_TEXTURE_MIN_FILTER, mip_chain.empty() ? GL_LINEAR : GL_LINEAR_MIPMAP_LINEAR);
+    glTextureParameteri(handle_, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTextureParameteri(handle_, GL_TEXTURE_WRAP_S, wrap_mode);
+    glTextureParameteri(handle_, GL_TEXTURE_WRAP_T, wrap_mode);
+    glTextureStorage2D(handle_, static_cast<GLsizei>(mip_chain.size()) + 1, internal_format_, width_, height_);
+    upload_bitmap(handle_, 0, -1, bmp, image_format, ring);
+    for (auto level : utils::range(mip_chain.size()))
+    {
+        upload_bitmap(handle_, static_cast<GLint>(level) + 1, -1, mip_chain[level], image_format, ring);
+    }
+    auto err = glGetError();
+    if (err != GL_NO_ERROR)
+    {
+        throw gl_error(std::format("Create texture2d failed: 0x{:04x}", err));
+    }
+}
+
+texture2d::texture2d(texture_container const &container, GLenum wrap_mode)
+    : texture2d(container, nullptr, wrap_mode)
+{
+}
+
+texture2d::texture2d(texture_container const &container, upload_ring &ring, GLenum wrap_mode)
+    : texture2d(container, &ring, wrap_mode)
+{
+}
+
+texture2d::texture2d(texture_container const &container, upload_ring *ring, GLenum wrap_mode)
+    : width_{container.width()}, height_{container.height()}
+{
+    if (container.faces() != 1)
+    {
+        throw std::invalid_argument(std::format("Texture container has {} faces, 1 needed.", container.faces()));
+    }
+    auto prev_err = glGetError();
+    if (prev_err != GL_NO_ERROR)
+    {
+        std::cout << std::format("Previous operation failed with err = 0x{:04x}", prev_err) << std::endl;
+    }
+
+    auto [internal_format, image_format] = get_container_formats(container);
+    internal_format_ = internal_format;
+    glCreateTextures(GL_TEXTURE_2D, 1, &handle_);
+    glTextureParameteri(handle_, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTextureParameteri(handle_, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTextureParameteri(handle_, GL_TEXTURE_WRAP_S, wrap_mode);
+    glTextureParameteri(handle_, GL_TEXTURE_WRAP_T, wrap_mode);
+    glTextureStorage2D(handle_, container.levels(), internal_format_, width_, height_);
+    upload_container_levels(handle_, container, internal_format_, image_format, ring);
+    auto err = glGetError();
+    if (err != GL_NO_ERROR)
+    {
+        throw gl_error(std::format("Create texture2d failed: 0x{:04x}", err));
+    }
+}
+
 texture2d::texture2d(GLsizei width, GLsizei height, GLenum internal_format, GLenum format, GLenum type, GLenum wrap_mode, const void *data)
 {
     auto prev_err = glGetError();
@@ -231,6 +723,12 @@ void texture2d::set_border_color(glm::vec4 const &color)
     glTextureParameterfv(handle_, GL_TEXTURE_BORDER_COLOR, glm::value_ptr(color));
 }
 
+upload_ring::ticket texture2d::upload(upload_ring &ring, bitmap const &bmp, GLint level)
+{
+    auto image_format = get_bitmap_formats(bmp.channels(), bmp.internal_format(), false).second;
+    return ring.upload(handle_, level, -1, bmp.width(), bmp.height(), image_format, get_bitmap_texture_type(bmp), bitmap_bytes(bmp));
+}
+
 // -------------------- texture2d array -------------------------------
 
 texture2d_array::texture2d_array(GLsizei width, GLsizei height, GLsizei depth, GLsizei multisamples, GLenum internal_format, GLenum wrap_mode)
@@ -277,6 +775,12 @@ void texture2d_array::set_border_color(glm::vec4 const &color)
     glTextureParameterfv(handle_, GL_TEXTURE_BORDER_COLOR, glm::value_ptr(color));
 }
 
+upload_ring::ticket texture2d_array::upload(upload_ring &ring, bitmap const &bmp, GLint layer, GLint level)
+{
+    auto image_format = get_bitmap_formats(bmp.channels(), bmp.internal_format(), false).second;
+    return ring.upload(handle_, level, layer, bmp.width(), bmp.height(), image_format, get_bitmap_texture_type(bmp), bitmap_bytes(bmp));
+}
+
 // ----------------------- cubemap ------------------------------------
 
 cubemap::cubemap(std::filesystem::path const &right,
@@ -288,27 +792,39 @@ cubemap::cubemap(std::filesystem::path const &right,
                  GLenum internal_format)
     : internal_format_{internal_format}
 {
-    std::tuple<bitmap, GLenum, GLsizei> faces[] = {
-        {bitmap::from_file(right, bitmap_channel::rgb), GL_TEXTURE_CUBE_MAP_POSITIVE_X, 0},
-        {bitmap::from_file(left, bitmap_channel::rgb), GL_TEXTURE_CUBE_MAP_NEGATIVE_X, 1},
-        {bitmap::from_file(top, bitmap_channel::rgb), GL_TEXTURE_CUBE_MAP_POSITIVE_Y, 2},
-        {bitmap::from_file(bottom, bitmap_channel::rgb), GL_TEXTURE_CUBE_MAP_NEGATIVE_Y, 3},
-        {bitmap::from_file(back, bitmap_channel::rgb), GL_TEXTURE_CUBE_MAP_POSITIVE_Z, 4},
-        {bitmap::from_file(front, bitmap_channel::rgb), GL_TEXTURE_CUBE_MAP_NEGATIVE_Z, 5},
-    };
-    auto &first_bmp = std::get<bitmap>(faces[0]);
-    GLsizei width = first_bmp.width(), height = first_bmp.height(), levels = first_bmp.max_mipmap_level();
-    for (auto &[bmp, _1, _2] : faces)
+    // order of the GL_TEXTURE_CUBE_MAP_POSITIVE_X.. faces
+    std::array<std::filesystem::path const *, 6> paths{&right, &left, &top, &bottom, &back, &front};
+    GLsizei width = 0, height = 0;
+    try
     {
-        if (bmp.width() != width || bmp.height() != height)
-            throw gl_error("Cubemap texture size must be same");
+        // faces decode on worker threads, storage is allocated when the first one is ready and each face is uploaded on arrival
+        utils::parallel_produce(
+            paths.size(),
+            [&paths](size_t i)
+            { return bitmap::from_file(*paths[i], bitmap_channel::rgb); },
+            [&](size_t face, bitmap bmp)
+            {
+                if (handle_ == 0)
+                {
+                    width = bmp.width();
+                    height = bmp.height();
+                    glCreateTextures(GL_TEXTURE_CUBE_MAP, 1, &handle_);
+                    glTextureStorage2D(handle_, std::max(bmp.max_mipmap_level(), 1), internal_format, width, height);
+                }
+                else if (bmp.width() != width || bmp.height() != height)
+                {
+                    throw gl_error("Cubemap texture size must be same");
+                }
+                glTextureSubImage3D(handle_, 0, 0, 0, static_cast<GLint>(face), width, height, 1, GL_RGB, get_bitmap_texture_type(bmp), bmp.pixels());
+            });
     }
-
-    glCreateTextures(GL_TEXTURE_CUBE_MAP, 1, &handle_);
-    glTextureStorage2D(handle_, levels > 0 ? levels : 1, internal_format, width, height);
-    for (auto &[bmp, _, i] : faces)
+    catch (...)
     {
-        glTextureSubImage3D(handle_, 0, 0, 0, i, width, height, 1, GL_RGB, get_bitmap_texture_type(bmp), bmp.pixels());
+        if (handle_ != 0)
+        {
+            glDeleteTextures(1, &handle_);
+        }
+        throw;
     }
     glGenerateTextureMipmap(handle_);
     glTextureParameteri(handle_, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -345,8 +861,48 @@ cubemap::cubemap(GLsizei size, GLenum internal_format, int mipmap_levels)
     }
 }
 
+cubemap::cubemap(texture_container const &container)
+    : cubemap(container, nullptr)
+{
+}
+
+cubemap::cubemap(texture_container const &container, upload_ring &ring)
+    : cubemap(container, &ring)
+{
+}
+
+cubemap::cubemap(texture_container const &container, upload_ring *ring)
+{
+    if (container.faces() != 6 || container.width() != container.height())
+    {
+        throw gl_error(std::format("Texture container is not a cubemap: {} faces of {}x{}", container.faces(), container.width(), container.height()));
+    }
+
+    auto [internal_format, image_format] = get_container_formats(container);
+    internal_format_ = internal_format;
+    glCreateTextures(GL_TEXTURE_CUBE_MAP, 1, &handle_);
+    glTextureStorage2D(handle_, container.levels(), internal_format_, container.width(), container.height());
+    upload_container_levels(handle_, container, internal_format_, image_format, ring);
+    glTextureParameteri(handle_, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTextureParameteri(handle_, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTextureParameteri(handle_, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(handle_, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(handle_, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    auto err = glGetError();
+    if (err != GL_NO_ERROR)
+    {
+        throw gl_error(std::format("Create cube map failed, gl error = 0x{:04x}", err));
+    }
+}
+
 cubemap::cubemap() = default;
 
+upload_ring::ticket cubemap::upload(upload_ring &ring, bitmap const &bmp, GLint face, GLint level)
+{
+    auto image_format = get_bitmap_formats(bmp.channels(), bmp.internal_format(), false).second;
+    return ring.upload(handle_, level, face, bmp.width(), bmp.height(), image_format, get_bitmap_texture_type(bmp), bitmap_bytes(bmp));
+}
+
 cubemap cubemap::from_single_texture(texture2d &texture, GLsizei size, GLenum internal_format)
 {
     static auto prog = make_compute_program("shaders/compute/cubemap_mapping.glsl");
@@ -370,6 +926,26 @@ cubemap cubemap::from_single_texture(texture2d &texture, GLsizei size, GLenum in
 
 // -------------------- vertex array --------------------------
 
+any_index_buffer any_index_buffer::narrowest(std::span<uint32_t const> indices, size_t vertex_count)
+{
+    if (vertex_count <= std::numeric_limits<uint16_t>::max())
+    {
+        std::vector<uint16_t> narrowed(indices.begin(), indices.end());
+        return index_buffer<uint16_t>(narrowed);
+    }
+    return index_buffer<uint32_t>(indices.data(), indices.size());
+}
+
+any_index_buffer any_index_buffer::narrowest(std::span<uint32_t const> indices, size_t vertex_count, buffer_allocator &allocator)
+{
+    if (vertex_count <= std::numeric_limits<uint16_t>::max())
+    {
+        std::vector<uint16_t> narrowed(indices.begin(), indices.end());
+        return index_buffer<uint16_t>(narrowed, allocator);
+    }
+    return index_buffer<uint32_t>(indices.data(), indices.size(), allocator);
+}
+
 static std::vector<glm::vec2> json_to_vec2(json const &j)
 {
     auto size = j.size();
@@ -398,8 +974,9 @@ static std::vector<glm::vec3> json_to_vec3(json const &j)
 
 vertex_array vertex_array::load_simple_json(std::filesystem::path const &path)
 {
-    std::ifstream f(path);
-    auto j = json::parse(f,
+    auto file = mapped_file{path};
+    auto text = file.text();
+    auto j = json::parse(text.begin(), text.end(),
                          /*parser_callback*/ nullptr,
                          /* allow_exceptions */ true,
                          /* ignore_comments */ true);
@@ -411,7 +988,9 @@ vertex_array vertex_array::load_simple_json(std::filesystem::path const &path)
 
     if (j.contains("position"))
     {
-        result.attach_vbuffer(vertex_buffer<glm::vec3>(json_to_vec3(j["position"])));
+        auto positions = json_to_vec3(j["position"]);
+        result.set_bounds(bounds::compute(positions));
+        result.attach_vbuffer(vertex_buffer<glm::vec3>(positions));
         result.enable_attrib(attrib_index);
         result.attrib_format(attrib_index++, buffer_index++, 3, GL_FLOAT, GL_FALSE, 0);
     }
@@ -442,7 +1021,8 @@ vertex_array vertex_array::load_simple_json(std::filesystem::path const &path)
     if (j.contains("index"))
     {
         auto ids = j["index"].get<std::vector<GLuint>>();
-        result.set_ibuffer(index_buffer<GLuint>(ids));
+        auto vertex_count = ids.empty() ? size_t{0} : size_t{*std::ranges::max_element(ids)} + 1;
+        result.set_ibuffer(any_index_buffer::narrowest(ids, vertex_count));
     }
     return result;
 }
@@ -0,0 +1,149 @@
+#include <cstring>
+
+#include "cpu_features.hpp"
+#include "half.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define HALF_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#define HALF_TARGET_F16C
+#else
+#define HALF_TARGET_F16C __attribute__((target("avx,f16c")))
+#endif
+#else
+#define HALF_X86 0
+#endif
+
+namespace
+{
+#if HALF_X86
+    HALF_TARGET_F16C void floats_to_halves_f16c(float const *src, uint16_t *dst, size_t count) noexcept
+    {
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            auto h = _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), h);
+        }
+        for (; i < count; ++i)
+        {
+            dst[i] = utils::float_to_half(src[i]);
+        }
+    }
+
+    HALF_TARGET_F16C void halves_to_floats_f16c(uint16_t const *src, float *dst, size_t count) noexcept
+    {
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            auto h = _mm_loadu_si128(reinterpret_cast<__m128i const *>(src + i));
+            _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(h));
+        }
+        for (; i < count; ++i)
+        {
+            dst[i] = utils::half_to_float(src[i]);
+        }
+    }
+#endif
+}
+
+namespace utils
+{
+    uint16_t float_to_half(float value) noexcept
+    {
+        constexpr uint32_t f32_infinity = 255u << 23;
+        constexpr uint32_t f16_overflow = (127u + 16u) << 23;
+        constexpr uint32_t denorm_magic_bits = ((127u - 15u) + (23u - 10u) + 1u) << 23;
+
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        auto sign = bits & 0x80000000u;
+        bits ^= sign;
+
+        uint16_t result;
+        if (bits >= f16_overflow)
+        {
+            // inf stays inf, NaN becomes a quiet NaN
+            result = bits > f32_infinity ? 0x7e00 : 0x7c00;
+        }
+        else if (bits < (113u << 23))
+        {
+            // subnormal or zero: let the FPU round the mantissa by adding a magic number
+            float f, magic;
+            std::memcpy(&f, &bits, sizeof(f));
+            std::memcpy(&magic, &denorm_magic_bits, sizeof(magic));
+            f += magic;
+            std::memcpy(&bits, &f, sizeof(bits));
+            result = static_cast<uint16_t>(bits - denorm_magic_bits);
+        }
+        else
+        {
+            auto mantissa_odd = (bits >> 13) & 1u;
+            bits += (static_cast<uint32_t>(15 - 127) << 23) + 0xfffu;
+            bits += mantissa_odd;
+            result = static_cast<uint16_t>(bits >> 13);
+        }
+        return static_cast<uint16_t>(result | (sign >> 16));
+    }
+
+    float half_to_float(uint16_t value) noexcept
+    {
+        constexpr uint32_t shifted_exponent = 0x7c00u << 13;
+        constexpr uint32_t magic_bits = 113u << 23;
+
+        uint32_t bits = (value & 0x7fffu) << 13;
+        auto exponent = bits & shifted_exponent;
+        bits += (127u - 15u) << 23;
+        if (exponent == shifted_exponent)
+        {
+            // inf or NaN
+            bits += (128u - 16u) << 23;
+        }
+        else if (exponent == 0)
+        {
+            // zero or subnormal, renormalize
+            bits += 1u << 23;
+            float f, magic;
+            std::memcpy(&f, &bits, sizeof(f));
+            std::memcpy(&magic, &magic_bits, sizeof(magic));
+            f -= magic;
+            std::memcpy(&bits, &f, sizeof(bits));
+        }
+        bits |= static_cast<uint32_t>(value & 0x8000u) << 16;
+
+        float result;
+        std::memcpy(&result, &bits, sizeof(result));
+        return result;
+    }
+
+    void floats_to_halves(float const *src, uint16_t *dst, size_t count) noexcept
+    {
+#if HALF_X86
+        if (detect_cpu_features().f16c)
+        {
+            floats_to_halves_f16c(src, dst, count);
+            return;
+        }
+#endif
+        for (size_t i = 0; i < count; ++i)
+        {
+            dst[i] = float_to_half(src[i]);
+        }
+    }
+
+    void halves_to_floats(uint16_t const *src, float *dst, size_t count) noexcept
+    {
+#if HALF_X86
+        if (detect_cpu_features().f16c)
+        {
+            halves_to_floats_f16c(src, dst, count);
+            return;
+        }
+#endif
+        for (size_t i = 0; i < count; ++i)
+        {
+            dst[i] = half_to_float(src[i]);
+        }
+    }
+}
@@ -15,6 +15,8 @@
 #include "backends/imgui_impl_opengl3.h"
 
 #include "glwrap.hpp"
+#include "buffer_allocator.hpp"
+#include "texture_cache.hpp"
 #include "camera.hpp"
 #include "utils.hpp"
 #include "examples.hpp"
@@ -399,6 +401,8 @@ try
                     }
                 }
                 ImGui::PopStyleVar();
+                ImGui::Text("%s", std::format("Texture cache: {}", texture_cache::instance().stats()).c_str());
+                ImGui::Text("%s", std::format("Buffer memory: {}", buffer_allocator::instance().stats()).c_str());
 
                 ImGui::End();
                 ImGui::Render();
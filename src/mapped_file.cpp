@@ -0,0 +1,158 @@
+#include <format>
+#include <stdexcept>
+
+#include "mapped_file.hpp"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+struct mapped_file::mapped_file_impl final
+{
+    explicit mapped_file_impl(std::filesystem::path const &path)
+        : path_{path}
+    {
+#ifdef _WIN32
+        file_ = ::CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file_ == INVALID_HANDLE_VALUE)
+        {
+            throw std::runtime_error(std::format("Cannot open file: {}", path.string()));
+        }
+        LARGE_INTEGER file_size;
+        if (!::GetFileSizeEx(file_, &file_size))
+        {
+            ::CloseHandle(file_);
+            throw std::runtime_error(std::format("Cannot get file size: {}", path.string()));
+        }
+        size_ = static_cast<size_t>(file_size.QuadPart);
+        if (size_ > 0)
+        {
+            mapping_ = ::CreateFileMappingW(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (mapping_ == nullptr)
+            {
+                ::CloseHandle(file_);
+                throw std::runtime_error(std::format("Cannot map file: {}", path.string()));
+            }
+            data_ = ::MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0);
+            if (data_ == nullptr)
+            {
+                ::CloseHandle(mapping_);
+                ::CloseHandle(file_);
+                throw std::runtime_error(std::format("Cannot map file: {}", path.string()));
+            }
+        }
+#else
+        auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            throw std::runtime_error(std::format("Cannot open file: {}", path.string()));
+        }
+        struct stat st;
+        if (::fstat(fd, &st) != 0)
+        {
+            ::close(fd);
+            throw std::runtime_error(std::format("Cannot get file size: {}", path.string()));
+        }
+        size_ = static_cast<size_t>(st.st_size);
+        if (size_ > 0)
+        {
+            data_ = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data_ == MAP_FAILED)
+            {
+                data_ = nullptr;
+                ::close(fd);
+                throw std::runtime_error(std::format("Cannot map file: {}", path.string()));
+            }
+            ::madvise(data_, size_, MADV_SEQUENTIAL);
+        }
+        // the mapping keeps its own reference to the file
+        ::close(fd);
+#endif
+    }
+
+    ~mapped_file_impl()
+    {
+#ifdef _WIN32
+        if (data_)
+            ::UnmapViewOfFile(data_);
+        if (mapping_)
+            ::CloseHandle(mapping_);
+        if (file_ != INVALID_HANDLE_VALUE)
+            ::CloseHandle(file_);
+#else
+        if (data_)
+            ::munmap(data_, size_);
+#endif
+    }
+
+    mapped_file_impl(mapped_file_impl const &) = delete;
+    mapped_file_impl(mapped_file_impl &&) = delete;
+    mapped_file_impl &operator=(mapped_file_impl const &) = delete;
+    mapped_file_impl &operator=(mapped_file_impl &&) = delete;
+
+    std::filesystem::path path_;
+    void *data_{nullptr};
+    size_t size_{0};
+#ifdef _WIN32
+    HANDLE file_{INVALID_HANDLE_VALUE};
+    HANDLE mapping_{nullptr};
+#endif
+};
+
+mapped_file::mapped_file(std::filesystem::path const &path)
+    : impl_{std::make_unique<mapped_file_impl>(path)}
+{ }
+
+mapped_file::mapped_file(mapped_file &&other) noexcept
+{
+    swap(other);
+}
+
+mapped_file::~mapped_file() = default;
+
+mapped_file &mapped_file::operator=(mapped_file &&other) noexcept
+{
+    swap(other);
+    return *this;
+}
+
+std::byte const *mapped_file::data() const noexcept
+{
+    return static_cast<std::byte const *>(impl_->data_);
+}
+
+size_t mapped_file::size() const noexcept
+{
+    return impl_->size_;
+}
+
+std::span<std::byte const> mapped_file::bytes() const noexcept
+{
+    return {data(), size()};
+}
+
+std::string_view mapped_file::text() const noexcept
+{
+    return {reinterpret_cast<char const *>(impl_->data_), impl_->size_};
+}
+
+std::filesystem::path const &mapped_file::path() const noexcept
+{
+    return impl_->path_;
+}
+
+void mapped_file::swap(mapped_file &other) noexcept
+{
+    std::swap(impl_, other.impl_);
+}
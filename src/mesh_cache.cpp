@@ -0,0 +1,399 @@
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstring>
+#include <string_view>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#include "mesh_cache.hpp"
+
+namespace glwrap::mesh_cache
+{
+    namespace
+    {
+        constexpr std::array<char, 8> magic{'L', 'G', 'L', 'M', 'E', 'S', 'H', '\0'};
+        constexpr size_t block_alignment = 16;
+
+        struct file_header
+        {
+            std::array<char, 8> magic;
+            uint32_t version;
+            uint32_t vertex_size;
+            cache_key key;
+            uint32_t texture_count;
+            uint32_t node_count;
+            uint32_t mesh_count;
+        };
+
+        // Side files named by the model: "mtllib" lines of OBJ files, "uri" strings of glTF files other than data URIs.
+        std::vector<std::string> referenced_files(std::filesystem::path const &model_path, std::string_view text)
+        {
+            std::vector<std::string> files;
+            auto extension = model_path.extension().string();
+            std::ranges::transform(extension, extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+            if (extension == ".obj")
+            {
+                std::istringstream lines{std::string(text)};
+                std::string line;
+                while (std::getline(lines, line))
+                {
+                    std::istringstream words{line};
+                    std::string keyword;
+                    if (words >> keyword && keyword == "mtllib")
+                    {
+                        for (std::string name; words >> name;)
+                        {
+                            files.push_back(std::move(name));
+                        }
+                    }
+                }
+            }
+            else if (extension == ".gltf")
+            {
+                static constexpr std::string_view uri_key = "\"uri\"";
+                for (auto pos = text.find(uri_key); pos != std::string_view::npos; pos = text.find(uri_key, pos))
+                {
+                    pos += uri_key.size();
+                    auto open = text.find_first_not_of(" \t\r\n:", pos);
+                    if (open == std::string_view::npos || text[open] != '"')
+                    {
+                        continue;
+                    }
+                    auto close = text.find('"', open + 1);
+                    if (close == std::string_view::npos)
+                    {
+                        break;
+                    }
+                    auto uri = text.substr(open + 1, close - open - 1);
+                    if (!uri.starts_with("data:"))
+                    {
+                        files.emplace_back(uri);
+                    }
+                    pos = close + 1;
+                }
+            }
+            return files;
+        }
+
+        constexpr size_t align_up(size_t n) noexcept
+        {
+            return (n + block_alignment - 1) / block_alignment * block_alignment;
+        }
+
+        class reader final
+        {
+        public:
+            explicit reader(std::span<std::byte const> bytes) : bytes_{bytes} {}
+
+            template <typename T>
+            T read()
+            {
+                T value;
+                std::memcpy(&value, take(sizeof(T)).data(), sizeof(T));
+                return value;
+            }
+
+            template <typename T>
+            std::span<T const> read_array(size_t count)
+            {
+                align();
+                auto block = take(count * sizeof(T));
+                return {reinterpret_cast<T const *>(block.data()), count};
+            }
+
+            std::string read_string(size_t length)
+            {
+                auto block = take(length);
+                return {reinterpret_cast<char const *>(block.data()), length};
+            }
+
+            void align()
+            {
+                auto aligned = align_up(offset_);
+                if (aligned > bytes_.size())
+                {
+                    throw std::runtime_error("mesh cache truncated");
+                }
+                offset_ = aligned;
+            }
+
+        private:
+            std::span<std::byte const> take(size_t size)
+            {
+                if (size > bytes_.size() - offset_)
+                {
+                    throw std::runtime_error("mesh cache truncated");
+                }
+                auto result = bytes_.subspan(offset_, size);
+                offset_ += size;
+                return result;
+            }
+
+            std::span<std::byte const> bytes_;
+            size_t offset_{0};
+        };
+
+        class writer final
+        {
+        public:
+            explicit writer(std::ofstream &out) : out_{out} {}
+
+            template <typename T>
+            void write(T const &value)
+            {
+                write_bytes(&value, sizeof(T));
+            }
+
+            void write_bytes(void const *p, size_t size)
+            {
+                out_.write(reinterpret_cast<char const *>(p), static_cast<std::streamsize>(size));
+                offset_ += size;
+            }
+
+            void align()
+            {
+                static constexpr std::array<char, block_alignment> zeros{};
+                write_bytes(zeros.data(), align_up(offset_) - offset_);
+            }
+
+        private:
+            std::ofstream &out_;
+            size_t offset_{0};
+        };
+    }
+
+    uint64_t hash_bytes(std::span<std::byte const> bytes, uint64_t seed) noexcept
+    {
+        uint64_t hash = seed;
+        for (auto b : bytes)
+        {
+            hash ^= static_cast<uint64_t>(b);
+            hash *= 0x100000001b3ull;
+        }
+        return hash;
+    }
+
+    uint64_t hash_sources(std::filesystem::path const &model_path, std::span<std::byte const> bytes)
+    {
+        auto hash = hash_bytes(bytes);
+        auto text = std::string_view{reinterpret_cast<char const *>(bytes.data()), bytes.size()};
+        for (auto &name : referenced_files(model_path, text))
+        {
+            hash = hash_bytes(std::as_bytes(std::span{name}), hash);
+            std::error_code ec;
+            auto side_path = model_path.parent_path() / name;
+            if (std::filesystem::is_regular_file(side_path, ec))
+            {
+                auto side = mapped_file{side_path};
+                hash = hash_bytes(side.bytes(), hash);
+            }
+        }
+        return hash;
+    }
+
+    std::filesystem::path cache_path_for(std::filesystem::path const &model_path)
+    {
+        auto path = model_path;
+        path += ".meshcache";
+        return path;
+    }
+
+    std::optional<cache_view> cache_view::open(std::filesystem::path const &path, cache_key const &key)
+    {
+        std::error_code ec;
+        if (!std::filesystem::is_regular_file(path, ec))
+        {
+            return std::nullopt;
+        }
+
+        try
+        {
+            auto view = cache_view{mapped_file{path}};
+            auto r = reader{view.file_.bytes()};
+
+            // braced initializers are evaluated in order, so this reads the fields as write() stores them
+            auto header = file_header{
+                .magic = r.read<std::array<char, 8>>(),
+                .version = r.read<uint32_t>(),
+                .vertex_size = r.read<uint32_t>(),
+                .key = cache_key{
+                    .source_hash = r.read<uint64_t>(),
+                    .import_flags = r.read<uint32_t>(),
+                    .texture_types = r.read<uint32_t>(),
+                    .mesh_flags = r.read<uint32_t>(),
+                },
+                .texture_count = r.read<uint32_t>(),
+                .node_count = r.read<uint32_t>(),
+                .mesh_count = r.read<uint32_t>(),
+            };
+            if (header.magic != magic || header.version != version || header.vertex_size != sizeof(compact_vertex) || !(header.key == key))
+            {
+                return std::nullopt;
+            }
+
+            view.textures_.reserve(header.texture_count);
+            for (uint32_t i = 0; i < header.texture_count; ++i)
+            {
+                auto name_length = r.read<uint32_t>();
+                auto role = static_cast<texture_type>(r.read<uint32_t>());
+                view.textures_.push_back({r.read_string(name_length), role});
+            }
+
+            view.nodes_.reserve(header.node_count);
+            for (uint32_t i = 0; i < header.node_count; ++i)
+            {
+                auto name_length = r.read<uint32_t>();
+                auto parent = r.read<uint32_t>();
+                auto local = r.read<glm::mat4>();
+                if (parent != transform_graph::no_parent && parent >= i)
+                {
+                    throw std::runtime_error("mesh cache node parent out of order");
+                }
+                view.nodes_.push_back({r.read_string(name_length), parent, local});
+            }
+
+            view.meshes_.reserve(header.mesh_count);
+            for (uint32_t i = 0; i < header.mesh_count; ++i)
+            {
+                r.align();
+                auto name_length = r.read<uint32_t>();
+                auto node = r.read<uint32_t>();
+                auto vertex_count = r.read<uint32_t>();
+                auto index_count = r.read<uint32_t>();
+                auto meshlet_count = r.read<uint32_t>();
+                auto lod_count = r.read<uint32_t>();
+                auto binding_count = r.read<uint32_t>();
+
+                if (node >= header.node_count)
+                {
+                    throw std::runtime_error("mesh cache node index out of range");
+                }
+
+                mesh_entry entry;
+                entry.node = node;
+                entry.bounds = r.read<bounds>();
+                for (uint32_t b = 0; b < binding_count; ++b)
+                {
+                    auto type = static_cast<texture_type>(r.read<uint32_t>());
+                    auto index = r.read<uint32_t>();
+                    if (index >= header.texture_count)
+                    {
+                        throw std::runtime_error("mesh cache texture index out of range");
+                    }
+                    entry.textures.emplace_back(type, index);
+                }
+                entry.name = r.read_string(name_length);
+                entry.vertices = r.read_array<compact_vertex>(vertex_count);
+                entry.indices = r.read_array<uint32_t>(index_count);
+                // the index type is picked from the vertex count, a larger index would be truncated or read past the vertices
+                if (std::ranges::any_of(entry.indices, [vertex_count](uint32_t index) { return index >= vertex_count; }))
+                {
+                    throw std::runtime_error("mesh cache index out of bounds");
+                }
+                entry.meshlets = r.read_array<meshlets::meshlet>(meshlet_count);
+                entry.lods = r.read_array<mesh_lod>(lod_count);
+                for (auto &lod : entry.lods)
+                {
+                    if (lod.first_index > index_count || lod.index_count > index_count - lod.first_index)
+                    {
+                        throw std::runtime_error("mesh cache LOD range out of bounds");
+                    }
+                }
+                // the culler turns these into indirect draws without further checks
+                for (auto &m : entry.meshlets)
+                {
+                    if (m.first_index > index_count || m.index_count > index_count - m.first_index)
+                    {
+                        throw std::runtime_error("mesh cache meshlet range out of bounds");
+                    }
+                }
+                view.meshes_.push_back(std::move(entry));
+            }
+            return view;
+        }
+        catch (std::exception const &e)
+        {
+            std::cout << std::format("Ignore mesh cache {}: {}", path.string(), e.what()) << std::endl;
+            return std::nullopt;
+        }
+    }
+
+    void write(std::filesystem::path const &path, cache_key const &key,
+               std::span<texture_entry const> textures, std::span<node_entry const> nodes, std::span<mesh_entry const> meshes)
+    {
+        auto temp_path = path;
+        temp_path += ".tmp";
+        {
+            std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+            if (!out)
+            {
+                throw std::runtime_error(std::format("Cannot write mesh cache: {}", temp_path.string()));
+            }
+            auto w = writer{out};
+
+            // field by field, so no padding bytes end up in the file
+            w.write(magic);
+            w.write(version);
+            w.write(static_cast<uint32_t>(sizeof(compact_vertex)));
+            w.write(key.source_hash);
+            w.write(key.import_flags);
+            w.write(key.texture_types);
+            w.write(key.mesh_flags);
+            w.write(static_cast<uint32_t>(textures.size()));
+            w.write(static_cast<uint32_t>(nodes.size()));
+            w.write(static_cast<uint32_t>(meshes.size()));
+
+            for (auto &texture : textures)
+            {
+                w.write(static_cast<uint32_t>(texture.name.size()));
+                w.write(static_cast<uint32_t>(texture.role));
+                w.write_bytes(texture.name.data(), texture.name.size());
+            }
+
+            for (auto &node : nodes)
+            {
+                w.write(static_cast<uint32_t>(node.name.size()));
+                w.write(node.parent);
+                w.write(node.local);
+                w.write_bytes(node.name.data(), node.name.size());
+            }
+
+            for (auto &mesh : meshes)
+            {
+                w.align();
+                w.write(static_cast<uint32_t>(mesh.name.size()));
+                w.write(mesh.node);
+                w.write(static_cast<uint32_t>(mesh.vertices.size()));
+                w.write(static_cast<uint32_t>(mesh.indices.size()));
+                w.write(static_cast<uint32_t>(mesh.meshlets.size()));
+                w.write(static_cast<uint32_t>(mesh.lods.size()));
+                w.write(static_cast<uint32_t>(mesh.textures.size()));
+                w.write(mesh.bounds);
+                for (auto [type, index] : mesh.textures)
+                {
+                    w.write(static_cast<uint32_t>(type));
+                    w.write(index);
+                }
+                w.write_bytes(mesh.name.data(), mesh.name.size());
+                w.align();
+                w.write_bytes(mesh.vertices.data(), mesh.vertices.size_bytes());
+                w.align();
+                w.write_bytes(mesh.indices.data(), mesh.indices.size_bytes());
+                w.align();
+                w.write_bytes(mesh.meshlets.data(), mesh.meshlets.size_bytes());
+                w.align();
+                w.write_bytes(mesh.lods.data(), mesh.lods.size_bytes());
+            }
+
+            if (!out)
+            {
+                throw std::runtime_error(std::format("Cannot write mesh cache: {}", temp_path.string()));
+            }
+        }
+        std::filesystem::rename(temp_path, path);
+    }
+}
@@ -0,0 +1,267 @@
+#include <algorithm>
+#include <numeric>
+
+#include "mesh_optimizer.hpp"
+
+namespace glwrap::mesh_optimizer
+{
+    namespace
+    {
+        // vertex -> triangles that use it, in CSR layout
+        struct adjacency
+        {
+            std::vector<uint32_t> offsets;
+            std::vector<uint32_t> triangles;
+
+            adjacency(std::span<uint32_t const> indices, size_t vertex_count) : offsets(vertex_count + 1, 0), triangles(indices.size())
+            {
+                for (auto v : indices)
+                {
+                    ++offsets[v + 1];
+                }
+                std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+                std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+                for (size_t i = 0; i < indices.size(); ++i)
+                {
+                    triangles[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+                }
+            }
+
+            std::span<uint32_t const> of(uint32_t v) const noexcept
+            {
+                return {triangles.data() + offsets[v], triangles.data() + offsets[v + 1]};
+            }
+        };
+    }
+
+    cache_stats analyze_vertex_cache(std::span<uint32_t const> indices, size_t vertex_count, uint32_t cache_size)
+    {
+        cache_stats stats{indices.size() / 3, 0, 0};
+        // a vertex is cached while fewer than cache_size misses happened since it was loaded
+        std::vector<size_t> loaded_at(vertex_count, 0);
+        std::vector<bool> used(vertex_count, false);
+        for (auto v : indices)
+        {
+            if (!used[v])
+            {
+                used[v] = true;
+                ++stats.vertices;
+            }
+            if (loaded_at[v] == 0 || stats.misses + 1 - loaded_at[v] > cache_size)
+            {
+                ++stats.misses;
+                loaded_at[v] = stats.misses;
+            }
+        }
+        return stats;
+    }
+
+    std::vector<uint32_t> tipsify(std::span<uint32_t const> indices, size_t vertex_count, uint32_t cache_size, std::vector<size_t> *clusters)
+    {
+        std::vector<uint32_t> result;
+        result.reserve(indices.size());
+        if (clusters)
+        {
+            clusters->clear();
+        }
+        // a trailing partial triangle would index past the per-triangle arrays, it is dropped
+        indices = indices.first(indices.size() / 3 * 3);
+        if (indices.empty())
+        {
+            return result;
+        }
+
+        adjacency adj{indices, vertex_count};
+        std::vector<uint32_t> live(vertex_count);
+        for (uint32_t v = 0; v < vertex_count; ++v)
+        {
+            live[v] = static_cast<uint32_t>(adj.of(v).size());
+        }
+        std::vector<size_t> cache_time(vertex_count, 0);
+        std::vector<bool> emitted(indices.size() / 3, false);
+        std::vector<uint32_t> dead_end;
+        std::vector<uint32_t> candidates;
+        size_t time = cache_size + 1;
+        uint32_t cursor = 0;
+
+        // next vertex with live triangles, from the dead-end stack first, then in input order; -1 when done
+        auto skip_dead_end = [&]() -> int64_t
+        {
+            while (!dead_end.empty())
+            {
+                auto v = dead_end.back();
+                dead_end.pop_back();
+                if (live[v] > 0)
+                {
+                    return v;
+                }
+            }
+            for (; cursor < vertex_count; ++cursor)
+            {
+                if (live[cursor] > 0)
+                {
+                    return cursor;
+                }
+            }
+            return -1;
+        };
+
+        int64_t fanning = indices[0];
+        if (clusters)
+        {
+            clusters->push_back(0);
+        }
+        while (fanning >= 0)
+        {
+            candidates.clear();
+            for (auto t : adj.of(static_cast<uint32_t>(fanning)))
+            {
+                if (emitted[t])
+                {
+                    continue;
+                }
+                for (int corner = 0; corner < 3; ++corner)
+                {
+                    auto v = indices[t * 3 + corner];
+                    result.push_back(v);
+                    dead_end.push_back(v);
+                    candidates.push_back(v);
+                    --live[v];
+                    if (time - cache_time[v] > cache_size)
+                    {
+                        cache_time[v] = time++;
+                    }
+                }
+                emitted[t] = true;
+            }
+
+            // prefer the candidate that stays in the cache longest while fanning its remaining triangles
+            int64_t best = -1;
+            int64_t best_priority = 0;
+            for (auto v : candidates)
+            {
+                if (live[v] == 0)
+                {
+                    continue;
+                }
+                int64_t priority = 0;
+                if (time - cache_time[v] + 2 * live[v] <= cache_size)
+                {
+                    priority = static_cast<int64_t>(time - cache_time[v]);
+                }
+                if (priority > best_priority)
+                {
+                    best = v;
+                    best_priority = priority;
+                }
+            }
+            if (best < 0)
+            {
+                best = skip_dead_end();
+                if (best >= 0 && clusters && clusters->back() != result.size())
+                {
+                    clusters->push_back(result.size());
+                }
+            }
+            fanning = best;
+        }
+        return result;
+    }
+
+    std::vector<uint32_t> optimize_overdraw(std::span<uint32_t const> indices, std::span<size_t const> clusters, std::span<vertex const> vertices,
+                                            float threshold, uint32_t cache_size)
+    {
+        std::vector<uint32_t> input(indices.begin(), indices.end());
+        if (clusters.size() < 2)
+        {
+            return input;
+        }
+
+        struct cluster_info
+        {
+            size_t begin, end;
+            glm::vec3 centroid;
+            glm::vec3 normal;
+            float sort_key;
+        };
+
+        // area weighted centroid and normal of every cluster, and of the whole mesh
+        std::vector<cluster_info> infos;
+        infos.reserve(clusters.size());
+        glm::vec3 mesh_centroid{0};
+        float mesh_area = 0;
+        for (size_t c = 0; c < clusters.size(); ++c)
+        {
+            cluster_info info{clusters[c], c + 1 < clusters.size() ? clusters[c + 1] : indices.size(), glm::vec3{0}, glm::vec3{0}, 0};
+            float area = 0;
+            for (auto i = info.begin; i < info.end; i += 3)
+            {
+                auto &p0 = vertices[indices[i]].position;
+                auto &p1 = vertices[indices[i + 1]].position;
+                auto &p2 = vertices[indices[i + 2]].position;
+                auto cross = glm::cross(p1 - p0, p2 - p0);
+                auto tri_area = glm::length(cross) * 0.5f;
+                info.centroid += (p0 + p1 + p2) / 3.0f * tri_area;
+                info.normal += cross;
+                area += tri_area;
+            }
+            mesh_centroid += info.centroid;
+            mesh_area += area;
+            info.centroid = area > 0 ? info.centroid / area : vertices[indices[info.begin]].position;
+            auto normal_length = glm::length(info.normal);
+            info.normal = normal_length > 0 ? info.normal / normal_length : glm::vec3{0};
+            infos.push_back(info);
+        }
+        if (mesh_area > 0)
+        {
+            mesh_centroid /= mesh_area;
+        }
+
+        // clusters facing away from the center are likely to occlude the rest, draw them first
+        for (auto &info : infos)
+        {
+            info.sort_key = glm::dot(info.centroid - mesh_centroid, info.normal);
+        }
+        std::ranges::stable_sort(infos, std::ranges::greater{}, &cluster_info::sort_key);
+
+        std::vector<uint32_t> result;
+        result.reserve(indices.size());
+        for (auto &info : infos)
+        {
+            result.insert(result.end(), indices.begin() + info.begin, indices.begin() + info.end);
+        }
+
+        auto before = analyze_vertex_cache(input, vertices.size(), cache_size);
+        auto after = analyze_vertex_cache(result, vertices.size(), cache_size);
+        return after.acmr() <= before.acmr() * threshold ? result : input;
+    }
+
+    std::vector<vertex> optimize_vertex_fetch(std::span<vertex const> vertices, std::span<uint32_t> indices)
+    {
+        constexpr auto unassigned = ~uint32_t{0};
+        std::vector<uint32_t> remap(vertices.size(), unassigned);
+        std::vector<vertex> result;
+        result.reserve(vertices.size());
+        for (auto &index : indices)
+        {
+            if (remap[index] == unassigned)
+            {
+                remap[index] = static_cast<uint32_t>(result.size());
+                result.push_back(vertices[index]);
+            }
+            index = remap[index];
+        }
+        return result;
+    }
+
+    report optimize(std::vector<vertex> &vertices, std::vector<uint32_t> &indices, uint32_t cache_size)
+    {
+        report r{analyze_vertex_cache(indices, vertices.size(), cache_size), {}};
+        std::vector<size_t> clusters;
+        auto tipsified = tipsify(indices, vertices.size(), cache_size, &clusters);
+        indices = optimize_overdraw(tipsified, clusters, vertices, 1.05f, cache_size);
+        vertices = optimize_vertex_fetch(vertices, indices);
+        r.after = analyze_vertex_cache(indices, vertices.size(), cache_size);
+        return r;
+    }
+}
@@ -0,0 +1,273 @@
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <tuple>
+
+#include "mesh_optimizer.hpp"
+#include "mesh_simplifier.hpp"
+
+namespace glwrap::mesh_simplifier
+{
+    namespace
+    {
+        // symmetric 4x4 matrix of the summed plane equations, weighted by triangle area
+        struct quadric
+        {
+            double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2;
+            double weight;
+
+            void add_plane(glm::vec3 n, float d, double w) noexcept
+            {
+                a2 += w * n.x * n.x;
+                ab += w * n.x * n.y;
+                ac += w * n.x * n.z;
+                ad += w * n.x * d;
+                b2 += w * n.y * n.y;
+                bc += w * n.y * n.z;
+                bd += w * n.y * d;
+                c2 += w * n.z * n.z;
+                cd += w * n.z * d;
+                d2 += w * d * d;
+                weight += w;
+            }
+
+            quadric &operator+=(quadric const &q) noexcept
+            {
+                a2 += q.a2, ab += q.ab, ac += q.ac, ad += q.ad, b2 += q.b2;
+                bc += q.bc, bd += q.bd, c2 += q.c2, cd += q.cd, d2 += q.d2;
+                weight += q.weight;
+                return *this;
+            }
+
+            // mean squared distance of p to the planes
+            double error(glm::vec3 p) const noexcept
+            {
+                double x = p.x, y = p.y, z = p.z;
+                auto e = a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x
+                         + b2 * y * y + 2 * bc * y * z + 2 * bd * y
+                         + c2 * z * z + 2 * cd * z + d2;
+                return weight > 0 ? std::max(e, 0.0) / weight : 0.0;
+            }
+        };
+
+        // vertices on open borders or at positions shared by several vertices (attribute seams) must stay in place
+        std::vector<bool> find_locked(std::span<vertex const> vertices, std::span<uint32_t const> indices)
+        {
+            std::vector<bool> locked(vertices.size(), false);
+
+            std::vector<uint64_t> edges;
+            edges.reserve(indices.size());
+            for (size_t t = 0; t + 2 < indices.size(); t += 3)
+            {
+                for (size_t k = 0; k < 3; ++k)
+                {
+                    uint64_t a = indices[t + k];
+                    uint64_t b = indices[t + (k + 1) % 3];
+                    edges.push_back(a < b ? a << 32 | b : b << 32 | a);
+                }
+            }
+            std::ranges::sort(edges);
+            for (size_t i = 0; i < edges.size();)
+            {
+                auto j = i;
+                while (j < edges.size() && edges[j] == edges[i])
+                {
+                    ++j;
+                }
+                if (j - i == 1)
+                {
+                    locked[edges[i] >> 32] = true;
+                    locked[edges[i] & 0xffffffffu] = true;
+                }
+                i = j;
+            }
+
+            std::vector<uint32_t> order(vertices.size());
+            std::iota(order.begin(), order.end(), 0u);
+            auto key = [&](uint32_t v) { auto &p = vertices[v].position; return std::tuple(p.x, p.y, p.z); };
+            std::ranges::sort(order, [&](uint32_t a, uint32_t b) { return key(a) < key(b); });
+            for (size_t i = 1; i < order.size(); ++i)
+            {
+                if (key(order[i]) == key(order[i - 1]))
+                {
+                    locked[order[i]] = true;
+                    locked[order[i - 1]] = true;
+                }
+            }
+            return locked;
+        }
+
+        struct collapse
+        {
+            uint32_t from;
+            uint32_t to;
+            double cost;
+        };
+    }
+
+    std::vector<uint32_t> simplify(std::span<vertex const> vertices, std::span<uint32_t const> indices, size_t target_index_count,
+                                   float *result_error)
+    {
+        std::vector<uint32_t> result(indices.begin(), indices.end() - indices.size() % 3);
+        auto vertex_count = vertices.size();
+        auto locked = find_locked(vertices, result);
+
+        std::vector<quadric> quadrics(vertex_count, quadric{});
+        for (size_t t = 0; t < result.size(); t += 3)
+        {
+            auto &p0 = vertices[result[t]].position;
+            auto n = glm::cross(vertices[result[t + 1]].position - p0, vertices[result[t + 2]].position - p0);
+            auto length = glm::length(n);
+            if (length == 0.0f)
+            {
+                continue;
+            }
+            n /= length;
+            auto d = -glm::dot(n, p0);
+            for (size_t k = 0; k < 3; ++k)
+            {
+                quadrics[result[t + k]].add_plane(n, d, length * 0.5);
+            }
+        }
+
+        double max_error = 0.0;
+        std::vector<uint32_t> remap(vertex_count);
+        std::vector<bool> touched;
+        std::vector<collapse> candidates;
+        std::vector<uint32_t> offsets;
+        std::vector<uint32_t> adjacent;
+
+        while (result.size() > target_index_count)
+        {
+            // vertex -> triangles, in CSR layout
+            offsets.assign(vertex_count + 1, 0);
+            for (auto v : result)
+            {
+                ++offsets[v + 1];
+            }
+            std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+            adjacent.resize(result.size());
+            {
+                std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+                for (size_t i = 0; i < result.size(); ++i)
+                {
+                    adjacent[fill[result[i]]++] = static_cast<uint32_t>(i / 3);
+                }
+            }
+
+            candidates.clear();
+            for (size_t t = 0; t < result.size(); t += 3)
+            {
+                for (size_t k = 0; k < 3; ++k)
+                {
+                    auto a = result[t + k];
+                    auto b = result[t + (k + 1) % 3];
+                    auto merged = quadrics[a];
+                    merged += quadrics[b];
+                    if (!locked[a])
+                    {
+                        candidates.push_back({a, b, merged.error(vertices[b].position)});
+                    }
+                    if (!locked[b])
+                    {
+                        candidates.push_back({b, a, merged.error(vertices[a].position)});
+                    }
+                }
+            }
+            std::ranges::sort(candidates, {}, &collapse::cost);
+
+            // a triangle of from that does not contain to must keep its orientation after the move
+            auto flips = [&](uint32_t from, uint32_t to)
+            {
+                for (auto i = offsets[from]; i < offsets[from + 1]; ++i)
+                {
+                    auto t = adjacent[i] * 3;
+                    auto v0 = result[t], v1 = result[t + 1], v2 = result[t + 2];
+                    if (v0 == to || v1 == to || v2 == to)
+                    {
+                        continue;
+                    }
+                    auto position = [&](uint32_t v) { return vertices[v == from ? to : v].position; };
+                    auto before = glm::cross(vertices[v1].position - vertices[v0].position, vertices[v2].position - vertices[v0].position);
+                    auto after = glm::cross(position(v1) - position(v0), position(v2) - position(v0));
+                    if (glm::dot(before, after) <= 0.0f)
+                    {
+                        return true;
+                    }
+                }
+                return false;
+            };
+
+            std::iota(remap.begin(), remap.end(), 0u);
+            touched.assign(vertex_count, false);
+            auto triangles_to_remove = (result.size() - target_index_count + 2) / 3;
+            size_t removed = 0;
+            for (auto &c : candidates)
+            {
+                if (removed >= triangles_to_remove)
+                {
+                    break;
+                }
+                if (touched[c.from] || touched[c.to] || flips(c.from, c.to))
+                {
+                    continue;
+                }
+                remap[c.from] = c.to;
+                for (auto i = offsets[c.from]; i < offsets[c.from + 1]; ++i)
+                {
+                    auto t = adjacent[i] * 3;
+                    touched[result[t]] = touched[result[t + 1]] = touched[result[t + 2]] = true;
+                    removed += result[t] == c.to || result[t + 1] == c.to || result[t + 2] == c.to;
+                }
+                quadrics[c.to] += quadrics[c.from];
+                max_error = std::max(max_error, c.cost);
+            }
+            if (removed == 0)
+            {
+                break;
+            }
+
+            size_t write = 0;
+            for (size_t t = 0; t < result.size(); t += 3)
+            {
+                auto v0 = remap[result[t]], v1 = remap[result[t + 1]], v2 = remap[result[t + 2]];
+                if (v0 != v1 && v1 != v2 && v0 != v2)
+                {
+                    result[write++] = v0;
+                    result[write++] = v1;
+                    result[write++] = v2;
+                }
+            }
+            result.resize(write);
+        }
+
+        if (result_error)
+        {
+            *result_error = static_cast<float>(std::sqrt(max_error));
+        }
+        return result;
+    }
+
+    std::vector<mesh_lod> build_lods(std::span<vertex const> vertices, std::vector<uint32_t> &indices, size_t lod_count, float reduction)
+    {
+        std::vector<mesh_lod> lods{{0, static_cast<uint32_t>(indices.size()), 0.0f}};
+        while (lods.size() < lod_count)
+        {
+            // each level starts from the previous one, so errors add up
+            auto previous = lods.back();
+            auto target = static_cast<size_t>(static_cast<float>(previous.index_count / 3) * reduction) * 3;
+            float error = 0.0f;
+            auto lod = simplify(vertices, std::span{indices}.subspan(previous.first_index, previous.index_count), target, &error);
+            // not worth another draw range if locked vertices keep it close to the previous level
+            if (lod.empty() || lod.size() > previous.index_count * 9 / 10)
+            {
+                break;
+            }
+            lod = mesh_optimizer::tipsify(lod, vertices.size());
+
+            lods.push_back({static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(lod.size()), previous.error + error});
+            indices.insert(indices.end(), lod.begin(), lod.end());
+        }
+        return lods;
+    }
+}
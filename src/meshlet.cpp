@@ -0,0 +1,255 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "meshlet.hpp"
+#include "model.hpp"
+
+namespace glwrap::meshlets
+{
+    namespace
+    {
+        // triangles whose normals all lie within a cone narrower than this (cosine) can be culled as a whole
+        constexpr float min_cone_spread = 0.1f;
+
+        meshlet bounds(std::span<vertex const> vertices, std::span<uint32_t const> indices, uint32_t first_index, uint32_t vertex_count)
+        {
+            glm::vec3 lo{std::numeric_limits<float>::max()};
+            glm::vec3 hi{std::numeric_limits<float>::lowest()};
+            for (auto i : indices)
+            {
+                lo = glm::min(lo, vertices[i].position);
+                hi = glm::max(hi, vertices[i].position);
+            }
+            auto center = (lo + hi) * 0.5f;
+            float radius = 0.0f;
+            for (auto i : indices)
+            {
+                radius = std::max(radius, glm::length(vertices[i].position - center));
+            }
+
+            // area weighted average of the face normals, faces are counter-clockwise
+            std::vector<glm::vec3> normals;
+            normals.reserve(indices.size() / 3);
+            glm::vec3 axis{0.0f};
+            for (size_t t = 0; t + 2 < indices.size(); t += 3)
+            {
+                auto a = vertices[indices[t]].position;
+                auto n = glm::cross(vertices[indices[t + 1]].position - a, vertices[indices[t + 2]].position - a);
+                axis += n;
+                auto length = glm::length(n);
+                if (length > 0.0f)
+                {
+                    normals.push_back(n / length);
+                }
+            }
+
+            float cutoff = 1.0f;
+            auto axis_length = glm::length(axis);
+            if (axis_length > 0.0f)
+            {
+                axis /= axis_length;
+                float min_dot = 1.0f;
+                for (auto &n : normals)
+                {
+                    min_dot = std::min(min_dot, glm::dot(n, axis));
+                }
+                if (min_dot > min_cone_spread)
+                {
+                    cutoff = std::sqrt(1.0f - min_dot * min_dot);
+                }
+            }
+
+            return {
+                .center = center,
+                .radius = radius,
+                .cone_axis = axis,
+                .cone_cutoff = cutoff,
+                .first_index = first_index,
+                .index_count = static_cast<uint32_t>(indices.size()),
+                .vertex_count = vertex_count,
+                .padding = 0,
+            };
+        }
+    }
+
+    std::vector<meshlet> build(std::span<vertex const> vertices, std::span<uint32_t const> indices)
+    {
+        std::vector<meshlet> result;
+        // 1 + index of the meshlet that last took each vertex
+        std::vector<size_t> taken_by(vertices.size(), 0);
+        size_t first = 0;
+        uint32_t vertex_count = 0;
+
+        auto flush = [&](size_t end)
+        {
+            if (end > first)
+            {
+                result.push_back(bounds(vertices, indices.subspan(first, end - first), static_cast<uint32_t>(first), vertex_count));
+            }
+            first = end;
+            vertex_count = 0;
+        };
+
+        auto new_vertices = [&](size_t t)
+        {
+            uint32_t count = 0;
+            for (size_t k = 0; k < 3; ++k)
+            {
+                auto v = indices[t + k];
+                // a degenerate triangle may repeat a vertex, count it once
+                auto repeated = (k > 0 && indices[t] == v) || (k > 1 && indices[t + 1] == v);
+                if (taken_by[v] != result.size() + 1 && !repeated)
+                {
+                    ++count;
+                }
+            }
+            return count;
+        };
+
+        auto triangle_end = indices.size() - indices.size() % 3;
+        for (size_t t = 0; t < triangle_end; t += 3)
+        {
+            auto count = new_vertices(t);
+            if (vertex_count + count > max_vertices || (t - first) / 3 == max_triangles)
+            {
+                flush(t);
+                count = new_vertices(t);
+            }
+            for (size_t k = 0; k < 3; ++k)
+            {
+                taken_by[indices[t + k]] = result.size() + 1;
+            }
+            vertex_count += count;
+        }
+        flush(triangle_end);
+        return result;
+    }
+
+    std::array<glm::vec4, 6> frustum_planes(glm::mat4 const &matrix) noexcept
+    {
+        auto row = [&](int i) { return glm::vec4(matrix[0][i], matrix[1][i], matrix[2][i], matrix[3][i]); };
+        std::array<glm::vec4, 6> planes{
+            row(3) + row(0),
+            row(3) - row(0),
+            row(3) + row(1),
+            row(3) - row(1),
+            row(3) + row(2),
+            row(3) - row(2),
+        };
+        for (auto &plane : planes)
+        {
+            plane /= glm::length(glm::vec3(plane));
+        }
+        return planes;
+    }
+
+    bool is_visible(meshlet const &m, std::span<glm::vec4 const, 6> planes, glm::vec3 eye, cull_params const &params) noexcept
+    {
+        auto radius = m.radius + params.radius_padding;
+        for (auto &plane : planes)
+        {
+            if (glm::dot(glm::vec3(plane), m.center) + plane.w < -radius)
+            {
+                return false;
+            }
+        }
+        if (params.backfaces)
+        {
+            auto to_center = m.center - eye;
+            if (glm::dot(to_center, m.cone_axis) >= m.cone_cutoff * glm::length(to_center) + radius)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    culler::culler()
+        : program_{make_compute_program("shaders/compute/meshlet_cull.glsl")},
+          meshlet_count_{program_.uniform("meshletCount")},
+          frustum_planes_{program_.uniform("frustumPlanes")},
+          eye_{program_.uniform("eye")},
+          cull_backfaces_{program_.uniform("cullBackfaces")},
+          radius_padding_{program_.uniform("radiusPadding")},
+          first_index_{program_.uniform("firstIndex")},
+          base_vertex_{program_.uniform("baseVertex")}
+    {
+    }
+
+    void culler::reserve(size_t command_count)
+    {
+        auto capacity = commands_.has_value() ? commands_->size() : 0;
+        if (command_count <= capacity)
+        {
+            return;
+        }
+        commands_.reset();
+        commands_.emplace(std::max(command_count, capacity * 2));
+    }
+
+    void culler::draw(mesh &m, glm::mat4 const &model_view_projection, glm::vec3 eye, cull_params const &params)
+    {
+        auto meshlets = m.get_meshlets();
+        auto &varray = m.get_varray();
+        auto range = m.get_range();
+        // suballocated index buffers start inside their buffer, indirect commands count from its start
+        auto first_index = static_cast<uint32_t>(varray.index_offset()) + range.first_index;
+        stats_.meshlets += meshlets.size();
+        if (params.mode == cull_mode::none || meshlets.empty())
+        {
+            stats_.visible += meshlets.size();
+            m.draw(draw_mode::triangles);
+            return;
+        }
+
+        reserve(meshlets.size());
+        auto planes = frustum_planes(model_view_projection);
+
+        if (params.mode == cull_mode::cpu)
+        {
+            staging_.clear();
+            for (auto &meshlet : meshlets)
+            {
+                if (is_visible(meshlet, planes, eye, params))
+                {
+                    staging_.push_back({meshlet.index_count, 1, first_index + meshlet.first_index, range.base_vertex, 0});
+                }
+            }
+            stats_.visible += staging_.size();
+            if (staging_.empty())
+            {
+                return;
+            }
+            commands_->set(0, staging_);
+            varray.multi_draw_indirect(draw_mode::triangles, *commands_, 0, staging_.size());
+            return;
+        }
+
+        // visible meshlets are appended to the front, the zeroed tail draws nothing
+        // (glMultiDrawElementsIndirectCount would need GL 4.6)
+        auto command_bytes = meshlets.size() * sizeof(draw_elements_indirect_command);
+        ::glClearNamedBufferSubData(commands_->handle(), GL_R32UI, 0, command_bytes, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+        ::glClearNamedBufferData(counter_.handle(), GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+
+        meshlet_count_.set_uint(static_cast<GLuint>(meshlets.size()));
+        frustum_planes_.set_vec4s(planes);
+        eye_.set_vec3(eye);
+        cull_backfaces_.set_bool(params.backfaces);
+        radius_padding_.set_float(params.radius_padding);
+        first_index_.set_uint(first_index);
+        base_vertex_.set_int(range.base_vertex);
+
+        GLint previous_program = 0;
+        ::glGetIntegerv(GL_CURRENT_PROGRAM, &previous_program);
+        program_.use();
+        ::glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m.get_meshlet_buffer().handle());
+        commands_->bind_base(1);
+        counter_.bind_base(2);
+        ::glDispatchCompute(static_cast<GLuint>((meshlets.size() + 63) / 64), 1, 1);
+        ::glMemoryBarrier(GL_COMMAND_BARRIER_BIT);
+        ::glUseProgram(static_cast<GLuint>(previous_program));
+
+        varray.multi_draw_indirect(draw_mode::triangles, *commands_, 0, meshlets.size());
+    }
+}
@@ -0,0 +1,220 @@
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <span>
+#include <unordered_map>
+
+#include "mikktspace.hpp"
+#include "model.hpp"
+
+namespace mikkt
+{
+    namespace
+    {
+        constexpr uint32_t no_group = std::numeric_limits<uint32_t>::max();
+
+        struct weld_key
+        {
+            glm::vec3 position;
+            glm::vec3 normal;
+            glm::vec2 texcoords;
+
+            bool operator==(weld_key const &other) const noexcept
+            {
+                return position == other.position && normal == other.normal && texcoords == other.texcoords;
+            }
+        };
+
+        struct weld_hash
+        {
+            size_t operator()(weld_key const &key) const noexcept
+            {
+                // std::hash<float> hashes 0 and -0 alike, which compare equal
+                std::hash<float> h;
+                size_t seed = 0;
+                for (auto f : {key.position.x, key.position.y, key.position.z, key.normal.x, key.normal.y, key.normal.z, key.texcoords.x, key.texcoords.y})
+                {
+                    seed ^= h(f) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+                }
+                return seed;
+            }
+        };
+
+        struct face
+        {
+            // texture space u direction, unit length, already flipped on mirrored faces
+            glm::vec3 os;
+            // uvs wind the same way as the positions
+            bool preserving;
+            // no area in position or texture space
+            bool degenerate;
+        };
+
+        face evaluate_face(std::span<glwrap::vertex const> vertices, uint32_t const *corners) noexcept
+        {
+            auto &v0 = vertices[corners[0]];
+            auto &v1 = vertices[corners[1]];
+            auto &v2 = vertices[corners[2]];
+            auto d1 = v1.position - v0.position;
+            auto d2 = v2.position - v0.position;
+            auto t1 = v1.texcoords - v0.texcoords;
+            auto t2 = v2.texcoords - v0.texcoords;
+
+            auto signed_area = t1.x * t2.y - t1.y * t2.x;
+            auto os = t2.y * d1 - t1.y * d2;
+            auto length = glm::length(os);
+            face result{.os = glm::vec3{0.0f}, .preserving = signed_area > 0.0f, .degenerate = true};
+            if (signed_area != 0.0f && length > 0.0f && glm::length(glm::cross(d1, d2)) > 0.0f)
+            {
+                result.os = os * ((result.preserving ? 1.0f : -1.0f) / length);
+                result.degenerate = false;
+            }
+            return result;
+        }
+
+        glm::vec3 project(glm::vec3 v, glm::vec3 n) noexcept
+        {
+            auto p = v - glm::dot(n, v) * n;
+            auto length = glm::length(p);
+            return length > 0.0f ? p / length : glm::vec3{0.0f};
+        }
+
+        // any unit vector perpendicular to n, for vertices without a usable face
+        glm::vec3 perpendicular(glm::vec3 n) noexcept
+        {
+            auto axis = std::abs(n.x) < 0.9f ? glm::vec3{1.0f, 0.0f, 0.0f} : glm::vec3{0.0f, 1.0f, 0.0f};
+            auto t = project(axis, n);
+            return glm::length(t) > 0.0f ? t : axis;
+        }
+
+        template <typename Func>
+        void for_chunks(size_t count, size_t max_workers, Func &&func)
+        {
+            auto chunks = (count + triangles_per_task - 1) / triangles_per_task;
+            utils::parallel_for(chunks, [&](size_t chunk)
+            {
+                auto first = chunk * triangles_per_task;
+                auto last = std::min(first + triangles_per_task, count);
+                for (auto i = first; i < last; ++i)
+                {
+                    func(i);
+                }
+            }, max_workers);
+        }
+    }
+
+    void generate_tangents(std::vector<glwrap::vertex> &vertices, std::vector<uint32_t> &indices, size_t max_workers)
+    {
+        auto triangle_count = indices.size() / 3;
+        indices.resize(triangle_count * 3);
+        if (triangle_count == 0)
+        {
+            return;
+        }
+
+        // weld
+        std::vector<uint32_t> welded(vertices.size());
+        uint32_t welded_count = 0;
+        {
+            std::unordered_map<weld_key, uint32_t, weld_hash> map;
+            map.reserve(vertices.size());
+            for (size_t v = 0; v < vertices.size(); ++v)
+            {
+                auto [iter, inserted] = map.try_emplace({vertices[v].position, vertices[v].normal, vertices[v].texcoords}, welded_count);
+                welded[v] = iter->second;
+                welded_count += inserted;
+            }
+        }
+
+        std::vector<face> faces(triangle_count);
+        for_chunks(triangle_count, max_workers, [&](size_t t) { faces[t] = evaluate_face(vertices, &indices[t * 3]); });
+
+        // one group per welded vertex and orientation, degenerate faces join whichever group exists
+        std::vector<uint32_t> group_of_key(size_t{welded_count} * 2, no_group);
+        std::vector<uint32_t> corner_groups(indices.size());
+        uint32_t group_count = 0;
+        auto group_for = [&](size_t key)
+        {
+            if (group_of_key[key] == no_group)
+            {
+                group_of_key[key] = group_count++;
+            }
+            return group_of_key[key];
+        };
+        for (size_t t = 0; t < triangle_count; ++t)
+        {
+            if (!faces[t].degenerate)
+            {
+                for (size_t k = 0; k < 3; ++k)
+                {
+                    corner_groups[t * 3 + k] = group_for(size_t{welded[indices[t * 3 + k]]} * 2 + faces[t].preserving);
+                }
+            }
+        }
+        for (size_t t = 0; t < triangle_count; ++t)
+        {
+            if (faces[t].degenerate)
+            {
+                for (size_t k = 0; k < 3; ++k)
+                {
+                    auto key = size_t{welded[indices[t * 3 + k]]} * 2;
+                    corner_groups[t * 3 + k] = group_of_key[key] != no_group ? group_of_key[key] : group_for(key + 1);
+                }
+            }
+        }
+
+        // group -> corners, in CSR layout
+        std::vector<uint32_t> offsets(group_count + 1, 0);
+        for (auto g : corner_groups)
+        {
+            ++offsets[g + 1];
+        }
+        std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+        std::vector<uint32_t> corners(corner_groups.size());
+        {
+            std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+            for (size_t c = 0; c < corner_groups.size(); ++c)
+            {
+                corners[fill[corner_groups[c]]++] = static_cast<uint32_t>(c);
+            }
+        }
+
+        std::vector<glwrap::vertex> result(group_count);
+        for_chunks(group_count, max_workers, [&](size_t g)
+        {
+            auto first_corner = corners[offsets[g]];
+            auto &source = vertices[indices[first_corner]];
+            auto n = source.normal;
+            auto preserving = true;
+            glm::vec3 tangent{0.0f};
+            for (auto i = offsets[g]; i < offsets[g + 1]; ++i)
+            {
+                auto c = corners[i];
+                auto t = c / 3;
+                if (faces[t].degenerate)
+                {
+                    continue;
+                }
+                preserving = faces[t].preserving;
+                auto k = c % 3;
+                auto p = vertices[indices[c]].position;
+                auto e1 = project(vertices[indices[t * 3 + (k + 1) % 3]].position - p, n);
+                auto e2 = project(vertices[indices[t * 3 + (k + 2) % 3]].position - p, n);
+                auto angle = std::acos(std::clamp(glm::dot(e1, e2), -1.0f, 1.0f));
+                tangent += project(faces[t].os, n) * angle;
+            }
+            auto length = glm::length(tangent);
+            tangent = length > 0.0f ? tangent / length : perpendicular(n);
+
+            auto &out = result[g];
+            out = source;
+            out.tangent = tangent;
+            out.bitangent = glm::cross(n, tangent) * (preserving ? 1.0f : -1.0f);
+        });
+
+        vertices = std::move(result);
+        indices = std::move(corner_groups);
+    }
+}
@@ -0,0 +1,514 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <numbers>
+
+#include "cpu_features.hpp"
+#include "half.hpp"
+#include "mipmap.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define MIPMAP_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#define MIPMAP_TARGET_AVX2
+#else
+#define MIPMAP_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#endif
+#else
+#define MIPMAP_X86 0
+#endif
+
+/*
+    Every level is kept as rows of RGBA floats (missing channels are zero), so all kernels see one pixel as 4 floats.
+    Filters are separable: a horizontal pass halves the width of every source row, then a vertical pass
+    combines the taps rows of each output row. Source pixel 2x + first + k contributes weights[k] to output pixel x,
+    indices are clamped at the edges.
+    Levels are filtered in row bands: horizontally filtered rows live in a ring of one row per tap, and level 1 reads the
+    source bitmap one converted row at a time, so no full-resolution float copy is ever made. Only level 1 and smaller
+    levels are kept as floats, at most a quarter of the source pixels.
+ */
+
+namespace
+{
+    using mipmap::filter;
+    using mipmap::instruction_set;
+
+    struct float_image
+    {
+        int width;
+        int height;
+        std::vector<float> pixels;
+    };
+
+    struct filter_taps
+    {
+        int first;
+        std::vector<float> weights;
+    };
+
+    struct kernel_set
+    {
+        void (*horizontal)(float const *src, int src_width, float *dst, int dst_width, filter_taps const &taps);
+        // dst[i] = sum(rows[k][i] * weights[k]) for i in [0, count)
+        void (*vertical)(float const *const *rows, float const *weights, int tap_count, float *dst, size_t count);
+    };
+
+    // ---------------------- sRGB LUTs ----------------------
+
+    float srgb_to_linear(float c) noexcept
+    {
+        return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+    }
+
+    float linear_to_srgb(float c) noexcept
+    {
+        return c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+    }
+
+    constexpr int linear_lut_size = 8192;
+
+    std::array<float, 256> const &srgb_to_linear_lut()
+    {
+        static auto const lut = []
+        {
+            std::array<float, 256> t;
+            for (int i = 0; i < 256; ++i)
+            {
+                t[i] = srgb_to_linear(i / 255.0f);
+            }
+            return t;
+        }();
+        return lut;
+    }
+
+    // indexed by round(linear * (linear_lut_size - 1)), max error is well below one 8 bit step
+    std::array<uint8_t, linear_lut_size> const &linear_to_srgb_lut()
+    {
+        static auto const lut = []
+        {
+            std::array<uint8_t, linear_lut_size> t;
+            for (int i = 0; i < linear_lut_size; ++i)
+            {
+                t[i] = static_cast<uint8_t>(linear_to_srgb(i / static_cast<float>(linear_lut_size - 1)) * 255.0f + 0.5f);
+            }
+            return t;
+        }();
+        return lut;
+    }
+
+    // ---------------------- filters ----------------------
+
+    double bessel_i0(double x) noexcept
+    {
+        double sum = 1.0, term = 1.0;
+        for (int k = 1; k < 32; ++k)
+        {
+            term *= (x / (2.0 * k)) * (x / (2.0 * k));
+            sum += term;
+        }
+        return sum;
+    }
+
+    filter_taps make_kaiser_taps()
+    {
+        constexpr double alpha = 4.0;
+        constexpr double radius = 3.0;
+        filter_taps taps{-2, {}};
+        double total = 0.0;
+        std::array<double, 6> weights;
+        for (int k = 0; k < 6; ++k)
+        {
+            // distance from the output pixel center (2x + 1) to the source pixel center (2x + first + k + 0.5), in source pixels
+            auto d = std::abs(taps.first + k + 0.5 - 1.0);
+            auto t = std::numbers::pi * d / 2.0;
+            auto sinc = t == 0.0 ? 1.0 : std::sin(t) / t;
+            auto window = bessel_i0(alpha * std::sqrt(std::max(0.0, 1.0 - (d / radius) * (d / radius)))) / bessel_i0(alpha);
+            weights[k] = sinc * window;
+            total += weights[k];
+        }
+        for (auto w : weights)
+        {
+            taps.weights.push_back(static_cast<float>(w / total));
+        }
+        return taps;
+    }
+
+    filter_taps const &taps_for(filter f)
+    {
+        static filter_taps const box{0, {0.5f, 0.5f}};
+        static filter_taps const kaiser = make_kaiser_taps();
+        return f == filter::kaiser ? kaiser : box;
+    }
+
+    // ---------------------- scalar kernels ----------------------
+
+    void horizontal_scalar(float const *src, int src_width, float *dst, int dst_width, filter_taps const &taps)
+    {
+        auto tap_count = static_cast<int>(taps.weights.size());
+        for (int x = 0; x < dst_width; ++x)
+        {
+            float acc[4] = {};
+            for (int k = 0; k < tap_count; ++k)
+            {
+                auto sx = std::clamp(2 * x + taps.first + k, 0, src_width - 1);
+                auto w = taps.weights[k];
+                for (int c = 0; c < 4; ++c)
+                {
+                    acc[c] += src[sx * 4 + c] * w;
+                }
+            }
+            std::memcpy(dst + x * 4, acc, sizeof(acc));
+        }
+    }
+
+    void vertical_scalar(float const *const *rows, float const *weights, int tap_count, float *dst, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            float acc = 0.0f;
+            for (int k = 0; k < tap_count; ++k)
+            {
+                acc += rows[k][i] * weights[k];
+            }
+            dst[i] = acc;
+        }
+    }
+
+#if MIPMAP_X86
+    // ---------------------- SSE kernels ----------------------
+
+    void horizontal_sse(float const *src, int src_width, float *dst, int dst_width, filter_taps const &taps)
+    {
+        auto tap_count = static_cast<int>(taps.weights.size());
+        for (int x = 0; x < dst_width; ++x)
+        {
+            auto acc = _mm_setzero_ps();
+            for (int k = 0; k < tap_count; ++k)
+            {
+                auto sx = std::clamp(2 * x + taps.first + k, 0, src_width - 1);
+                acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(src + sx * 4), _mm_set1_ps(taps.weights[k])));
+            }
+            _mm_storeu_ps(dst + x * 4, acc);
+        }
+    }
+
+    void vertical_sse(float const *const *rows, float const *weights, int tap_count, float *dst, size_t count)
+    {
+        // count is always a multiple of 4 (RGBA pixels)
+        for (size_t i = 0; i < count; i += 4)
+        {
+            auto acc = _mm_setzero_ps();
+            for (int k = 0; k < tap_count; ++k)
+            {
+                acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(rows[k] + i), _mm_set1_ps(weights[k])));
+            }
+            _mm_storeu_ps(dst + i, acc);
+        }
+    }
+
+    // ---------------------- AVX2 kernels ----------------------
+
+    // two output pixels per iteration, each 128-bit lane holds one RGBA pixel
+    MIPMAP_TARGET_AVX2 void horizontal_avx2(float const *src, int src_width, float *dst, int dst_width, filter_taps const &taps)
+    {
+        auto tap_count = static_cast<int>(taps.weights.size());
+        int x = 0;
+        for (; x + 2 <= dst_width; x += 2)
+        {
+            auto acc = _mm256_setzero_ps();
+            for (int k = 0; k < tap_count; ++k)
+            {
+                auto sx0 = std::clamp(2 * x + taps.first + k, 0, src_width - 1);
+                auto sx1 = std::clamp(2 * x + 2 + taps.first + k, 0, src_width - 1);
+                auto p = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(src + sx0 * 4)), _mm_loadu_ps(src + sx1 * 4), 1);
+                acc = _mm256_fmadd_ps(p, _mm256_set1_ps(taps.weights[k]), acc);
+            }
+            _mm256_storeu_ps(dst + x * 4, acc);
+        }
+        if (x < dst_width)
+        {
+            auto acc = _mm_setzero_ps();
+            for (int k = 0; k < tap_count; ++k)
+            {
+                auto sx = std::clamp(2 * x + taps.first + k, 0, src_width - 1);
+                acc = _mm_fmadd_ps(_mm_loadu_ps(src + sx * 4), _mm_set1_ps(taps.weights[k]), acc);
+            }
+            _mm_storeu_ps(dst + x * 4, acc);
+        }
+    }
+
+    MIPMAP_TARGET_AVX2 void vertical_avx2(float const *const *rows, float const *weights, int tap_count, float *dst, size_t count)
+    {
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            auto acc = _mm256_setzero_ps();
+            for (int k = 0; k < tap_count; ++k)
+            {
+                acc = _mm256_fmadd_ps(_mm256_loadu_ps(rows[k] + i), _mm256_set1_ps(weights[k]), acc);
+            }
+            _mm256_storeu_ps(dst + i, acc);
+        }
+        if (i < count)
+        {
+            auto acc = _mm_setzero_ps();
+            for (int k = 0; k < tap_count; ++k)
+            {
+                acc = _mm_fmadd_ps(_mm_loadu_ps(rows[k] + i), _mm_set1_ps(weights[k]), acc);
+            }
+            _mm_storeu_ps(dst + i, acc);
+        }
+    }
+
+#endif
+
+    kernel_set kernels_for(instruction_set isa)
+    {
+        isa = std::min(isa, mipmap::detected_instruction_set());
+#if MIPMAP_X86
+        if (isa == instruction_set::avx2)
+        {
+            return {horizontal_avx2, vertical_avx2};
+        }
+        if (isa == instruction_set::sse)
+        {
+            return {horizontal_sse, vertical_sse};
+        }
+#endif
+        return {horizontal_scalar, vertical_scalar};
+    }
+
+    // ---------------------- conversions ----------------------
+
+    bool is_color_channel(int channel, int channels, bool srgb) noexcept
+    {
+        return srgb && channels >= 3 && channel < 3;
+    }
+
+    // Row y of bmp as RGBA floats, dst holds bmp.width() * 4 floats
+    void to_float_row(bitmap const &bmp, int y, bool srgb, float *dst)
+    {
+        auto channels = static_cast<int>(bmp.channels());
+        auto pixel_count = static_cast<size_t>(bmp.width());
+        auto first = static_cast<size_t>(y) * pixel_count * channels;
+        std::fill(dst, dst + pixel_count * 4, 0.0f);
+        switch (bmp.internal_format())
+        {
+        case bitmap_internal_format::u8:
+        {
+            auto &to_linear = srgb_to_linear_lut();
+            auto src = reinterpret_cast<uint8_t const *>(bmp.pixels()) + first;
+            for (size_t i = 0; i < pixel_count; ++i)
+            {
+                for (int c = 0; c < channels; ++c)
+                {
+                    auto v = src[i * channels + c];
+                    dst[i * 4 + c] = is_color_channel(c, channels, srgb) ? to_linear[v] : v / 255.0f;
+                }
+            }
+            break;
+        }
+        case bitmap_internal_format::u16:
+        {
+            auto src = reinterpret_cast<uint16_t const *>(bmp.pixels()) + first;
+            for (size_t i = 0; i < pixel_count; ++i)
+            {
+                for (int c = 0; c < channels; ++c)
+                {
+                    dst[i * 4 + c] = src[i * channels + c] / 65535.0f;
+                }
+            }
+            break;
+        }
+        case bitmap_internal_format::f32:
+        {
+            auto src = reinterpret_cast<float const *>(bmp.pixels()) + first;
+            for (size_t i = 0; i < pixel_count; ++i)
+            {
+                std::memcpy(dst + i * 4, src + i * channels, channels * sizeof(float));
+            }
+            break;
+        }
+        case bitmap_internal_format::f16:
+        {
+            auto src = reinterpret_cast<uint16_t const *>(bmp.pixels()) + first;
+            if (channels == 4)
+            {
+                utils::halves_to_floats(src, dst, pixel_count * 4);
+                break;
+            }
+            for (size_t i = 0; i < pixel_count; ++i)
+            {
+                utils::halves_to_floats(src + i * channels, dst + i * 4, channels);
+            }
+            break;
+        }
+        }
+    }
+
+    bitmap from_float(float_image const &image, bitmap_channel channel_layout, bitmap_internal_format internal_format, bool srgb)
+    {
+        auto channels = static_cast<int>(channel_layout);
+        auto pixel_count = static_cast<size_t>(image.width) * image.height;
+        auto bmp = bitmap::allocate(image.width, image.height, channel_layout, internal_format);
+        auto src = image.pixels.data();
+        switch (internal_format)
+        {
+        case bitmap_internal_format::u8:
+        {
+            auto &to_srgb = linear_to_srgb_lut();
+            auto dst = reinterpret_cast<uint8_t *>(bmp.pixels());
+            for (size_t i = 0; i < pixel_count; ++i)
+            {
+                for (int c = 0; c < channels; ++c)
+                {
+                    auto v = std::clamp(src[i * 4 + c], 0.0f, 1.0f);
+                    dst[i * channels + c] = is_color_channel(c, channels, srgb)
+                                                ? to_srgb[static_cast<int>(v * (linear_lut_size - 1) + 0.5f)]
+                                                : static_cast<uint8_t>(v * 255.0f + 0.5f);
+                }
+            }
+            break;
+        }
+        case bitmap_internal_format::u16:
+        {
+            auto dst = reinterpret_cast<uint16_t *>(bmp.pixels());
+            for (size_t i = 0; i < pixel_count; ++i)
+            {
+                for (int c = 0; c < channels; ++c)
+                {
+                    dst[i * channels + c] = static_cast<uint16_t>(std::clamp(src[i * 4 + c], 0.0f, 1.0f) * 65535.0f + 0.5f);
+                }
+            }
+            break;
+        }
+        case bitmap_internal_format::f32:
+        {
+            auto dst = reinterpret_cast<float *>(bmp.pixels());
+            for (size_t i = 0; i < pixel_count; ++i)
+            {
+                std::memcpy(dst + i * channels, src + i * 4, channels * sizeof(float));
+            }
+            break;
+        }
+        case bitmap_internal_format::f16:
+        {
+            auto dst = reinterpret_cast<uint16_t *>(bmp.pixels());
+            if (channels == 4)
+            {
+                utils::floats_to_halves(src, dst, pixel_count * 4);
+                break;
+            }
+            for (size_t i = 0; i < pixel_count; ++i)
+            {
+                utils::floats_to_halves(src + i * 4, dst + i * channels, channels);
+            }
+            break;
+        }
+        }
+        return bmp;
+    }
+
+    // Halves a src_width x src_height image whose row y (RGBA floats) is returned by row(y). Rows are requested in
+    // increasing order, each one at most once, and only have to stay valid until the next call.
+    template <typename RowSource>
+    float_image downsample(int src_width, int src_height, RowSource &&row, filter_taps const &taps, kernel_set const &kernels)
+    {
+        auto width = std::max(src_width / 2, 1);
+        auto height = std::max(src_height / 2, 1);
+        auto row_floats = static_cast<size_t>(width) * 4;
+        auto tap_count = static_cast<int>(taps.weights.size());
+
+        // the taps of one output row are tap_count consecutive source rows, so row sy can live in slot sy % tap_count
+        std::vector<float> ring(row_floats * tap_count);
+        std::vector<int> ring_rows(tap_count, -1);
+        auto filtered_row = [&](int sy)
+        {
+            auto slot = sy % tap_count;
+            auto dst = ring.data() + slot * row_floats;
+            if (ring_rows[slot] != sy)
+            {
+                kernels.horizontal(row(sy), src_width, dst, width, taps);
+                ring_rows[slot] = sy;
+            }
+            return static_cast<float const *>(dst);
+        };
+
+        float_image dst{width, height, std::vector<float>(row_floats * height)};
+        std::array<float const *, 8> rows;
+        for (int y = 0; y < height; ++y)
+        {
+            for (int k = 0; k < tap_count; ++k)
+            {
+                rows[k] = filtered_row(std::clamp(2 * y + taps.first + k, 0, src_height - 1));
+            }
+            kernels.vertical(rows.data(), taps.weights.data(), tap_count, dst.pixels.data() + y * row_floats, row_floats);
+        }
+        return dst;
+    }
+
+    float_image downsample(bitmap const &src, bool srgb, filter_taps const &taps, kernel_set const &kernels)
+    {
+        std::vector<float> scratch(static_cast<size_t>(src.width()) * 4);
+        return downsample(src.width(), src.height(), [&](int y)
+        {
+            to_float_row(src, y, srgb, scratch.data());
+            return static_cast<float const *>(scratch.data());
+        }, taps, kernels);
+    }
+
+    float_image downsample(float_image const &src, filter_taps const &taps, kernel_set const &kernels)
+    {
+        auto row_floats = static_cast<size_t>(src.width) * 4;
+        return downsample(src.width, src.height, [&](int y) { return src.pixels.data() + y * row_floats; }, taps, kernels);
+    }
+}
+
+namespace mipmap
+{
+    instruction_set detected_instruction_set() noexcept
+    {
+#if MIPMAP_X86
+        auto &features = utils::detect_cpu_features();
+        static auto const isa = features.avx2 && features.fma ? instruction_set::avx2 : instruction_set::sse;
+        return isa;
+#else
+        return instruction_set::scalar;
+#endif
+    }
+
+    int level_count(int width, int height) noexcept
+    {
+        int levels = 1;
+        for (auto size = std::max(width, height); size > 1; size /= 2)
+        {
+            ++levels;
+        }
+        return levels;
+    }
+
+    std::vector<bitmap> build_chain(bitmap const &source, bool srgb, filter f, instruction_set isa)
+    {
+        auto &taps = taps_for(f);
+        auto kernels = kernels_for(isa);
+
+        std::vector<bitmap> levels;
+        auto count = level_count(source.width(), source.height());
+        levels.reserve(count - 1);
+        if (count < 2)
+        {
+            return levels;
+        }
+        auto image = downsample(source, srgb, taps, kernels);
+        levels.push_back(from_float(image, source.channels(), source.internal_format(), srgb));
+        for (int level = 2; level < count; ++level)
+        {
+            image = downsample(image, taps, kernels);
+            levels.push_back(from_float(image, source.channels(), source.internal_format(), srgb));
+        }
+        return levels;
+    }
+}
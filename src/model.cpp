@@ -2,14 +2,29 @@
 #include <vector>
 #include <format>
 #include <cmath>
+#include <optional>
+#include <algorithm>
+#include <span>
+#include <type_traits>
+#include <variant>
+#include <iostream>
 
 #include "assimp/Importer.hpp"
 #include "assimp/scene.h"
 #include "assimp/postprocess.h"
 
 #include "glwrap.hpp"
+#include "half.hpp"
 #include "utils.hpp"
+#include "parallel.hpp"
 #include "model.hpp"
+#include "mapped_file.hpp"
+#include "mesh_cache.hpp"
+#include "mesh_optimizer.hpp"
+#include "mesh_simplifier.hpp"
+#include "mikktspace.hpp"
+#include "mipmap.hpp"
+#include "texture_cache.hpp"
 
 namespace glwrap
 {
@@ -23,31 +38,86 @@ namespace glwrap
         return {vec.x, vec.y, vec.z};
     }
 
+    // aiMatrix4x4 is row-major
+    inline glm::mat4 to_mat4(aiMatrix4x4 const &m)
+    {
+        return {glm::vec4{m.a1, m.b1, m.c1, m.d1}, glm::vec4{m.a2, m.b2, m.c2, m.d2}, glm::vec4{m.a3, m.b3, m.c3, m.d3}, glm::vec4{m.a4, m.b4, m.c4, m.d4}};
+    }
+
+    compact_vertex compact_vertex::pack(vertex const &v) noexcept
+    {
+        auto to_half = [](float f) { return half{utils::float_to_half(f)}; };
+        // handedness of the tangent frame, so the bitangent can be rebuilt from normal and tangent
+        auto sign = glm::dot(glm::cross(v.normal, v.tangent), v.bitangent) < 0.0f ? -1.0f : 1.0f;
+        return {
+            .position = {{to_half(v.position.x), to_half(v.position.y), to_half(v.position.z), to_half(1.0f)}},
+            .normal = snorm_2_10_10_10::pack(glm::vec4(v.normal, 0.0f)),
+            .texcoords = {{to_half(v.texcoords.x), to_half(v.texcoords.y)}},
+            .tangent = snorm_2_10_10_10::pack(glm::vec4(v.tangent, sign)),
+        };
+    }
+
+    // GPU buffers of one mesh, or of all meshes of a model loaded with load_flags::shared_arena.
+    // Indices are relative to the base vertex of their mesh, so they only have to fit the largest mesh.
+    // Both are ranges of the shared buffer_allocator blocks rather than buffer objects of their own.
+    struct mesh_storage final
+    {
+        mesh_storage(std::span<compact_vertex const> vertices, std::span<uint32_t const> indices, size_t max_mesh_vertices)
+            : vbuffer(vertices.data(), vertices.size(), buffer_allocator::instance()),
+              ibuffer(any_index_buffer::narrowest(indices, max_mesh_vertices, buffer_allocator::instance())),
+              varray(auto_vertex_array(ibuffer, vbuffer))
+        {
+        }
+
+        vertex_buffer<compact_vertex> vbuffer;
+        any_index_buffer ibuffer;
+        vertex_array varray;
+    };
+
     struct mesh::mesh_impl final
     {
         mesh_impl(
             std::string name,
-            std::vector<vertex> const &vertices,
-            std::vector<uint32_t> const &indices)
+            std::shared_ptr<mesh_storage> storage,
+            draw_range range,
+            std::span<meshlets::meshlet const> meshlets,
+            std::span<mesh_lod const> lods,
+            glwrap::bounds const &bounds,
+            uint32_t node)
             : name(std::move(name)),
-              vbuffer(vertices),
-              ibuffer(indices),
-              varray(auto_vertex_array(ibuffer, vbuffer)),
+              storage(std::move(storage)),
+              range(range),
+              meshlets(meshlets.begin(), meshlets.end()),
+              lods(lods.begin(), lods.end()),
+              bounds(bounds),
+              node(node),
               parent(nullptr)
         {
+            if (!meshlets.empty())
+            {
+                meshlet_buffer.emplace(meshlets.data(), meshlets.size());
+            }
+            if (this->lods.empty())
+            {
+                this->lods.push_back({0, range.index_count, 0.0f});
+            }
         }
 
-        void add_textures(texture_type tex_type, std::vector<uint32_t> const & indices)
+        void add_textures(std::span<std::pair<texture_type, uint32_t> const> bindings)
         {
-            for (auto i : indices) {
+            for (auto [tex_type, i] : bindings) {
                 textures.emplace(tex_type, i);
             }
         }
 
         std::string name;
-        vertex_buffer<vertex> vbuffer;
-        index_buffer<uint32_t> ibuffer;
-        vertex_array varray;
+        std::shared_ptr<mesh_storage> storage;
+        draw_range range;
+        std::vector<meshlets::meshlet> meshlets;
+        std::optional<buffer<meshlets::meshlet>> meshlet_buffer;
+        std::vector<mesh_lod> lods;
+        glwrap::bounds bounds;
+        uint32_t node;
 
         std::map<texture_type, uint32_t> textures;
 
@@ -74,98 +144,443 @@ namespace glwrap
         return *this;
     }
 
-    vertex_buffer<vertex> & mesh::get_vbuffer() noexcept
+    vertex_buffer<compact_vertex> & mesh::get_vbuffer() noexcept
     {
-        return impl_->vbuffer;
+        return impl_->storage->vbuffer;
     }
 
-    index_buffer<uint32_t> & mesh::get_ibuffer() noexcept
+    any_index_buffer & mesh::get_ibuffer() noexcept
     {
-        return impl_->ibuffer;
+        return impl_->storage->ibuffer;
     }
 
     vertex_array & mesh::get_varray() noexcept
     {
-        return impl_->varray;
+        return impl_->storage->varray;
+    }
+
+    draw_range mesh::get_range() const noexcept
+    {
+        return impl_->range;
+    }
+
+    draw_elements_indirect_command mesh::draw_command(GLuint instance_count, GLuint base_instance) const noexcept
+    {
+        auto &range = impl_->range;
+        return {
+            .count = range.index_count,
+            .instance_count = instance_count,
+            .first_index = static_cast<GLuint>(impl_->storage->varray.index_offset()) + range.first_index,
+            .base_vertex = range.base_vertex,
+            .base_instance = base_instance,
+        };
+    }
+
+    void mesh::draw(draw_mode mode)
+    {
+        impl_->storage->varray.draw_base_vertex(mode, static_cast<GLint>(impl_->range.first_index), static_cast<GLsizei>(impl_->range.index_count),
+                                                impl_->range.base_vertex);
+    }
+
+    std::span<meshlets::meshlet const> mesh::get_meshlets() const noexcept
+    {
+        return impl_->meshlets;
+    }
+
+    buffer<meshlets::meshlet> & mesh::get_meshlet_buffer()
+    {
+        if (!impl_->meshlet_buffer.has_value())
+        {
+            throw std::runtime_error(std::format("Mesh {} has no meshlets", impl_->name));
+        }
+        return impl_->meshlet_buffer.value();
+    }
+
+    std::span<mesh_lod const> mesh::get_lods() const noexcept
+    {
+        return impl_->lods;
+    }
+
+    bounds const &mesh::bounds() const noexcept
+    {
+        return impl_->bounds;
+    }
+
+    uint32_t mesh::node() const noexcept
+    {
+        return impl_->node;
     }
 
     struct model::model_impl final
     {
+        struct texture_source
+        {
+            std::string name;
+            aiTexture const *embedded;
+            // decides sRGB and the block compression format
+            texture_type role;
+
+            bool srgb() const noexcept { return role == texture_type::diffuse; }
+
+            bcn::texture_usage usage() const noexcept
+            {
+                return role == texture_type::diffuse  ? bcn::texture_usage::color
+                       : role == texture_type::normal ? bcn::texture_usage::normal_map
+                                                      : bcn::texture_usage::data;
+            }
+        };
+
+        struct imported_mesh
+        {
+            std::string name;
+            std::vector<vertex> vertices;
+            std::vector<uint32_t> indices;
+            std::vector<std::pair<texture_type, uint32_t>> textures;
+            aiMesh const *source;
+            uint32_t node;
+            // faces may be points or lines, so the index count is summed up front to size indices
+            size_t index_count;
+            // filled once all processing on vertices is done
+            std::vector<compact_vertex> packed;
+            std::vector<meshlets::meshlet> meshlets;
+            std::vector<mesh_lod> lods;
+            glwrap::bounds bounds;
+        };
+
+        // tangents are generated by mikkt::generate_tangents instead of aiProcess_CalcTangentSpace.
+        // aiProcess_Triangulate keeps point and line faces, aiProcess_SortByPType moves them into meshes of their own.
+        static constexpr unsigned import_flags = aiProcess_Triangulate | aiProcess_SortByPType | aiProcess_FlipUVs;
+
         std::filesystem::path directory_;
         std::vector<mesh> meshes_;
-        std::vector<texture2d> textures_;
+        std::vector<std::shared_ptr<texture2d>> textures_;
         std::map<std::string, uint32_t> texture_map_;
-
-        void load_file(std::filesystem::path const &path, texture_type tex_types)
+        std::vector<texture_source> texture_sources_;
+        std::vector<imported_mesh> imported_meshes_;
+        glwrap::bounds bounds_;
+        transform_graph nodes_;
+
+        // only with load_flags::shared_arena, the ranges of all meshes for one multi-draw
+        std::shared_ptr<mesh_storage> arena_;
+        std::vector<GLsizei> arena_counts_;
+        std::vector<GLint> arena_first_indices_;
+        std::vector<GLint> arena_base_vertices_;
+
+        void load_file(std::filesystem::path const &path, texture_type tex_types, load_flags flags)
         {
+            directory_ = path.parent_path();
+
+            std::optional<mesh_cache::cache_key> cache_key;
+            if ((flags & load_flags::mesh_cache) != load_flags::none)
+            {
+                auto source = mapped_file{path};
+                cache_key = mesh_cache::cache_key{
+                    .source_hash = mesh_cache::hash_sources(path, source.bytes()),
+                    .import_flags = import_flags,
+                    .texture_types = static_cast<uint32_t>(tex_types),
+                    .mesh_flags = static_cast<uint32_t>(flags & (load_flags::optimize_meshes | load_flags::meshlets | load_flags::lods)),
+                };
+                if (auto cache = mesh_cache::cache_view::open(mesh_cache::cache_path_for(path), cache_key.value()))
+                {
+                    load_cache(cache.value(), flags);
+                    load_textures(flags);
+                    return;
+                }
+            }
+
+            utils::stage_timer timer;
             Assimp::Importer importer;
-            auto ai_scene = importer.ReadFile(path.string(), aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+            auto ai_scene = importer.ReadFile(path.string(), import_flags);
             if (!ai_scene || ai_scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !ai_scene->mRootNode)
             {
                 throw std::invalid_argument(std::string("Load model failed: ") + importer.GetErrorString());
             }
-            directory_ = path.parent_path();
-            import_node(ai_scene->mRootNode, ai_scene, tex_types);
+            timer.lap("assimp");
+
+            // texture registration touches shared maps, so the walk stays serial and only records what to convert
+            collect_nodes(ai_scene, tex_types);
+            nodes_.update();
+            timer.lap("collect");
+
+            // meshes are independent from here on, GL objects are created on this thread afterwards
+            auto workers = (flags & load_flags::parallel_meshes) != load_flags::none ? utils::worker_count() : 1;
+            utils::parallel_for(imported_meshes_.size(), [this](size_t i) { convert_mesh(imported_meshes_[i]); }, workers);
+            timer.lap("convert");
+
+            // welding needs the whole mesh, so meshes go one after another and spread their triangles over the workers
+            for (auto &imported : imported_meshes_)
+            {
+                mikkt::generate_tangents(imported.vertices, imported.indices, workers);
+            }
+            timer.lap("tangents");
+
+            std::vector<mesh_optimizer::report> reports(imported_meshes_.size());
+            utils::parallel_for(imported_meshes_.size(), [this, flags, &reports](size_t i) { reports[i] = process_mesh(imported_meshes_[i], flags); }, workers);
+            if ((flags & load_flags::optimize_meshes) != load_flags::none)
+            {
+                mesh_optimizer::report total{};
+                for (auto &report : reports)
+                {
+                    total.before += report.before;
+                    total.after += report.after;
+                }
+                std::cout << std::format("Optimized meshes of {}: {} -> {}", path.string(), total.before, total.after) << std::endl;
+            }
+            timer.lap("process");
+
+            std::vector<mesh_cache::mesh_entry> entries;
+            entries.reserve(imported_meshes_.size());
+            for (auto &imported : imported_meshes_)
+            {
+                entries.push_back({imported.name, imported.node, imported.packed, imported.indices, imported.meshlets, imported.lods, imported.bounds, imported.textures});
+            }
+            add_meshes(entries, flags);
+            timer.lap("upload");
+            if (cache_key.has_value())
+            {
+                write_cache(mesh_cache::cache_path_for(path), cache_key.value(), entries);
+                timer.lap("cache");
+            }
+            imported_meshes_.clear();
+
+            // embedded textures point into the scene, so decode them before the importer goes away
+            load_textures(flags);
+            timer.lap("textures");
+            std::cout << std::format("Imported {}: {}", path.string(), timer.report()) << std::endl;
         }
 
-        void import_node(aiNode const *ai_node, aiScene const *ai_scene, texture_type tex_types)
+        static mesh_optimizer::report process_mesh(imported_mesh &imported, load_flags flags)
         {
-            for (auto mesh_index : utils::ptr_range(ai_node->mMeshes, ai_node->mNumMeshes))
+            mesh_optimizer::report report{};
+            if ((flags & load_flags::optimize_meshes) != load_flags::none)
+            {
+                report = mesh_optimizer::optimize(imported.vertices, imported.indices);
+            }
+            if ((flags & load_flags::meshlets) != load_flags::none)
             {
-                import_mesh(ai_scene->mMeshes[mesh_index], ai_scene, tex_types);
+                imported.meshlets = meshlets::build(imported.vertices, imported.indices);
             }
-            for (auto *child : utils::ptr_range(ai_node->mChildren, ai_node->mNumChildren))
+            if ((flags & load_flags::lods) != load_flags::none)
             {
-                import_node(child, ai_scene, tex_types);
+                imported.lods = mesh_simplifier::build_lods(imported.vertices, imported.indices);
             }
+            auto positions = imported.vertices.empty() ? nullptr : &imported.vertices[0].position.x;
+            imported.bounds = bounds::compute(positions, imported.vertices.size(), sizeof(vertex));
+            imported.packed.resize(imported.vertices.size());
+            std::ranges::transform(imported.vertices, imported.packed.begin(), compact_vertex::pack);
+            return report;
         }
 
-        void import_mesh(aiMesh const *ai_mesh, aiScene const *ai_scene, texture_type tex_types)
+        static uint32_t full_index_count(mesh_cache::mesh_entry const &entry) noexcept
         {
-            std::vector<vertex> vertices;
+            return entry.lods.empty() ? static_cast<uint32_t>(entry.indices.size()) : entry.lods[0].index_count;
+        }
+
+        void add_mesh(mesh_cache::mesh_entry const &entry, std::shared_ptr<mesh_storage> storage, draw_range range)
+        {
+            meshes_.push_back(create_mesh());
+            auto &mesh = meshes_.back();
+            mesh.impl_ = std::make_unique<mesh::mesh_impl>(entry.name, std::move(storage), range, entry.meshlets, entry.lods, entry.bounds, entry.node);
+            bounds_ = bounds_.merge(entry.bounds.transform(nodes_.world(entry.node)));
+            mesh.impl_->add_textures(entry.textures);
+        }
+
+        void add_meshes(std::span<mesh_cache::mesh_entry const> entries, load_flags flags)
+        {
+            if ((flags & load_flags::shared_arena) == load_flags::none)
+            {
+                for (auto &entry : entries)
+                {
+                    auto storage = std::make_shared<mesh_storage>(entry.vertices, entry.indices, entry.vertices.size());
+                    storage->varray.set_index_count(static_cast<GLsizei>(full_index_count(entry)));
+                    add_mesh(entry, std::move(storage), {0, full_index_count(entry), 0});
+                }
+                return;
+            }
+
+            std::vector<compact_vertex> vertices;
             std::vector<uint32_t> indices;
+            std::vector<draw_range> ranges;
+            size_t max_mesh_vertices = 0;
+            size_t vertex_count = 0;
+            size_t index_count = 0;
+            for (auto &entry : entries)
+            {
+                vertex_count += entry.vertices.size();
+                index_count += entry.indices.size();
+            }
+            vertices.reserve(vertex_count);
+            indices.reserve(index_count);
+            for (auto &entry : entries)
+            {
+                ranges.push_back({static_cast<uint32_t>(indices.size()), full_index_count(entry), static_cast<int32_t>(vertices.size())});
+                vertices.insert(vertices.end(), entry.vertices.begin(), entry.vertices.end());
+                indices.insert(indices.end(), entry.indices.begin(), entry.indices.end());
+                max_mesh_vertices = std::max(max_mesh_vertices, entry.vertices.size());
+            }
+
+            arena_ = std::make_shared<mesh_storage>(vertices, indices, max_mesh_vertices);
+            for (size_t i = 0; i < entries.size(); ++i)
+            {
+                add_mesh(entries[i], arena_, ranges[i]);
+                arena_counts_.push_back(static_cast<GLsizei>(ranges[i].index_count));
+                arena_first_indices_.push_back(static_cast<GLint>(ranges[i].first_index));
+                arena_base_vertices_.push_back(ranges[i].base_vertex);
+            }
+        }
+
+        void load_cache(mesh_cache::cache_view const &cache, load_flags flags)
+        {
+            for (auto &texture : cache.textures())
+            {
+                texture_sources_.push_back({texture.name, nullptr, texture.role});
+            }
+            for (auto &node : cache.nodes())
+            {
+                nodes_.add_node(node.name, node.parent, node.local);
+            }
+            nodes_.update();
+            add_meshes(cache.meshes(), flags);
+        }
 
-            for (auto i : utils::range(ai_mesh->mNumVertices))
+        void write_cache(std::filesystem::path const &cache_path, mesh_cache::cache_key const &key, std::span<mesh_cache::mesh_entry const> meshes)
+        {
+            if (std::ranges::any_of(texture_sources_, [](auto &source) { return source.embedded != nullptr; }))
             {
-                auto position = to_vec3(ai_mesh->mVertices[i]);
-                auto normal = to_vec3(ai_mesh->mNormals[i]);
-                auto texcoords = ai_mesh->mTextureCoords[0]
-                                     ? to_vec3(ai_mesh->mTextureCoords[0][i])
-                                     : glm::vec2(0.0f, 0.0f);
+                std::cout << std::format("Model has embedded textures, skip writing mesh cache {}", cache_path.string()) << std::endl;
+                return;
+            }
 
-                auto tangent = to_vec3(ai_mesh->mTangents[i]);
-                auto bitangent = to_vec3(ai_mesh->mBitangents[i]);
+            std::vector<mesh_cache::texture_entry> textures;
+            for (auto &source : texture_sources_)
+            {
+                textures.push_back({source.name, source.role});
+            }
+            std::vector<mesh_cache::node_entry> nodes;
+            for (uint32_t i = 0; i < nodes_.size(); ++i)
+            {
+                nodes.push_back({nodes_.name(i), nodes_.parent(i), nodes_.local(i)});
+            }
+            try
+            {
+                mesh_cache::write(cache_path, key, textures, nodes, meshes);
+            }
+            catch (std::exception const &e)
+            {
+                // the cache is an optimization only
+                std::cout << e.what() << std::endl;
+            }
+        }
 
-                vertices.push_back({position, normal, texcoords, tangent, bitangent});
+        // Breadth-first, the order transform_graph keeps its nodes in. Every mesh reference of a node becomes a mesh instance.
+        void collect_nodes(aiScene const *ai_scene, texture_type tex_types)
+        {
+            std::vector<std::pair<aiNode const *, uint32_t>> queue{{ai_scene->mRootNode, transform_graph::no_parent}};
+            for (size_t i = 0; i < queue.size(); ++i)
+            {
+                auto [ai_node, parent] = queue[i];
+                auto node = nodes_.add_node(ai_node->mName.C_Str(), parent, to_mat4(ai_node->mTransformation));
+                for (auto mesh_index : utils::ptr_range(ai_node->mMeshes, ai_node->mNumMeshes))
+                {
+                    collect_mesh(ai_scene->mMeshes[mesh_index], ai_scene, tex_types, node);
+                }
+                for (auto *child : utils::ptr_range(ai_node->mChildren, ai_node->mNumChildren))
+                {
+                    queue.emplace_back(child, node);
+                }
             }
+        }
+
+        void collect_mesh(aiMesh const *ai_mesh, aiScene const *ai_scene, texture_type tex_types, uint32_t node)
+        {
+            // only triangles are drawn, every later stage expects whole triangles
+            size_t index_count = 0;
             for (auto &&face : utils::ptr_range(ai_mesh->mFaces, ai_mesh->mNumFaces))
             {
-                std::copy(face.mIndices, face.mIndices + face.mNumIndices, std::back_inserter(indices));
+                if (face.mNumIndices == 3)
+                {
+                    index_count += 3;
+                }
+            }
+            if (index_count == 0)
+            {
+                return;
             }
 
             auto ai_material = ai_scene->mMaterials[ai_mesh->mMaterialIndex];
 
-            meshes_.push_back(create_mesh());
-            auto &mesh = meshes_.back();
-            mesh.impl_ = std::make_unique<mesh::mesh_impl>(ai_mesh->mName.C_Str(), std::move(vertices), std::move(indices));
+            std::vector<std::pair<texture_type, uint32_t>> textures;
+            auto add_textures = [&textures](texture_type tex_type, std::vector<uint32_t> const &indices)
+            {
+                for (auto i : indices)
+                {
+                    textures.emplace_back(tex_type, i);
+                }
+            };
             if ((tex_types & texture_type::diffuse) != texture_type::none)
             {
-                mesh.impl_->add_textures(texture_type::diffuse, load_textures(ai_material, aiTextureType_DIFFUSE, texture_type::diffuse, ai_scene));
+                add_textures(texture_type::diffuse, register_textures(ai_material, aiTextureType_DIFFUSE, texture_type::diffuse, ai_scene));
             }
             if ((tex_types & texture_type::specular) != texture_type::none)
             {
-                mesh.impl_->add_textures(texture_type::specular, load_textures(ai_material, aiTextureType_SPECULAR, texture_type::specular, ai_scene));
+                add_textures(texture_type::specular, register_textures(ai_material, aiTextureType_SPECULAR, texture_type::specular, ai_scene));
             }
             if ((tex_types & texture_type::normal) != texture_type::none)
             {
-                mesh.impl_->add_textures(texture_type::normal, load_textures(ai_material, aiTextureType_HEIGHT, texture_type::normal, ai_scene));
+                add_textures(texture_type::normal, register_textures(ai_material, aiTextureType_HEIGHT, texture_type::normal, ai_scene));
             }
             if ((tex_types & texture_type::height) != texture_type::none) {
-                mesh.impl_->add_textures(texture_type::height, load_textures(ai_material, aiTextureType_AMBIENT, texture_type::diffuse, ai_scene));
+                add_textures(texture_type::height, register_textures(ai_material, aiTextureType_AMBIENT, texture_type::diffuse, ai_scene));
+            }
+
+            imported_meshes_.push_back({ai_mesh->mName.C_Str(), {}, {}, std::move(textures), ai_mesh, node, index_count, {}, {}, {}, {}});
+        }
+
+        // One loop per attribute over the packed aiVector3D array, which the compiler can vectorize,
+        // instead of gathering all attributes of a vertex at a time.
+        template <typename T>
+        static void copy_attribute(aiVector3D const *source, std::span<vertex> vertices, T vertex::*attribute)
+        {
+            // a missing attribute stays zero
+            if (source == nullptr)
+            {
+                return;
+            }
+            for (size_t i = 0; i < vertices.size(); ++i)
+            {
+                if constexpr (std::is_same_v<T, glm::vec2>)
+                {
+                    vertices[i].*attribute = glm::vec2(source[i].x, source[i].y);
+                }
+                else
+                {
+                    vertices[i].*attribute = glm::vec3(source[i].x, source[i].y, source[i].z);
+                }
             }
         }
 
-        std::vector<uint32_t> load_textures(aiMaterial *ai_material, aiTextureType ai_tex_type, texture_type tex_type, aiScene const *ai_scene)
+        // Runs on worker threads, only reads the scene and writes to imported.
+        static void convert_mesh(imported_mesh &imported)
+        {
+            auto ai_mesh = imported.source;
+            imported.vertices.resize(ai_mesh->mNumVertices);
+            copy_attribute(ai_mesh->mVertices, imported.vertices, &vertex::position);
+            copy_attribute(ai_mesh->mNormals, imported.vertices, &vertex::normal);
+            copy_attribute(ai_mesh->mTextureCoords[0], imported.vertices, &vertex::texcoords);
+
+            imported.indices.resize(imported.index_count);
+            auto out = imported.indices.begin();
+            for (auto &&face : utils::ptr_range(ai_mesh->mFaces, ai_mesh->mNumFaces))
+            {
+                if (face.mNumIndices == 3)
+                {
+                    out = std::copy(face.mIndices, face.mIndices + 3, out);
+                }
+            }
+        }
+
+        // Only assigns texture indices, the images are decoded and uploaded by load_textures() after the whole scene is walked.
+        std::vector<uint32_t> register_textures(aiMaterial *ai_material, aiTextureType ai_tex_type, texture_type tex_type, aiScene const *ai_scene)
         {
             std::vector<uint32_t> result{};
             for (auto i : utils::range(ai_material->GetTextureCount(ai_tex_type)))
@@ -173,32 +588,21 @@ namespace glwrap
                 aiString str;
                 ai_material->GetTexture(ai_tex_type, i, &str);
 
-                // find texture in loaded
+                // find texture in registered
                 std::string path(str.C_Str());
                 auto iter = texture_map_.find(path);
 
                 if (iter == texture_map_.end())
                 {
-                    auto new_index = static_cast<uint32_t>(textures_.size());
+                    auto new_index = static_cast<uint32_t>(texture_sources_.size());
                     texture_map_.emplace(path, new_index);
                     result.push_back(new_index);
-                    if (auto texture = ai_scene->GetEmbeddedTexture(str.C_Str()))
-                    {
-                        if (texture->mHeight != 0)
-                        {
-                            throw std::runtime_error("Cannot load embeded texture");
-                        }
-                        textures_.emplace_back(reinterpret_cast<std::byte*>(texture->pcData), texture->mWidth);
-                    }
-                    else
+                    auto texture = ai_scene->GetEmbeddedTexture(str.C_Str());
+                    if (texture && texture->mHeight != 0)
                     {
-                        if (tex_type == texture_type::diffuse) {
-                            textures_.emplace_back((directory_ / path).string(), true);
-                        }
-                        else {
-                            textures_.emplace_back((directory_ / path).string());
-                        }
+                        throw std::runtime_error("Cannot load embeded texture");
                     }
+                    texture_sources_.push_back({path, texture, tex_type});
                 }
                 else
                 {
@@ -207,6 +611,122 @@ namespace glwrap
             }
             return result;
         }
+
+        // mips are built on the decoding thread, so only the upload is left to the GL thread
+        struct decoded_bitmap
+        {
+            bitmap image;
+            std::vector<bitmap> mips;
+        };
+
+        using decoded_texture = std::variant<decoded_bitmap, texture_container>;
+
+        static decoded_bitmap decode_bitmap(bitmap image, bool srgb)
+        {
+            auto mips = mipmap::build_chain(image, srgb);
+            return {std::move(image), std::move(mips)};
+        }
+
+        decoded_texture decode_texture(texture_source const &source, load_flags flags) const
+        {
+            if (source.embedded)
+            {
+                return decode_bitmap(bitmap::from_memory(reinterpret_cast<std::byte const *>(source.embedded->pcData), source.embedded->mWidth, bitmap_channel::unspecified, true), source.srgb());
+            }
+            if ((flags & load_flags::baked_textures) != load_flags::none)
+            {
+                try
+                {
+                    return texture_container::load_or_bake(directory_ / source.name, {
+                                                                                         .srgb = source.srgb(),
+                                                                                         .flip_vertically = true,
+                                                                                         .compress = (flags & load_flags::compressed_textures) != load_flags::none,
+                                                                                         .usage = source.usage(),
+                                                                                     });
+                }
+                catch (std::exception const &e)
+                {
+                    std::cout << std::format("Cannot bake texture {}, decode it instead: {}", source.name, e.what()) << std::endl;
+                }
+            }
+            return decode_bitmap(bitmap::from_file(directory_ / source.name, bitmap_channel::unspecified, true), source.srgb());
+        }
+
+        static texture2d upload_texture(decoded_texture &decoded, bool srgb, upload_ring &ring)
+        {
+            if (auto container = std::get_if<texture_container>(&decoded))
+            {
+                return texture2d{*container, ring};
+            }
+            auto &[image, mips] = std::get<decoded_bitmap>(decoded);
+            return texture2d{image, mips, ring, srgb};
+        }
+
+        // Textures loaded from files are shared through the texture cache, the key covers every flag that changes the result.
+        std::optional<texture_key> cache_key(texture_source const &source, load_flags flags) const
+        {
+            if (source.embedded)
+            {
+                return std::nullopt;
+            }
+            auto texture_flags = static_cast<uint32_t>(flags & (load_flags::baked_textures | load_flags::compressed_textures));
+            return texture_key{
+                .path = directory_ / source.name,
+                .srgb = source.srgb(),
+                .variant = texture_flags | static_cast<uint32_t>(source.usage()) << 8,
+            };
+        }
+
+        void load_textures(load_flags flags)
+        {
+            auto &cache = texture_cache::instance();
+            std::vector<std::shared_ptr<texture2d>> loaded(texture_sources_.size());
+            std::vector<size_t> missing;
+            for (auto i : utils::range(texture_sources_.size()))
+            {
+                auto key = cache_key(texture_sources_[i], flags);
+                if (key && (loaded[i] = cache.find(*key)))
+                {
+                    continue;
+                }
+                missing.push_back(i);
+            }
+
+            // The ring only has to outlive the submissions, GL keeps its storage until the queued copies are done.
+            // Warm loads find every texture in the cache, so the ring is only mapped when something is uploaded.
+            std::optional<upload_ring> ring;
+            if (!missing.empty())
+            {
+                ring.emplace();
+            }
+            auto store = [&](size_t i, decoded_texture &decoded)
+            {
+                auto &source = texture_sources_[i];
+                auto texture = upload_texture(decoded, source.srgb(), *ring);
+                auto key = cache_key(source, flags);
+                loaded[i] = key ? cache.insert(std::move(*key), std::move(texture)) : std::make_shared<texture2d>(std::move(texture));
+            };
+            if ((flags & load_flags::parallel_textures) != load_flags::none)
+            {
+                utils::parallel_produce(
+                    missing.size(),
+                    [this, flags, &missing](size_t i)
+                    { return decode_texture(texture_sources_[missing[i]], flags); },
+                    [&store, &missing](size_t i, decoded_texture decoded)
+                    { store(missing[i], decoded); });
+            }
+            else
+            {
+                for (auto i : missing)
+                {
+                    auto decoded = decode_texture(texture_sources_[i], flags);
+                    store(i, decoded);
+                }
+            }
+
+            textures_ = std::move(loaded);
+            texture_sources_.clear();
+        }
     };
 
     texture2d &mesh::get_texture(texture_type type)
@@ -223,6 +743,15 @@ namespace glwrap
         return impl_->parent->get_texture(iter->second);
     }
 
+    glm::mat4 const &mesh::transform() const
+    {
+        if (impl_->parent == nullptr)
+        {
+            throw std::runtime_error("Mesh has no parent model");
+        }
+        return impl_->parent->nodes().world(impl_->node);
+    }
+
     model::model() : impl_{std::make_unique<model_impl>()}
     { }
 
@@ -246,10 +775,10 @@ namespace glwrap
 
     model::~model() = default;
 
-    model model::load_file(std::filesystem::path const &path, texture_type tex_types)
+    model model::load_file(std::filesystem::path const &path, texture_type tex_types, load_flags flags)
     {
         auto m = model{};
-        m.impl_->load_file(path, tex_types);
+        m.impl_->load_file(path, tex_types, flags);
         for (auto & mesh : m.impl_->meshes_) {
             mesh.impl_->parent = &m;
         }
@@ -266,8 +795,36 @@ namespace glwrap
         return impl_->meshes_;
     }
 
+    void model::draw(draw_mode mode)
+    {
+        if (!impl_->arena_)
+        {
+            for (auto &mesh : impl_->meshes_)
+            {
+                mesh.draw(mode);
+            }
+            return;
+        }
+        impl_->arena_->varray.multi_draw_base_vertex(mode, impl_->arena_counts_, impl_->arena_first_indices_, impl_->arena_base_vertices_);
+    }
+
+    bounds const &model::bounds() const noexcept
+    {
+        return impl_->bounds_;
+    }
+
+    transform_graph &model::nodes() noexcept
+    {
+        return impl_->nodes_;
+    }
+
+    transform_graph const &model::nodes() const noexcept
+    {
+        return impl_->nodes_;
+    }
+
     texture2d &model::get_texture(uint32_t i)
     {
-        return impl_->textures_.at(i);
+        return *impl_->textures_.at(i);
     }
 }
@@ -0,0 +1,85 @@
+#include <algorithm>
+#include <system_error>
+
+#include "texture_cache.hpp"
+
+namespace glwrap
+{
+    texture_cache &texture_cache::instance()
+    {
+        // only weak references live here, so destruction after the GL context is gone is harmless
+        static texture_cache cache;
+        return cache;
+    }
+
+    void texture_cache::canonicalize(texture_key &key)
+    {
+        std::error_code ec;
+        auto canonical = std::filesystem::weakly_canonical(key.path, ec);
+        if (!ec)
+        {
+            key.path = std::move(canonical);
+        }
+    }
+
+    std::shared_ptr<texture2d> texture_cache::find_locked(texture_key const &key)
+    {
+        auto iter = entries_.find(key);
+        if (iter != entries_.end())
+        {
+            if (auto texture = iter->second.lock())
+            {
+                ++hits_;
+                return texture;
+            }
+            entries_.erase(iter);
+        }
+        ++misses_;
+        return nullptr;
+    }
+
+    std::shared_ptr<texture2d> texture_cache::load(std::filesystem::path const &path, bool srgb, texture2d_elem_type elem_type, texture2d_format format, GLenum wrap_mode)
+    {
+        texture_key key{path, srgb, format, elem_type, wrap_mode};
+        canonicalize(key);
+        std::lock_guard lock(mutex_);
+        if (auto texture = find_locked(key))
+        {
+            return texture;
+        }
+        auto texture = std::make_shared<texture2d>(key.path, srgb, elem_type, format, wrap_mode);
+        entries_[std::move(key)] = texture;
+        return texture;
+    }
+
+    std::shared_ptr<texture2d> texture_cache::find(texture_key key)
+    {
+        canonicalize(key);
+        std::lock_guard lock(mutex_);
+        return find_locked(key);
+    }
+
+    std::shared_ptr<texture2d> texture_cache::insert(texture_key key, texture2d &&texture)
+    {
+        canonicalize(key);
+        auto result = std::make_shared<texture2d>(std::move(texture));
+        std::lock_guard lock(mutex_);
+        std::erase_if(entries_, [](auto const &entry) { return entry.second.expired(); });
+        entries_[std::move(key)] = result;
+        return result;
+    }
+
+    texture_cache::statistics texture_cache::stats() const
+    {
+        std::lock_guard lock(mutex_);
+        auto live = static_cast<size_t>(std::ranges::count_if(entries_, [](auto const &entry) { return !entry.second.expired(); }));
+        return {hits_, misses_, live};
+    }
+
+    void texture_cache::reset_stats()
+    {
+        std::lock_guard lock(mutex_);
+        hits_ = 0;
+        misses_ = 0;
+    }
+}
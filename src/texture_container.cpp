@@ -0,0 +1,328 @@
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+
+#include "mapped_file.hpp"
+#include "mipmap.hpp"
+#include "parallel.hpp"
+#include "texture_container.hpp"
+
+namespace
+{
+    constexpr std::array<char, 8> magic{'L', 'G', 'L', 'T', 'E', 'X', '\0', '\0'};
+    constexpr size_t block_alignment = 16;
+
+    enum container_flags : uint32_t
+    {
+        flag_srgb = 0x01,
+        flag_flipped = 0x02,
+        flag_kaiser = 0x04,
+        flag_compress = 0x08,
+    };
+
+    struct file_header
+    {
+        std::array<char, 8> magic;
+        uint32_t version;
+        uint32_t width;
+        uint32_t height;
+        uint32_t channels;
+        uint32_t internal_format;
+        uint32_t flags;
+        uint32_t levels;
+        uint32_t faces;
+        uint32_t block_format;
+        uint32_t usage;
+    };
+
+    constexpr size_t align_up(size_t n) noexcept
+    {
+        return (n + block_alignment - 1) / block_alignment * block_alignment;
+    }
+
+    bool is_up_to_date(std::filesystem::path const &container_path, std::span<std::filesystem::path const> sources)
+    {
+        std::error_code ec;
+        auto baked_time = std::filesystem::last_write_time(container_path, ec);
+        if (ec)
+        {
+            return false;
+        }
+        for (auto &source : sources)
+        {
+            auto source_time = std::filesystem::last_write_time(source, ec);
+            if (ec || source_time > baked_time)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+texture_container texture_container::load(std::filesystem::path const &path)
+{
+    auto file = std::make_shared<mapped_file const>(path);
+    auto bytes = file->bytes();
+
+    file_header header;
+    if (bytes.size() < sizeof(header))
+    {
+        throw std::runtime_error(std::format("Texture container truncated: {}", path.string()));
+    }
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    if (header.magic != magic || header.version != version)
+    {
+        throw std::runtime_error(std::format("Not a texture container or version mismatch: {}", path.string()));
+    }
+    if (header.width == 0 || header.height == 0 || header.levels == 0 || (header.faces != 1 && header.faces != 6) ||
+        header.channels < 1 || header.channels > 4 || header.internal_format > static_cast<uint32_t>(bitmap_internal_format::f16) ||
+        header.block_format > static_cast<uint32_t>(bcn::block_format::bc7) || header.usage > static_cast<uint32_t>(bcn::texture_usage::normal_map))
+    {
+        throw std::runtime_error(std::format("Invalid texture container header: {}", path.string()));
+    }
+
+    auto entry_count = static_cast<size_t>(header.levels) * header.faces;
+    if ((bytes.size() - sizeof(header)) / sizeof(level_entry) < entry_count)
+    {
+        throw std::runtime_error(std::format("Texture container truncated: {}", path.string()));
+    }
+
+    texture_container container;
+    container.entries_.resize(entry_count);
+    std::memcpy(container.entries_.data(), bytes.data() + sizeof(header), entry_count * sizeof(level_entry));
+    for (auto &entry : container.entries_)
+    {
+        if (entry.offset > bytes.size() || entry.size > bytes.size() - entry.offset)
+        {
+            throw std::runtime_error(std::format("Texture container level out of range: {}", path.string()));
+        }
+    }
+
+    container.file_ = std::move(file);
+    container.width_ = static_cast<int>(header.width);
+    container.height_ = static_cast<int>(header.height);
+    container.levels_ = static_cast<int>(header.levels);
+    container.faces_ = static_cast<int>(header.faces);
+    container.options_ = {
+        .srgb = (header.flags & flag_srgb) != 0,
+        .flip_vertically = (header.flags & flag_flipped) != 0,
+        .mip_filter = (header.flags & flag_kaiser) != 0 ? mipmap::filter::kaiser : mipmap::filter::box,
+        .compress = (header.flags & flag_compress) != 0,
+        .usage = static_cast<bcn::texture_usage>(header.usage),
+    };
+    container.block_format_ = static_cast<bcn::block_format>(header.block_format);
+    container.channels_ = static_cast<bitmap_channel>(header.channels);
+    container.internal_format_ = static_cast<bitmap_internal_format>(header.internal_format);
+    return container;
+}
+
+void texture_container::bake(std::filesystem::path const &path, std::span<bitmap const> faces, bake_options const &options)
+{
+    if (faces.size() != 1 && faces.size() != 6)
+    {
+        throw std::invalid_argument(std::format("Texture container needs 1 or 6 faces, got {}", faces.size()));
+    }
+    auto &first = faces.front();
+    for (auto &face : faces)
+    {
+        if (face.width() != first.width() || face.height() != first.height() ||
+            face.channels() != first.channels() || face.internal_format() != first.internal_format())
+        {
+            throw std::invalid_argument(std::format("Texture container faces must have the same size and format: {}", path.string()));
+        }
+    }
+
+    auto levels = mipmap::level_count(first.width(), first.height());
+    std::vector<std::vector<bitmap>> chains(faces.size());
+    utils::parallel_for(faces.size(), [&](size_t face)
+                        { chains[face] = mipmap::build_chain(faces[face], options.srgb, options.mip_filter); });
+    auto level_image = [&](size_t face, int level) -> bitmap const & {
+        return level == 0 ? faces[face] : chains[face][level - 1];
+    };
+
+    // bcn::encode spreads the blocks of each level over the workers
+    auto block_format = options.compress ? bcn::choose_format(first, options.usage) : bcn::block_format::none;
+    std::vector<std::vector<std::byte>> blocks;
+    if (block_format != bcn::block_format::none)
+    {
+        for (size_t face = 0; face < faces.size(); ++face)
+        {
+            for (int level = 0; level < levels; ++level)
+            {
+                blocks.push_back(bcn::encode(level_image(face, level), block_format));
+            }
+        }
+    }
+    auto level_bytes = [&](size_t face, int level) -> std::span<std::byte const> {
+        if (block_format != bcn::block_format::none)
+        {
+            return blocks[face * levels + level];
+        }
+        auto &image = level_image(face, level);
+        return {image.pixels(), image.size_in_bytes()};
+    };
+
+    // level table first, so the data offsets are known before anything is written
+    std::vector<level_entry> entries;
+    auto offset = align_up(sizeof(file_header) + faces.size() * levels * sizeof(level_entry));
+    for (size_t face = 0; face < faces.size(); ++face)
+    {
+        for (int level = 0; level < levels; ++level)
+        {
+            auto &image = level_image(face, level);
+            auto size = level_bytes(face, level).size();
+            entries.push_back({offset, size, static_cast<uint32_t>(image.width()), static_cast<uint32_t>(image.height())});
+            offset = align_up(offset + size);
+        }
+    }
+
+    auto temp_path = path;
+    temp_path += ".tmp";
+    {
+        std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+        if (!out)
+        {
+            throw std::runtime_error(std::format("Cannot write texture container: {}", temp_path.string()));
+        }
+
+        file_header header{
+            .magic = magic,
+            .version = version,
+            .width = static_cast<uint32_t>(first.width()),
+            .height = static_cast<uint32_t>(first.height()),
+            .channels = static_cast<uint32_t>(first.channels()),
+            .internal_format = static_cast<uint32_t>(first.internal_format()),
+            .flags = (options.srgb ? flag_srgb : 0u) | (options.flip_vertically ? flag_flipped : 0u) |
+                     (options.mip_filter == mipmap::filter::kaiser ? flag_kaiser : 0u) | (options.compress ? flag_compress : 0u),
+            .levels = static_cast<uint32_t>(levels),
+            .faces = static_cast<uint32_t>(faces.size()),
+            .block_format = static_cast<uint32_t>(block_format),
+            .usage = static_cast<uint32_t>(options.usage),
+        };
+        out.write(reinterpret_cast<char const *>(&header), sizeof(header));
+        out.write(reinterpret_cast<char const *>(entries.data()), static_cast<std::streamsize>(entries.size() * sizeof(level_entry)));
+
+        static constexpr std::array<char, block_alignment> zeros{};
+        size_t written = sizeof(header) + entries.size() * sizeof(level_entry);
+        size_t index = 0;
+        for (size_t face = 0; face < faces.size(); ++face)
+        {
+            for (int level = 0; level < levels; ++level, ++index)
+            {
+                auto &entry = entries[index];
+                out.write(zeros.data(), static_cast<std::streamsize>(entry.offset - written));
+                out.write(reinterpret_cast<char const *>(level_bytes(face, level).data()), static_cast<std::streamsize>(entry.size));
+                written = entry.offset + entry.size;
+            }
+        }
+
+        if (!out)
+        {
+            throw std::runtime_error(std::format("Cannot write texture container: {}", temp_path.string()));
+        }
+    }
+    std::filesystem::rename(temp_path, path);
+}
+
+texture_container texture_container::load_or_bake(std::filesystem::path const &source, bake_options const &options)
+{
+    auto path = baked_path_for(source);
+    if (is_up_to_date(path, std::span{&source, 1}))
+    {
+        try
+        {
+            auto container = load(path);
+            if (container.options_ == options && container.faces_ == 1)
+            {
+                return container;
+            }
+        }
+        catch (std::runtime_error const &e)
+        {
+            std::cout << std::format("Rebake texture container {}: {}", path.string(), e.what()) << std::endl;
+        }
+    }
+
+    auto bmp = bitmap::from_file(source, bitmap_channel::unspecified, options.flip_vertically);
+    bake(path, std::span{&bmp, 1}, options);
+    return load(path);
+}
+
+texture_container texture_container::load_or_bake_cubemap(std::array<std::filesystem::path, 6> const &faces,
+                                                          std::filesystem::path const &container_path, bake_options const &options)
+{
+    if (is_up_to_date(container_path, faces))
+    {
+        try
+        {
+            auto container = load(container_path);
+            if (container.options_ == options && container.faces_ == 6)
+            {
+                return container;
+            }
+        }
+        catch (std::runtime_error const &e)
+        {
+            std::cout << std::format("Rebake texture container {}: {}", container_path.string(), e.what()) << std::endl;
+        }
+    }
+
+    std::vector<std::optional<bitmap>> decoded(faces.size());
+    utils::parallel_for(faces.size(), [&](size_t i)
+                        { decoded[i].emplace(bitmap::from_file(faces[i], bitmap_channel::rgb, options.flip_vertically)); });
+    std::vector<bitmap> bitmaps;
+    bitmaps.reserve(faces.size());
+    for (auto &face : decoded)
+    {
+        bitmaps.push_back(std::move(face.value()));
+    }
+    bake(container_path, bitmaps, options);
+    return load(container_path);
+}
+
+texture_container texture_container::load_or_bake_cubemap(std::filesystem::path const &folder, std::string const &file_ext, bake_options const &options)
+{
+    return load_or_bake_cubemap({folder / ("right" + file_ext),
+                                 folder / ("left" + file_ext),
+                                 folder / ("top" + file_ext),
+                                 folder / ("bottom" + file_ext),
+                                 folder / ("front" + file_ext),
+                                 folder / ("back" + file_ext)},
+                                folder / ("cubemap" + file_ext + ".lgltex"), options);
+}
+
+std::filesystem::path texture_container::baked_path_for(std::filesystem::path const &source)
+{
+    auto path = source;
+    path += ".lgltex";
+    return path;
+}
+
+texture_container::level_entry const &texture_container::entry(int level, int face) const
+{
+    if (level < 0 || level >= levels_ || face < 0 || face >= faces_)
+    {
+        throw std::out_of_range(std::format("Texture container has no level {} of face {}", level, face));
+    }
+    return entries_[static_cast<size_t>(face) * levels_ + level];
+}
+
+texture_container::level_view texture_container::level(int level, int face) const
+{
+    auto &e = entry(level, face);
+    return {static_cast<int>(e.width), static_cast<int>(e.height), file_->bytes().subspan(e.offset, e.size)};
+}
+
+bitmap texture_container::image(int level, int face) const
+{
+    if (compressed())
+    {
+        throw std::logic_error(std::format("Texture container {} holds {} blocks, not pixels", file_->path().string(), block_format_));
+    }
+    auto &e = entry(level, face);
+    return bitmap::from_mapped_pixels(file_, e.offset, static_cast<int>(e.width), static_cast<int>(e.height), channels_, internal_format_);
+}
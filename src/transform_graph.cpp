@@ -0,0 +1,138 @@
+#include <algorithm>
+#include <format>
+#include <stdexcept>
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include "transform_graph.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define TRANSFORM_X86 1
+#include <immintrin.h>
+#else
+#define TRANSFORM_X86 0
+#endif
+
+namespace glwrap
+{
+    namespace
+    {
+        // out = a * b, column-major 4x4, out must not alias a or b
+        void multiply(float const *a, float const *b, float *out) noexcept
+        {
+#if TRANSFORM_X86
+            auto a0 = _mm_loadu_ps(a);
+            auto a1 = _mm_loadu_ps(a + 4);
+            auto a2 = _mm_loadu_ps(a + 8);
+            auto a3 = _mm_loadu_ps(a + 12);
+            for (int column = 0; column < 4; ++column)
+            {
+                auto b_column = b + column * 4;
+                auto result = _mm_mul_ps(a0, _mm_set1_ps(b_column[0]));
+                result = _mm_add_ps(result, _mm_mul_ps(a1, _mm_set1_ps(b_column[1])));
+                result = _mm_add_ps(result, _mm_mul_ps(a2, _mm_set1_ps(b_column[2])));
+                result = _mm_add_ps(result, _mm_mul_ps(a3, _mm_set1_ps(b_column[3])));
+                _mm_storeu_ps(out + column * 4, result);
+            }
+#else
+            for (int column = 0; column < 4; ++column)
+            {
+                for (int row = 0; row < 4; ++row)
+                {
+                    out[column * 4 + row] = a[row] * b[column * 4] + a[4 + row] * b[column * 4 + 1] +
+                                            a[8 + row] * b[column * 4 + 2] + a[12 + row] * b[column * 4 + 3];
+                }
+            }
+#endif
+        }
+    }
+
+    uint32_t transform_graph::add_node(std::string name, uint32_t parent, glm::mat4 const &local)
+    {
+        auto index = static_cast<uint32_t>(parents_.size());
+        if (parent == no_parent)
+        {
+            if (level_starts_.size() > 1)
+            {
+                throw std::invalid_argument(std::format("Root node {} added after child nodes", name));
+            }
+            if (level_starts_.empty())
+            {
+                level_starts_.push_back(0);
+            }
+        }
+        else
+        {
+            if (parent >= index)
+            {
+                throw std::invalid_argument(std::format("Parent {} of node {} is not added yet", parent, name));
+            }
+            auto parent_level = static_cast<size_t>(std::ranges::upper_bound(level_starts_, parent) - level_starts_.begin()) - 1;
+            auto last_level = level_starts_.size() - 1;
+            if (parent_level == last_level)
+            {
+                level_starts_.push_back(index);
+            }
+            else if (parent_level + 1 != last_level)
+            {
+                throw std::invalid_argument(std::format("Node {} is not added in breadth-first order", name));
+            }
+        }
+
+        names_.push_back(std::move(name));
+        parents_.push_back(parent);
+        locals_.push_back(local);
+        worlds_.push_back(local);
+        dirty_.push_back(1);
+        return index;
+    }
+
+    void transform_graph::set_local(uint32_t node, glm::mat4 const &local)
+    {
+        locals_.at(node) = local;
+        dirty_[node] = 1;
+    }
+
+    size_t transform_graph::update()
+    {
+        size_t updated = 0;
+        for (size_t level = 0; level < level_starts_.size(); ++level)
+        {
+            auto first = level_starts_[level];
+            auto last = level + 1 < level_starts_.size() ? level_starts_[level + 1] : static_cast<uint32_t>(size());
+
+            // dirty flags of the previous level are still set, so a recomputed parent pulls in all its children
+            batch_.clear();
+            for (auto node = first; node < last; ++node)
+            {
+                auto parent = parents_[node];
+                if (parent != no_parent && dirty_[parent])
+                {
+                    dirty_[node] = 1;
+                }
+                if (dirty_[node])
+                {
+                    batch_.push_back(node);
+                }
+            }
+
+            if (level == 0)
+            {
+                for (auto node : batch_)
+                {
+                    worlds_[node] = locals_[node];
+                }
+            }
+            else
+            {
+                for (auto node : batch_)
+                {
+                    multiply(glm::value_ptr(worlds_[parents_[node]]), glm::value_ptr(locals_[node]), glm::value_ptr(worlds_[node]));
+                }
+            }
+            updated += batch_.size();
+        }
+        std::ranges::fill(dirty_, uint8_t{0});
+        return updated;
+    }
+}
@@ -113,14 +113,16 @@ namespace utils
             indices.push_back(sec_last + (j + 1) % slices);
         }
 
-        return full_information
-                   ? auto_vertex_array(index_buffer<GLuint>(indices),
+        auto result = full_information
+                   ? auto_vertex_array(any_index_buffer::narrowest(indices, vertices.size()),
                                        vertex_buffer<glm::vec3>(vertices), // position
                                        vertex_buffer<glm::vec3>(vertices), // normal
                                        vertex_buffer<glm::vec2>(texcoords),
                                        vertex_buffer<glm::vec4>(tangents) // gltf2-style tangent
                                        )
-                   : auto_vertex_array(index_buffer<GLuint>(indices), vertex_buffer<glm::vec3>(vertices));
+                   : auto_vertex_array(any_index_buffer::narrowest(indices, vertices.size()), vertex_buffer<glm::vec3>(vertices));
+        result.set_bounds(bounds::compute(vertices));
+        return result;
     }
 
     glm::vec3 hsv(int h, float s, float v)